@@ -0,0 +1,407 @@
+/**
+ * @file ScanADCBenchmark.ino
+ * @author Hobbylad ()
+ * @brief Benchmark of ScanADC Library ISR cost, CPU load, channel rate and latency.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Runs a table of scan configurations one after the other and reports one line of comma
+ * separated values per configuration on the serial port, so results can be captured and
+ * compared between changes to the ADC Interrupt Service Routine (ISR).
+ *
+ * The CPU load is measured by counting iterations of an idle loop over a fixed window with
+ * the scanner stopped and then running. The CPU time taken by the scanner over the window is
+ * divided by the samples accumulated in the completed scans, which gives the cost in ns per
+ * sample including discarded conversions and channel switching. It is derived from measured
+ * values only, so it also holds on megaAVR-0 devices where the ISR runs once per result of
+ * hardware accumulation instead of once per conversion.
+ *
+ * The latency the ADC ISR imposes on other interrupts is measured by a probe interrupt from Timer1
+ * compare match A at a period that drifts against the conversions. The probe reads the timer at
+ * entry, which counts CPU cycles since the compare match, and the worst case over the window is
+ * reported, including the constant entry cost measured with the scanner stopped. Timer1 is not
+ * available on megaAVR-0 devices so no latency is reported there.
+ *
+ * The sketch only uses the hardware UART or USB serial for output. The CPU time per sample is an
+ * estimate from the idle loop, so the ISR cost in CPU cycles is counted by building the sketch with
+ * SCAN_ADC_CYCLE_RUNNER defined and running it under simavr with extras/ScanADCCycleRunner. The
+ * sketch then measures a fixed count of scans of each configuration and marks them in general
+ * purpose I/O registers watched by the runner instead of printing.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+
+#if defined(SCAN_ADC_CYCLE_RUNNER)
+#include <avr/sleep.h>
+#include <stdlib.h>
+#endif
+
+#define WINDOW_US                   1000000UL           // Measurement window per configuration
+#define PROBE_PERIOD_CYCLES         1999U               // Probe interrupt period, prime to drift against conversions
+#define BENCHMARK_CHANNELS          16                  // Largest channel count of a configuration
+
+#if defined(SCAN_ADC_CYCLE_RUNNER)
+#define RUNNER_SCANS                16                  // Scans measured per configuration
+#if defined(GPIOR0)
+#define RUNNER_MARKER               GPIOR0              // 1 while measuring, 0 after and 0xFF when done
+#define RUNNER_TEXT                 GPIOR1              // Characters of the configuration line
+#else
+#define RUNNER_MARKER               GPIO_GPIOR0
+#define RUNNER_TEXT                 GPIO_GPIOR1
+#endif
+#endif
+
+// Benchmark configuration.
+struct benchmark_t
+{
+    const char *name;                                   // Name reported in results
+    uint8_t channel_count;                              // Channels to scan
+    uint8_t sample_count_log2;                          // Averaging of every channel
+    bool callbacks;                                     // Attach channel and scan callbacks
+    bool interruptible;                                 // ADC ISR interruptible by the probe
+    uint8_t median;                                     // Median filter length of every channel
+};
+
+// Averaging up to 64 samples (log2 6) uses the narrow 16-bit accumulator ISR path. Its saving is
+// measured by the cycle runner on 4ch_log2_6 against a build of the same configuration without the
+// narrow path, as comparing with 4ch_log2_7 would mostly show the channel switches amortised over
+// twice the samples.
+// The _int configurations repeat the callback configurations with the ADC ISR interruptible, so
+// comparing irq_latency_max_cycles shows the worst case latency removed from other interrupts.
+// The _med configurations filter raw samples by a median of 3, 5 or 7 before accumulation with the
+// 32-bit accumulator, so the cycle runner reports their increase of ISR cycles per conversion over
+// 4ch_log2_7 as the median filter cost.
+static const benchmark_t benchmarks[] =
+{
+    { "4ch_log2_6",          4, 6, false, false, 0 },
+    { "4ch_log2_7",          4, 7, false, false, 0 },
+    { "4ch_log2_7_med3",     4, 7, false, false, 3 },
+    { "4ch_log2_7_med5",     4, 7, false, false, 5 },
+    { "4ch_log2_7_med7",     4, 7, false, false, 7 },
+    { "4ch_log2_8",          4, 8, false, false, 0 },
+    { "4ch_log2_8_cb",       4, 8, true,  false, 0 },
+    { "4ch_log2_8_cb_int",   4, 8, true,  true,  0 },
+    { "16ch_log2_0",        16, 0, false, false, 0 },
+    { "16ch_log2_0_cb",     16, 0, true,  false, 0 },
+    { "16ch_log2_0_cb_int", 16, 0, true,  true,  0 },
+};
+
+// Inputs scanned, repeated as necessary to fill the channel count.
+static const ScanADC::mux_t inputs[] =
+{
+    ScanADC::MUX_ADC7, ScanADC::MUX_ADC6, ScanADC::MUX_ADC5, ScanADC::MUX_ADC4,
+};
+
+static ScanADC &adc_scanner = ScanADC::getInstance();
+
+static ScanADC::channel_config_t config[BENCHMARK_CHANNELS];
+
+static uint8_t last_channel;
+
+static volatile uint8_t callback_count;
+static volatile uint32_t scan_time_us;
+
+static void channel_callback(uint8_t channel, uint16_t sample)
+{
+    callback_count++;
+}
+
+static void scan_callback(const uint16_t *samples)
+{
+    scan_time_us = micros();
+}
+
+// Starts scanning a configuration and waits for its first scan.
+static void start_benchmark(const benchmark_t &benchmark)
+{
+    for (uint8_t i = 0; i < benchmark.channel_count; i++)
+    {
+        config[i].mux = inputs[i % (sizeof(inputs) / sizeof(inputs[0]))];
+        config[i].sample_count_log2 = benchmark.sample_count_log2;
+        config[i].median = benchmark.median;
+    }
+
+    last_channel = benchmark.channel_count - 1;
+
+    adc_scanner.attach_channel_callback(benchmark.callbacks ? channel_callback : NULL);
+    adc_scanner.attach_scan_callback(benchmark.callbacks ? scan_callback : NULL);
+    adc_scanner.set_interruptible(benchmark.interruptible);
+
+    adc_scanner.begin(config, benchmark.channel_count);
+    adc_scanner.wait_scan();
+}
+
+#if defined(SCAN_ADC_CYCLE_RUNNER)
+// Writes text to the cycle runner.
+static void runner_print(const char *text)
+{
+    while (*text)
+    {
+        RUNNER_TEXT = *text++;
+    }
+}
+
+static void runner_print(uint16_t value)
+{
+    char digits[6];
+
+    runner_print(utoa(value, digits, 10));
+}
+
+// Writes the configuration line of a benchmark, with the same first columns as the serial results.
+static void runner_print(const benchmark_t &benchmark)
+{
+    runner_print(benchmark.name);
+    runner_print(",");
+    runner_print(benchmark.channel_count);
+    runner_print(",");
+    runner_print(benchmark.sample_count_log2);
+    runner_print(benchmark.callbacks ? ",1" : ",0");
+    runner_print(benchmark.interruptible ? ",1," : ",0,");
+    runner_print(benchmark.median);
+    runner_print(",");
+    runner_print(RUNNER_SCANS);
+}
+
+// Measures each configuration over a fixed count of scans while the runner counts the ISR cycles,
+// then stops the simulation by sleeping with interrupts disabled.
+int main()
+{
+    init();
+
+    for (uint8_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+    {
+        start_benchmark(benchmarks[i]);
+        runner_print(benchmarks[i]);
+
+        RUNNER_MARKER = 1;
+
+        for (uint8_t n = 0; n < RUNNER_SCANS; n++)
+        {
+            adc_scanner.wait_scan();
+        }
+
+        RUNNER_MARKER = 0;
+
+        adc_scanner.end();
+    }
+
+    RUNNER_MARKER = 0xFF;
+
+    cli();
+    sleep_enable();
+    sleep_cpu();
+
+    for (;;);
+}
+#else
+static volatile uint8_t idle_sn;
+static volatile uint16_t probe_latency_max;
+
+#if defined(TIMSK1)
+ISR(TIMER1_COMPA_vect)
+{
+    uint16_t latency = TCNT1;
+
+    if (latency > probe_latency_max)
+    {
+        probe_latency_max = latency;
+    }
+}
+
+// Starts the probe interrupt with Timer1 in CTC mode without prescaling, so TCNT1 counts CPU cycles
+// from the compare match.
+static void start_probe()
+{
+    TCCR1A = 0;
+    TCCR1B = 0;
+    TCNT1 = 0;
+    OCR1A = PROBE_PERIOD_CYCLES - 1;
+    TIFR1 = (1 << OCF1A);
+    TIMSK1 = (1 << OCIE1A);
+    TCCR1B = (1 << WGM12) | (1 << CS10);
+}
+
+static void stop_probe()
+{
+    TCCR1B = 0;
+    TIMSK1 = 0;
+}
+#else
+static void start_probe()
+{
+}
+
+static void stop_probe()
+{
+}
+#endif
+
+static uint8_t __attribute__((noinline)) read_idle_sn()
+{
+    return idle_sn;
+}
+
+static uint8_t __attribute__((noinline)) read_scan_sn()
+{
+    return adc_scanner.get_sn(last_channel);
+}
+
+// Counts idle loop iterations and completed scans over the measurement window. When the
+// scan callback is attached, the delay from scan completion to the loop observing it is
+// accumulated in latency_sum_us and the worst case returned in latency_max_us.
+static uint32_t run_window(uint8_t (*read_sn)(), uint32_t &scans, uint32_t &latency_sum_us,
+                           uint32_t &latency_max_us)
+{
+    uint32_t loops = 0;
+    uint32_t start = micros();
+    uint8_t last_sn = read_sn();
+
+    scans = 0;
+    latency_sum_us = 0;
+    latency_max_us = 0;
+
+    noInterrupts();
+    probe_latency_max = 0;
+    interrupts();
+
+    while ((uint32_t)(micros() - start) < WINDOW_US)
+    {
+        uint8_t sn = read_sn();
+
+        if (sn != last_sn)
+        {
+            uint32_t latency_us = micros() - scan_time_us;
+
+            scans += (uint8_t)(sn - last_sn);
+            last_sn = sn;
+
+            latency_sum_us += latency_us;
+
+            if (latency_us > latency_max_us)
+            {
+                latency_max_us = latency_us;
+            }
+        }
+
+        loops++;
+    }
+
+    return loops;
+}
+
+// Prints the worst case probe interrupt latency of the last window and ends the line.
+static void print_probe_latency()
+{
+    Serial.print(',');
+#if defined(TIMSK1)
+    Serial.print(probe_latency_max);
+#endif
+    Serial.println();
+}
+
+// Runs a configuration and prints its line of results.
+static void run_benchmark(const benchmark_t &benchmark, uint32_t idle_loops)
+{
+    uint32_t loops, scans, latency_sum_us, latency_max_us;
+
+    start_benchmark(benchmark);
+
+    loops = run_window(read_scan_sn, scans, latency_sum_us, latency_max_us);
+
+    adc_scanner.end();
+
+    uint32_t load_ppm = 1000000UL - (uint32_t)((uint64_t) loops * 1000000UL / idle_loops);
+    uint32_t samples = (scans * benchmark.channel_count) << benchmark.sample_count_log2;
+    uint32_t cpu_ns_per_sample = samples ? (uint32_t)((uint64_t) load_ppm * WINDOW_US / 1000UL / samples) : 0;
+    uint32_t channel_rate = scans * benchmark.channel_count * 1000000UL / WINDOW_US;
+
+    Serial.print(benchmark.name);
+    Serial.print(',');
+    Serial.print(benchmark.channel_count);
+    Serial.print(',');
+    Serial.print(benchmark.sample_count_log2);
+    Serial.print(',');
+    Serial.print(benchmark.callbacks ? 1 : 0);
+    Serial.print(',');
+    Serial.print(benchmark.interruptible ? 1 : 0);
+    Serial.print(',');
+    Serial.print(benchmark.median);
+    Serial.print(',');
+    Serial.print(load_ppm / 10000.0f, 2);
+    Serial.print(',');
+    Serial.print(cpu_ns_per_sample);
+    Serial.print(',');
+    Serial.print(channel_rate);
+    Serial.print(',');
+
+    if (benchmark.callbacks && scans)
+    {
+        Serial.print(latency_sum_us / scans);
+        Serial.print(',');
+        Serial.print(latency_max_us);
+    }
+    else
+    {
+        Serial.print(',');
+    }
+
+    print_probe_latency();
+}
+
+void setup()
+{
+    uint32_t idle_loops, scans, latency_sum_us, latency_max_us;
+
+    Serial.begin(115200);
+    while (!Serial);
+
+    start_probe();
+
+    idle_loops = run_window(read_idle_sn, scans, latency_sum_us, latency_max_us);
+
+    Serial.println("name,channels,sample_count_log2,callbacks,interruptible,median,cpu_load_pct,"
+                   "cpu_ns_per_sample,channel_rate_hz,latency_avg_us,latency_max_us,"
+                   "irq_latency_max_cycles");
+
+    // Scanner stopped, so the probe latency is the constant interrupt entry cost.
+    Serial.print("idle,0,,,,,,,,,");
+    print_probe_latency();
+
+    for (uint8_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+    {
+        run_benchmark(benchmarks[i], idle_loops);
+    }
+
+    stop_probe();
+
+    Serial.println("done");
+}
+
+void loop()
+{
+}
+#endif
@@ -87,14 +87,33 @@ void HIDController::begin()
     HID().AppendDescriptor(&node);
 }
 
-void HIDController::send(const HID_controller_report &report)
+void HIDController::publish(uint32_t sample_time_us)
 {
-    HID_controller_report report2(report);
+    uint8_t i = ready_i;
 
-    report2.right_stick_x = ADC_CLAMP(report2.right_stick_x);
-    report2.right_stick_y = ADC_CLAMP(report2.right_stick_y);
-    report2.left_stick_y = ADC_CLAMP(report2.left_stick_y);
-    report2.left_stick_x = ADC_CLAMP(report2.left_stick_x);
+    sample_times_us[fill_i] = sample_time_us;
 
-    HID().SendReport(0x01, &report2, sizeof(report2));
+    ready_i = fill_i;
+    fill_i = i;
+    ready = true;
+}
+
+bool HIDController::send()
+{
+    if (!ready)
+    {
+        return false;
+    }
+
+    uint8_t i = send_i;
+
+    noInterrupts();
+    send_i = ready_i;
+    ready_i = i;
+    ready = false;
+    interrupts();
+
+    HID().SendReport(0x01, &reports[send_i], sizeof(reports[send_i]));
+
+    return true;
 }
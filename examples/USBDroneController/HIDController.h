@@ -55,11 +55,41 @@ typedef struct __attribute__((packed)) _HID_controller_report
     uint16_t buttons;
 } HID_controller_report;
 
+// Reports are triple buffered so the ADC scan callback can fill a report in place while the main
+// loop sends another, and the main loop always sends the newest complete report without copying.
 class HIDController
 {
     public:
+    HIDController() : fill_i(0), ready_i(1), send_i(2), ready(false) {}
+
     void begin();
-    void send(const HID_controller_report &report);
+
+    // Report to fill. Only call from the ADC scan callback.
+    inline HID_controller_report &get_fill_report()
+    {
+        return reports[fill_i];
+    }
+
+    // Makes the filled report the newest complete report, optionally with the time in microseconds
+    // its oldest sample was measured. Only call from the ADC scan callback.
+    void publish(uint32_t sample_time_us = 0);
+
+    // Sends the newest complete report if one was published since the last call.
+    bool send();
+
+    // Time the oldest sample of the last report sent was measured.
+    inline uint32_t get_sent_sample_time() const
+    {
+        return sample_times_us[send_i];
+    }
+
+    private:
+    HID_controller_report reports[3];
+    uint32_t sample_times_us[3];
+    volatile uint8_t fill_i;            // Report being filled by scan callback.
+    volatile uint8_t ready_i;           // Newest complete report.
+    uint8_t send_i;                     // Report being sent by main loop.
+    volatile bool ready;                // Newest complete report not yet sent.
 };
 
 #endif
@@ -56,22 +56,197 @@
 //
 
 #include "ScanADC.h"
+#include "ScanStream.h"
+#include "ScanCalibration.h"
+#include "ScanKeypad.h"
 #include "HIDController.h"
 #include "global.h"
 
 #define DEBUG_PIN                  2                   // Pull pin 2 to GND to enable USB HID
+#define DEBUG_STREAM               0                   // Set to 1 to log every scan as ScanStream binary frames
+#define LATENCY_MODE               0                   // Set to 1 to print stick to USB latency percentiles with USB HID
+#define AXIS_CALIBRATION           0                   // Set to 1 to shape axes with calibration tables
+#define KEYPAD_LADDER              0                   // Set to 1 to read HID buttons from a resistor ladder keypad
+#define CALIBRATION_CAPTURE_MS     10000               // Time to move sticks to endpoints in debug mode
+
+#define LATENCY_REPORTS            1000                // Reports per latency measurement run
+#define LATENCY_BIN_LOG2           7                   // Latency histogram bin width of 128us
+#define LATENCY_BINS               128                 // Latency histogram range of 16.4ms
 
 #define LEFT_STICK_X_ADC            ScanADC::MUX_ADC7   // A0
 #define LEFT_STICK_Y_ADC            ScanADC::MUX_ADC6   // A1
 #define RIGHT_STICK_X_ADC          ScanADC::MUX_ADC5   // A2
 #define RIGHT_STICK_Y_ADC          ScanADC::MUX_ADC4   // A3
+#define KEYPAD_ADC                 ScanADC::MUX_ADC8   // A6 (D4)
+
+#define CHANNEL_COUNT              (4 + KEYPAD_LADDER) // Stick axes and optional keypad channel
 
 static ScanADC &adc_scanner = ScanADC::getInstance();
 
 static HIDController HID_controller;
 
+#if DEBUG_STREAM
+static ScanStream debug_stream;
+#endif
+
 static bool debug = false;
 
+#if KEYPAD_LADDER
+static ScanKeypad keypad;
+static uint16_t keypad_thresholds[KEYPAD_KEYS];
+
+// Nominal ladder levels of the keys with the input pulled up to the reference when idle.
+static const uint16_t keypad_levels[KEYPAD_KEYS] =
+{
+    ADC_LEVEL(0.0), ADC_LEVEL(0.7), ADC_LEVEL(1.6), ADC_LEVEL(2.5), ADC_LEVEL(3.3)
+};
+
+#define KEYPAD_BUTTONS()            keypad.get_keys()
+#else
+#define KEYPAD_BUTTONS()            0
+#endif
+
+#if AXIS_CALIBRATION
+static ScanCalibration axes[4];
+static uint16_t axis_tables[4][SCAN_CALIBRATION_TABLE_SIZE];
+
+#define AXIS_OUTPUT(axis, sample)   axes[axis].apply(sample)
+
+// Uses nominal calibration tables. Tables printed by capture_calibration() can be pasted into the
+// sketch and used with axes[i].begin_P() instead.
+static void begin_calibration()
+{
+    const ScanCalibration::calibration_t nominal = { 0, AXIS_CENTER, ADC_LEVEL(3.3), AXIS_DEADZONE, AXIS_EXPO, ADC_MAX };
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        ScanCalibration::build(axis_tables[i], nominal);
+        axes[i].begin(axis_tables[i]);
+    }
+}
+
+// Captures the endpoints while the sticks are moved around and the center once they are released,
+// then prints the calibration tables as PROGMEM initializers.
+static void capture_calibration()
+{
+    static const char *const names[] = { "yaw_table", "throttle_table", "roll_table", "pitch_table" };
+
+    Serial.println("Move both sticks to all endpoints, then release them");
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        axes[i].capture_begin();
+    }
+
+    uint32_t start = millis();
+
+    while ((uint32_t)(millis() - start) < CALIBRATION_CAPTURE_MS)
+    {
+        adc_scanner.wait_scan();
+
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            axes[i].capture(adc_scanner.get_sample(i));
+        }
+    }
+
+    adc_scanner.wait_scan();
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (axes[i].capture_end(adc_scanner.get_sample(i), AXIS_DEADZONE, AXIS_EXPO, ADC_MAX, axis_tables[i]))
+        {
+            axes[i].print(Serial, names[i]);
+        }
+        else
+        {
+            Serial.print(names[i]);
+            Serial.println(": axis not moved to both endpoints, keeping the nominal calibration");
+        }
+    }
+}
+#else
+#define AXIS_OUTPUT(axis, sample)   ADC_CLAMP(sample)
+#endif
+
+#if LATENCY_MODE
+static volatile uint32_t timestamps[CHANNEL_COUNT];
+static uint16_t latency_histogram[LATENCY_BINS];
+static uint16_t latency_count;
+static uint32_t latency_max_us;
+
+// Prints the latency of the run at percentile @a pct as the upper edge of its histogram bin.
+static void print_latency_percentile(const char *name, uint8_t pct)
+{
+    uint16_t target = ((uint32_t) latency_count * pct + 99) / 100, count = 0;
+    uint8_t bin = 0;
+
+    while ((bin < LATENCY_BINS - 1) && ((count += latency_histogram[bin]) < target))
+    {
+        bin++;
+    }
+
+    Serial.print(name);
+    Serial.print(((uint32_t) bin + 1) << LATENCY_BIN_LOG2);
+    Serial.print("us ");
+}
+
+// Adds the latency of a report sent to the run and prints the percentiles at the end of the run.
+static void record_latency(uint32_t latency_us)
+{
+    uint32_t bin = latency_us >> LATENCY_BIN_LOG2;
+
+    latency_histogram[(bin < LATENCY_BINS) ? bin : (LATENCY_BINS - 1)]++;
+
+    if (latency_us > latency_max_us)
+    {
+        latency_max_us = latency_us;
+    }
+
+    if (++latency_count == LATENCY_REPORTS)
+    {
+        print_latency_percentile("latency p50: ", 50);
+        print_latency_percentile("p90: ", 90);
+        print_latency_percentile("p99: ", 99);
+        Serial.print("max: ");
+        Serial.print(latency_max_us);
+        Serial.println("us");
+
+        memset(latency_histogram, 0, sizeof(latency_histogram));
+        latency_count = 0;
+        latency_max_us = 0;
+    }
+}
+#endif
+
+// Fills the HID report in place as each scan completes, clamping or calibrating the samples to the axis range.
+static void scan_callback(const uint16_t *samples)
+{
+    HID_controller_report &report = HID_controller.get_fill_report();
+
+    report.left_stick_x = AXIS_OUTPUT(0, samples[0]);
+    report.left_stick_y = AXIS_OUTPUT(1, samples[1]);
+    report.right_stick_x = AXIS_OUTPUT(2, samples[2]);
+    report.right_stick_y = AXIS_OUTPUT(3, samples[3]);
+    report.buttons = KEYPAD_BUTTONS();
+
+#if LATENCY_MODE
+    uint32_t oldest_us = timestamps[0];
+
+    for (uint8_t i = 1; i < 4; i++)
+    {
+        if ((int32_t)(timestamps[i] - oldest_us) < 0)
+        {
+            oldest_us = timestamps[i];
+        }
+    }
+
+    HID_controller.publish(oldest_us);
+#else
+    HID_controller.publish();
+#endif
+}
+
 void setup()
 {
     pinMode(DEBUG_PIN, INPUT_PULLUP);
@@ -96,25 +271,70 @@ void setup()
         Serial.print("Measured ADC reference using internal 1.1V Bandgap reference: ");
         Serial.print(1024 * 1.1f / sample);
         Serial.println("V");
+
+#if DEBUG_STREAM
+        debug_stream.begin(Serial, 4);
+#endif
     }
     else
     {
         HID_controller.begin();
+        adc_scanner.attach_scan_callback(scan_callback);
+
+#if AXIS_CALIBRATION
+        begin_calibration();
+#endif
+
+#if LATENCY_MODE
+        Serial.begin(115200);
+        adc_scanner.attach_timestamps(timestamps);
+#endif
     }
 
+#if KEYPAD_LADDER
+    // Keys are decoded and debounced over 3 scans by the ADC ISR.
+    ScanKeypad::build(keypad_levels, KEYPAD_KEYS, ADC_LEVEL(ADC_REFERENCE) - 1, keypad_thresholds);
+    keypad.begin(keypad_thresholds, KEYPAD_KEYS, 3);
+    adc_scanner.attach_keypad(4, &keypad);
+#endif
+
+    // Averaging adapts from 256 samples with sticks static to 16 samples while they move.
     const ScanADC::channel_config_t config[] =
     {
-        { LEFT_STICK_X_ADC, 8 },   // YAW
-        { LEFT_STICK_Y_ADC, 8 },   // THROTTLE
-        { RIGHT_STICK_X_ADC, 8 },  // ROLL
-        { RIGHT_STICK_Y_ADC, 8 },  // PITCH
+        { LEFT_STICK_X_ADC, 8, 4, 3 },   // YAW
+        { LEFT_STICK_Y_ADC, 8, 4, 3 },   // THROTTLE
+        { RIGHT_STICK_X_ADC, 8, 4, 3 },  // ROLL
+        { RIGHT_STICK_Y_ADC, 8, 4, 3 },  // PITCH
+#if KEYPAD_LADDER
+        { KEYPAD_ADC, 2 },               // BUTTONS
+#endif
     };
 
-    adc_scanner.begin(config, 4);
+    adc_scanner.begin(config, CHANNEL_COUNT);
+
+#if AXIS_CALIBRATION
+    if (debug)
+    {
+        capture_calibration();
+    }
+#endif
 }
 
 void loop()
 {
+    if (!debug)
+    {
+        // Reports are assembled by the scan callback, so only the newest is handed to USB.
+        if (HID_controller.send())
+        {
+#if LATENCY_MODE
+            record_latency(micros() - HID_controller.get_sent_sample_time());
+#endif
+        }
+
+        return;
+    }
+
     uint8_t sn;
     uint16_t left_x, left_y, right_x, right_y;
 
@@ -126,31 +346,23 @@ void loop()
     right_x = adc_scanner.get_sample(2);
     right_y = adc_scanner.get_sample(3);
 
-    if (debug)
-    {
-        Serial.print(millis(), HEX);
-        Serial.print(" sn: ");
-        Serial.print(sn, HEX);
-        Serial.print(" adc: ");
-        Serial.print(left_x, HEX);
-        Serial.print(" ");
-        Serial.print(left_y, HEX);
-        Serial.print(" ");
-        Serial.print(right_x, HEX);
-        Serial.print(" ");
-        Serial.print(right_y, HEX);
-        Serial.println();
-    }
-    else
-    {
-        HID_controller_report report;
-
-        report.left_stick_x = left_x;
-        report.left_stick_y = left_y;
-        report.right_stick_x = right_x;
-        report.right_stick_y = right_y;
-        report.buttons = 0;
+#if DEBUG_STREAM
+    const uint16_t samples[] = { left_x, left_y, right_x, right_y };
 
-        HID_controller.send(report);
-    }
+    debug_stream.write_frame(samples);
+    debug_stream.poll();
+#else
+    Serial.print(millis(), HEX);
+    Serial.print(" sn: ");
+    Serial.print(sn, HEX);
+    Serial.print(" adc: ");
+    Serial.print(left_x, HEX);
+    Serial.print(" ");
+    Serial.print(left_y, HEX);
+    Serial.print(" ");
+    Serial.print(right_x, HEX);
+    Serial.print(" ");
+    Serial.print(right_y, HEX);
+    Serial.println();
+#endif
 }
@@ -50,4 +50,13 @@
 // Clamps ADC code to maximum value if necessary.
 #define ADC_CLAMP(value) (((value) > ADC_MAX) ? ADC_MAX : (value))
 
+// Nominal joystick axis center, deadzone in ADC codes either side of center and expo percentage
+// used for axis calibration until replaced by captured calibration tables.
+#define AXIS_CENTER ADC_LEVEL(3.3 / 2)
+#define AXIS_DEADZONE 4
+#define AXIS_EXPO 0
+
+// Keys on the resistor ladder keypad, reported as HID buttons 1 to 5.
+#define KEYPAD_KEYS 5
+
 #endif
@@ -0,0 +1,289 @@
+/**
+ * @file ScanADCCycleRunner.cpp
+ * @author Hobbylad ()
+ * @brief Cycle counting runner of the ScanADCBenchmark sketch under simavr.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Usage:
+ *
+ *   scan_adc_cycles -m <mcu> -g <marker> -t <text> [-f frequency] [-c cycle_limit] <firmware.elf>
+ *       Runs the ScanADCBenchmark sketch built with SCAN_ADC_CYCLE_RUNNER under simavr and prints
+ *       one line of comma separated values per benchmark configuration with the CPU cycles of the
+ *       ADC Interrupt Service Routine (ISR) counted by the simulator.
+ *
+ * The sketch writes a line describing the configuration to the text register and then writes 1 to
+ * the marker register while it measures, 0 after it and 0xFF when all configurations are done. The
+ * runner counts the cycles from the ADC vector to the return of the ISR, when the stack pointer is
+ * back above its level at the vector, so nested interrupts of an interruptible ISR are included.
+ * Each conversion gets the next value of a pseudo-random sequence on every input so the branches of
+ * the median filter take their usual paths.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sim_avr.h"
+#include "sim_core.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "avr_adc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#define INPUT_COUNT     8               // Inputs given a new value for each result read.
+#define REFERENCE_MV    5000            // AVCC and AREF of the simulated device.
+
+/**
+ * @brief Cycle statistics of a configuration.
+ */
+struct cycles_t
+{
+    avr_cycle_count_t start;            // Cycle the measurement started.
+    avr_cycle_count_t isr_total;        // Cycles in the ISR.
+    uint32_t isr_count;                 // ISR invocations.
+    uint32_t isr_min;                   // Fewest cycles of an ISR invocation.
+    uint32_t isr_max;                   // Most cycles of an ISR invocation.
+    uint32_t conversions;               // Conversions started.
+};
+
+static std::string label;               // Configuration line written by the sketch.
+static cycles_t cycles;                 // Statistics of the configuration measured.
+static bool measuring;                  // Between the start and stop markers.
+static bool done;                       // All configurations measured.
+static uint32_t frequency;              // Simulated CPU clock.
+static uint32_t noise = 12345;          // Pseudo-random input sequence.
+
+// Prints the line of a configuration from the label written by the sketch and its statistics.
+static void print_line(avr_cycle_count_t end)
+{
+    unsigned channels = 0, scans = 0;
+    size_t comma = label.rfind(',');
+    double elapsed = (double)(end - cycles.start);
+
+    sscanf(label.c_str(), "%*[^,],%u", &channels);
+
+    if (comma != std::string::npos)
+    {
+        scans = (unsigned) strtoul(label.c_str() + comma + 1, NULL, 10);
+    }
+
+    printf("%s,%u,%u,%u,%u,%u,%.1f,%.2f,%.0f\n", label.c_str(), cycles.isr_count, cycles.conversions,
+           cycles.isr_count ? cycles.isr_min : 0, cycles.isr_max,
+           cycles.isr_count ? (unsigned)((cycles.isr_total + cycles.isr_count / 2) / cycles.isr_count) : 0,
+           cycles.conversions ? (double) cycles.isr_total / cycles.conversions : 0.0,
+           elapsed ? 100.0 * cycles.isr_total / elapsed : 0.0,
+           elapsed ? (double) channels * scans * frequency / elapsed : 0.0);
+}
+
+static void on_marker(avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param)
+{
+    (void) addr;
+    (void) param;
+
+    if (v == 0xFF)
+    {
+        done = true;
+    }
+    else if (v)
+    {
+        memset(&cycles, 0, sizeof(cycles));
+        cycles.isr_min = UINT32_MAX;
+        cycles.start = avr->cycle;
+        measuring = true;
+    }
+    else if (measuring)
+    {
+        print_line(avr->cycle);
+        measuring = false;
+        label.clear();
+    }
+}
+
+static void on_text(avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param)
+{
+    (void) avr;
+    (void) addr;
+    (void) param;
+
+    label += (char) v;
+}
+
+// Gives every input a new value as a conversion starts.
+static void on_conversion(avr_irq_t *irq, uint32_t value, void *param)
+{
+    avr_t *avr = (avr_t *) param;
+
+    (void) irq;
+    (void) value;
+
+    if (measuring)
+    {
+        cycles.conversions++;
+    }
+
+    for (int i = 0; i < INPUT_COUNT; i++)
+    {
+        noise = noise * 1103515245UL + 12345UL;
+        avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC0 + i), (noise >> 16) % REFERENCE_MV);
+    }
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "  scan_adc_cycles -m <mcu> -v <adc_vector> -g <marker> -t <text> [-f frequency]\n"
+            "                  [-c cycle_limit] <firmware.elf>\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *mcu = NULL, *path = NULL;
+    long vector = -1, marker = -1, text = -1;
+    unsigned long long limit = 20000000000ULL;
+
+    frequency = 16000000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-m") == 0) && (i + 1 < argc))
+        {
+            mcu = argv[++i];
+        }
+        else if ((strcmp(argv[i], "-v") == 0) && (i + 1 < argc))
+        {
+            vector = strtol(argv[++i], NULL, 0);
+        }
+        else if ((strcmp(argv[i], "-g") == 0) && (i + 1 < argc))
+        {
+            marker = strtol(argv[++i], NULL, 0);
+        }
+        else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+        {
+            text = strtol(argv[++i], NULL, 0);
+        }
+        else if ((strcmp(argv[i], "-f") == 0) && (i + 1 < argc))
+        {
+            frequency = (uint32_t) strtoul(argv[++i], NULL, 0);
+        }
+        else if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc))
+        {
+            limit = strtoull(argv[++i], NULL, 0);
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+
+    if (!mcu || !path || (vector < 0) || (marker < 0) || (text < 0))
+    {
+        usage();
+        return 2;
+    }
+
+    elf_firmware_t firmware;
+
+    memset(&firmware, 0, sizeof(firmware));
+
+    if (elf_read_firmware(path, &firmware) != 0)
+    {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return 1;
+    }
+
+    avr_t *avr = avr_make_mcu_by_name(mcu);
+
+    if (!avr)
+    {
+        fprintf(stderr, "simavr has no core for %s\n", mcu);
+        return 1;
+    }
+
+    avr_init(avr);
+    avr->frequency = frequency;
+    avr->vcc = REFERENCE_MV;
+    avr->avcc = REFERENCE_MV;
+    avr->aref = REFERENCE_MV;
+    avr_load_firmware(avr, &firmware);
+    avr->frequency = frequency;
+
+    avr_register_io_write(avr, (avr_io_addr_t) marker, on_marker, NULL);
+    avr_register_io_write(avr, (avr_io_addr_t) text, on_text, NULL);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_OUT_TRIGGER), on_conversion, avr);
+
+    printf("name,channels,sample_count_log2,callbacks,interruptible,median,scans,isr_count,conversions,"
+           "isr_cycles_min,isr_cycles_max,isr_cycles_avg,cycles_per_conversion,isr_load_pct,"
+           "channel_rate_hz\n");
+
+    avr_flashaddr_t vector_pc = (avr_flashaddr_t)(vector * avr->vector_size);
+    avr_cycle_count_t isr_start = 0;
+    uint16_t isr_sp = 0;
+    bool in_isr = false;
+    int state = cpu_Running;
+
+    while (((state == cpu_Running) || (state == cpu_Sleeping)) && !done && (avr->cycle < limit))
+    {
+        state = avr_run(avr);
+
+        uint16_t sp = _avr_sp_get(avr);
+
+        // The ISR has returned once the return address is popped, or is entered again at once.
+        if (in_isr && ((sp > isr_sp) || ((avr->pc == vector_pc) && (sp == isr_sp))))
+        {
+            uint32_t n = (uint32_t)(avr->cycle - isr_start);
+
+            in_isr = false;
+
+            if (measuring)
+            {
+                cycles.isr_total += n;
+                cycles.isr_count++;
+                cycles.isr_min = (n < cycles.isr_min) ? n : cycles.isr_min;
+                cycles.isr_max = (n > cycles.isr_max) ? n : cycles.isr_max;
+            }
+        }
+
+        if (!in_isr && (avr->pc == vector_pc))
+        {
+            in_isr = true;
+            isr_start = avr->cycle;
+            isr_sp = sp;
+        }
+    }
+
+    if (!done)
+    {
+        fprintf(stderr, "Stopped before the sketch finished (state %d, cycle %llu)\n", state,
+                (unsigned long long) avr->cycle);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,42 @@
+# Differences of the ISR cycles between benchmark configurations, from the cycles.csv of the sketch
+# as built and the cycles_wide.csv of the sketch built without the 16-bit accumulator path.
+#
+#   awk -f compare.awk cycles.csv cycles_wide.csv
+#
+# Each comparison is the ISR cycles per conversion of the configuration expected to be more costly
+# minus those of the cheaper one. Configurations averaging 64 samples or more accumulate in all but
+# the few conversions discarded at each channel switch, so the difference is that of the ISR path
+# accumulating a sample.
+
+BEGIN {
+    FS = ","
+
+    # name, cheaper run:configuration, more costly run:configuration
+    comparisons[++count] = "narrow_path_saving,narrow:4ch_log2_6,wide:4ch_log2_6"
+    comparisons[++count] = "median3_cost,narrow:4ch_log2_7,narrow:4ch_log2_7_med3"
+    comparisons[++count] = "median5_cost,narrow:4ch_log2_7,narrow:4ch_log2_7_med5"
+    comparisons[++count] = "median7_cost,narrow:4ch_log2_7,narrow:4ch_log2_7_med7"
+}
+
+FNR == 1 {
+    run = (NR == 1) ? "narrow" : "wide"
+
+    for (i = 1; i <= NF; i++) {
+        column[$i] = i
+    }
+
+    next
+}
+
+{
+    per_conversion[run ":" $1] = $column["cycles_per_conversion"]
+}
+
+END {
+    print "comparison,cycles_per_conversion"
+
+    for (i = 1; i <= count; i++) {
+        split(comparisons[i], c, ",")
+        printf "%s,%.2f\n", c[1], per_conversion[c[3]] - per_conversion[c[2]]
+    }
+}
@@ -0,0 +1,154 @@
+/**
+ * @file Arduino.h
+ * @author Hobbylad ()
+ * @brief Emulated Arduino core for the ScanADC host simulation.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Declares the subset of the Arduino core used by the ScanADC library and its examples. Time is the
+ * simulated time of the peripheral model, and Serial writes to a sink set by the test.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define HIGH            1
+#define LOW             0
+#define INPUT           0
+#define OUTPUT          1
+#define INPUT_PULLUP    2
+#define DEC             10
+#define HEX             16
+
+#define interrupts()    sei()
+#define noInterrupts()  cli()
+
+#if defined(__AVR_ATmega4809__) || defined(__AVR_ATmega4808__) || \
+    defined(__AVR_ATmega3209__) || defined(__AVR_ATmega3208__)
+#define NOT_A_PIN       255
+#else
+#define NOT_A_PIN       0
+#endif
+
+// Pins 0 to 7 are port D and pins 8 to 15 port B, other pins do not exist.
+#define SIM_PORT_B      2
+#define SIM_PORT_D      4
+#define digitalPinToPort(p)         ((uint8_t)(((p) < 8) ? SIM_PORT_D : (((p) < 16) ? SIM_PORT_B : NOT_A_PIN)))
+#define digitalPinToBitMask(p)      ((uint8_t)(1 << ((p) & 7)))
+#define portOutputRegister(port)    (((port) == SIM_PORT_B) ? &PORTB : &PORTD)
+#define portModeRegister(port)      (((port) == SIM_PORT_B) ? &DDRB : &DDRD)
+#define portInputRegister(port)     (((port) == SIM_PORT_B) ? &PINB : &PIND)
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+/**
+ * @brief Formatted output to a byte sink.
+ */
+class Print
+{
+    public:
+
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    virtual int availableForWrite() { return 0; }
+
+    size_t print(const char *s);
+    size_t print(char c);
+    size_t print(unsigned char v, int base = DEC);
+    size_t print(int v, int base = DEC);
+    size_t print(unsigned int v, int base = DEC);
+    size_t print(long v, int base = DEC);
+    size_t print(unsigned long v, int base = DEC);
+    size_t print(double v, int digits = 2);
+    size_t println();
+
+    template <class T> size_t println(T v)
+    {
+        size_t n = print(v);
+
+        return n + println();
+    }
+
+    template <class T> size_t println(T v, int format)
+    {
+        size_t n = print(v, format);
+
+        return n + println();
+    }
+};
+
+/**
+ * @brief Byte stream.
+ */
+class Stream : public Print
+{
+    public:
+
+    virtual int available() = 0;
+    virtual int read() = 0;
+};
+
+/**
+ * @brief Serial port writing to the sink of the peripheral model.
+ */
+class HardwareSerial : public Stream
+{
+    public:
+
+    void begin(unsigned long) {}
+    operator bool() { return true; }
+
+    using Print::write;
+    size_t write(uint8_t c);
+    int availableForWrite();
+    int available();
+    int read();
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * @file interrupt.h
+ * @author Hobbylad ()
+ * @brief Emulated <avr/interrupt.h> for the ScanADC host simulation.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_AVR_INTERRUPT_H
+#define SIM_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+// As in avr-libc, sei() and cli() are only declared here and not by <avr/io.h>.
+#define sei()               (SREG |= (1 << SREG_I))
+#define cli()               (SREG &= (uint8_t) ~(1 << SREG_I))
+
+#define ISR_NOBLOCK
+#define ISR(vector, ...)    extern "C" void vector(void); void vector(void)
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * @file io.h
+ * @author Hobbylad ()
+ * @brief Emulated <avr/io.h> for the ScanADC host simulation.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Emulated registers of the ADC and the peripherals used by the ScanADC library on a Linux host.
+ * The registers of the classic ATmega ADC with Timer1, or of the megaAVR-0 ADC0 peripheral when
+ * compiled for __AVR_ATmega4809__, are variables of the peripheral model in sim/. Flags that are
+ * cleared by writing a one behave as on the device, so read-modify-write bugs show up on the host.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+#include <stdint.h>
+
+/**
+ * @brief Register with flags cleared by writing a one, such as ADCSRA, TIFR1 or ADC0.INTFLAGS.
+ *
+ * Writing replaces the other bits and clears the flags written as one. Flags are set by the model
+ * with set_flags(). Reads are reported to the model so it can let time pass while the library
+ * polls a flag.
+ */
+struct sim_flag_register_t
+{
+    uint8_t value;                              // Register value.
+    uint8_t flags;                              // Bits cleared by writing a one.
+    void (*on_read)(sim_flag_register_t &reg);  // Model hook called on every read or NULL.
+    void (*on_write)(sim_flag_register_t &reg, uint8_t written); // Model hook called after a write or NULL.
+
+    operator uint8_t()
+    {
+        if (on_read)
+        {
+            on_read(*this);
+        }
+
+        return value;
+    }
+
+    sim_flag_register_t &operator=(uint8_t x)
+    {
+        value = (uint8_t)((x & ~flags) | (value & flags & ~x));
+
+        if (on_write)
+        {
+            on_write(*this, x);
+        }
+
+        return *this;
+    }
+
+    sim_flag_register_t &operator|=(uint8_t x)
+    {
+        return *this = (uint8_t)((uint8_t) *this | x);
+    }
+
+    sim_flag_register_t &operator&=(uint8_t x)
+    {
+        return *this = (uint8_t)((uint8_t) *this & x);
+    }
+
+    void set_flags(uint8_t bits)
+    {
+        value |= bits;
+    }
+};
+
+extern volatile uint8_t SREG;
+extern volatile uint8_t PORTB, DDRB, PINB, PORTC, DDRC, PINC, PORTD, DDRD, PIND, PORTF, DDRF, PINF;
+
+#define SREG_I      7
+
+#if defined(__AVR_ATmega4809__) || defined(__AVR_ATmega4808__) || \
+    defined(__AVR_ATmega3209__) || defined(__AVR_ATmega3208__)
+#include "io_megaavr0.h"
+#else
+#include "io_classic.h"
+#endif
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * @file io_classic.h
+ * @author Hobbylad ()
+ * @brief Emulated classic ATmega ADC and Timer1 registers.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Included by <avr/io.h>. The ADC runs from a divided clock, free running or triggered by Timer1
+ * compare match B, and interrupts through ADC_vect as on the ATmega328P, ATmega2560 and ATmega32U4.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_AVR_IO_CLASSIC_H
+#define SIM_AVR_IO_CLASSIC_H
+
+extern sim_flag_register_t ADCSRA;
+extern sim_flag_register_t TIFR1;
+extern volatile uint8_t ADCSRB, ADMUX, ADCL, ADCH, DIDR0, DIDR2;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+extern volatile uint16_t OCR1A, OCR1B, TCNT1;
+
+// ADCSRA
+#define ADPS0       0
+#define ADPS1       1
+#define ADPS2       2
+#define ADIE        3
+#define ADIF        4
+#define ADATE       5
+#define ADSC        6
+#define ADEN        7
+
+// ADCSRB
+#define ADTS0       0
+#define ADTS1       1
+#define ADTS2       2
+#if defined(__AVR_ATmega32U4__) || defined(__AVR_ATmega16U4__)
+#define ADTS3       3
+#define MUX5        5
+#elif defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define MUX5        3
+#endif
+
+// ADMUX
+#define MUX0        0
+#define ADLAR       5
+#define REFS0       6
+#define REFS1       7
+
+// Timer1
+#define CS10        0
+#define CS11        1
+#define CS12        2
+#define WGM12       3
+#define OCIE1A      1
+#define OCF1A       1
+#define OCF1B       2
+
+#define ADC_vect    sim_adc_vect
+
+#endif
@@ -0,0 +1,104 @@
+/**
+ * @file io_megaavr0.h
+ * @author Hobbylad ()
+ * @brief Emulated megaAVR-0 ADC0 registers.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Included by <avr/io.h> for __AVR_ATmega4809__. A conversion is started by ADC0.COMMAND, accumulates
+ * the number of samples set by ADC0.CTRLB in hardware and interrupts through ADC0_RESRDY_vect.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_AVR_IO_MEGAAVR0_H
+#define SIM_AVR_IO_MEGAAVR0_H
+
+#define SIM_MEGAAVR0
+
+/**
+ * @brief Result register, cleared from the result ready flag when read as on the device.
+ */
+struct sim_result_register_t
+{
+    uint16_t value;                             // Accumulated result.
+
+    operator uint16_t();
+};
+
+/**
+ * @brief ADC0 peripheral registers used by the library.
+ */
+typedef struct
+{
+    volatile uint8_t CTRLA;
+    volatile uint8_t CTRLB;
+    volatile uint8_t CTRLC;
+    volatile uint8_t CTRLD;
+    volatile uint8_t CTRLE;
+    volatile uint8_t SAMPCTRL;
+    volatile uint8_t MUXPOS;
+    sim_flag_register_t COMMAND;
+    volatile uint8_t EVCTRL;
+    volatile uint8_t INTCTRL;
+    sim_flag_register_t INTFLAGS;
+    sim_result_register_t RES;
+} ADC_t;
+
+extern ADC_t ADC0;
+
+#define ADC_MUXPOS_AIN0_gc      0x00
+#define ADC_MUXPOS_AIN1_gc      0x01
+#define ADC_MUXPOS_AIN2_gc      0x02
+#define ADC_MUXPOS_AIN3_gc      0x03
+#define ADC_MUXPOS_AIN4_gc      0x04
+#define ADC_MUXPOS_AIN5_gc      0x05
+#define ADC_MUXPOS_AIN6_gc      0x06
+#define ADC_MUXPOS_AIN7_gc      0x07
+#define ADC_MUXPOS_AIN8_gc      0x08
+#define ADC_MUXPOS_AIN9_gc      0x09
+#define ADC_MUXPOS_AIN10_gc     0x0A
+#define ADC_MUXPOS_AIN11_gc     0x0B
+#define ADC_MUXPOS_AIN12_gc     0x0C
+#define ADC_MUXPOS_AIN13_gc     0x0D
+#define ADC_MUXPOS_AIN14_gc     0x0E
+#define ADC_MUXPOS_AIN15_gc     0x0F
+#define ADC_MUXPOS_DACREF_gc    0x1C
+#define ADC_MUXPOS_TEMPSENSE_gc 0x1E
+#define ADC_MUXPOS_GND_gc       0x1F
+
+#define ADC_SAMPNUM_ACC1_gc     0x00
+#define ADC_SAMPNUM_gm          0x07
+#define ADC_SAMPCAP_bm          0x40
+#define ADC_REFSEL_VDDREF_gc    0x10
+#define ADC_PRESC_DIV16_gc      0x03
+#define ADC_PRESC_gm            0x07
+#define ADC_RESRDY_bm           0x01
+#define ADC_RESSEL_10BIT_gc     0x00
+#define ADC_ENABLE_bm           0x01
+#define ADC_STCONV_bm           0x01
+
+#define ADC0_RESRDY_vect        sim_adc_vect
+
+#endif
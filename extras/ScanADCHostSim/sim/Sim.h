@@ -0,0 +1,176 @@
+/**
+ * @file Sim.h
+ * @author Hobbylad ()
+ * @brief Peripheral model of the ScanADC host simulation.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * The peripheral model runs in simulated time driven by the test. sim_run() lets a number of
+ * conversions complete, delivering the ADC interrupt to the unmodified library ISR after each one
+ * when the interrupt is enabled as on the device, so a test is a plain sequence of library calls
+ * and sim_run() calls and runs the same way every time.
+ *
+ * The analogue inputs are programmable signal generators, or a test can take over every input with
+ * a function of the input and time to model sources that react to the library, for instance a pad
+ * charged by a port pin.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+#include <functional>
+
+/**
+ * @brief Signal generator of an analogue input, in ADC codes.
+ *
+ * The input is dc + amplitude * sin(2 pi frequency_hz t + phase_rad) plus uniform noise of peak
+ * noise, and every spike_period conversions of the input the spike is added instead. The level is
+ * rounded and clipped to the 10-bit range.
+ */
+struct sim_generator_t
+{
+    double dc;                                  // Level.
+    double amplitude;                           // Sine peak.
+    double frequency_hz;                        // Sine frequency.
+    double phase_rad;                           // Sine phase at time 0.
+    double noise;                               // Peak of uniform noise from a fixed seed.
+    uint32_t spike_period;                      // Conversions of the input between spikes or 0 for none.
+    double spike;                               // Spike added to the level.
+};
+
+/**
+ * @brief Function of input and time in nanoseconds returning a conversion result.
+ */
+typedef std::function<uint16_t(uint8_t mux, uint64_t t_ns)> sim_signal_t;
+
+/**
+ * @brief Counters of the peripheral model.
+ */
+struct sim_stats_t
+{
+    uint64_t conversions;                       // Conversions completed, one per hardware sample.
+    uint64_t results;                           // Results completed, less than conversions with hardware accumulation.
+    uint64_t interrupts;                        // ADC interrupts delivered.
+    uint64_t overruns;                          // Results overwritten before the interrupt flag was cleared.
+    uint64_t missed_triggers;                   // Timer compare matches that did not start a conversion.
+};
+
+/**
+ * @brief Simulated time in nanoseconds since the model was reset.
+ */
+extern uint64_t sim_time_ns;
+
+/**
+ * @brief Counters since the model was reset.
+ */
+extern sim_stats_t sim_stats;
+
+/**
+ * @brief Function converting every input instead of the generators, or empty to use them.
+ */
+extern sim_signal_t sim_signal;
+
+/**
+ * @brief Serial port free space reported to the library, 64 by default.
+ */
+extern std::function<int()> sim_serial_available_for_write;
+
+/**
+ * @brief Serial port output, discarded by default.
+ */
+extern std::function<void(uint8_t c)> sim_serial_sink;
+
+/**
+ * @brief Resets time, counters, signals and registers to the power on state.
+ */
+void sim_reset();
+
+/**
+ * @brief Sets the signal generator of an analogue input.
+ *
+ * Inputs without a generator convert to ten times their input number.
+ *
+ * @param[in] mux       Hardware value of the analogue input.
+ * @param[in] generator Signal of the input.
+ */
+void sim_set_input(uint8_t mux, const sim_generator_t &generator);
+
+/**
+ * @brief Converts an input with the generators.
+ *
+ * @param[in] mux  Hardware value of the analogue input.
+ * @param[in] t_ns Time of the conversion.
+ * @return uint16_t 10-bit result.
+ */
+uint16_t sim_generate(uint8_t mux, uint64_t t_ns);
+
+/**
+ * @brief Lets results complete, with the ADC interrupt delivered after each one when enabled.
+ *
+ * While the ADC is stopped or waiting for a trigger, each count lets the time of one conversion or
+ * one trigger period pass instead. May be called from a library callback to model conversions
+ * completing during a long callback.
+ *
+ * @param[in] count Results to complete.
+ */
+void sim_run(uint32_t count);
+
+/**
+ * @brief Lets time pass with results completing as in sim_run().
+ *
+ * @param[in] us Time in microseconds.
+ */
+void sim_run_us(uint32_t us);
+
+/**
+ * @brief Runs a library call that busy-waits for the ISR, such as ScanADC::read_injected(), on a
+ * thread while results complete one at a time until it returns.
+ *
+ * The waits of the library spin on variables written by the ISR, so the call runs concurrently as
+ * on the device. Each result completes after a pause long enough for the call to be spinning again.
+ * If the call has not returned after @a limit results it is left spinning and @a limit returned.
+ *
+ * @param[in] call  Library call.
+ * @param[in] limit Results to complete at most.
+ * @return uint32_t Results completed before the call returned.
+ */
+uint32_t sim_run_waiting(const std::function<void()> &call, uint32_t limit);
+
+/**
+ * @brief Get the analogue input latched by the latest conversion.
+ *
+ * @return uint8_t Hardware value of the analogue input.
+ */
+uint8_t sim_latched_mux();
+
+/**
+ * @brief Library ADC Interrupt Service Routine, called by the model.
+ */
+extern "C" void sim_adc_vect(void);
+
+#endif
@@ -0,0 +1,248 @@
+/**
+ * @file SimClassic.cpp
+ * @author Hobbylad ()
+ * @brief Classic ATmega ADC and Timer1 model of the ScanADC host simulation.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Compiled for the classic ATmega devices. A conversion takes 13 ADC clocks of the prescaled CPU
+ * clock and samples its input 1.5 ADC clocks after it starts. With auto-trigger in free running mode
+ * the next conversion starts, latching ADMUX, as soon as one completes, so the input selected by the
+ * ISR is measured from the conversion after next. With Timer1 compare match B as trigger, a conversion
+ * starts only on a rising edge of OCF1B, which stays set until it is cleared by writing a one to
+ * TIFR1, and compare matches while it is set are counted as missed triggers.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Sim.h"
+#include "SimModel.h"
+
+#include "Arduino.h"
+
+#if !defined(SIM_MEGAAVR0)
+
+#define PS_PER_S    1000000000000ULL
+
+static void adcsra_read(sim_flag_register_t &reg);
+static void adcsra_write(sim_flag_register_t &reg, uint8_t written);
+
+sim_flag_register_t ADCSRA = { 0, (1 << ADIF), adcsra_read, adcsra_write };
+sim_flag_register_t TIFR1 = { 0, (1 << OCF1B) | (1 << OCF1A), NULL, NULL };
+volatile uint8_t ADCSRB, ADMUX, ADCL, ADCH, DIDR0, DIDR2;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+volatile uint16_t OCR1A, OCR1B, TCNT1;
+
+static bool converting;                         // Conversion in progress.
+static bool start_pending;                      // ADSC written while idle.
+static uint8_t conv_mux;                        // Input latched by the conversion in progress.
+static uint64_t conv_sample_ns;                 // Sample time of the conversion in progress.
+static uint64_t conv_end_ns;                    // End time of the conversion in progress.
+static uint8_t latched_mux;                     // Input latched by the latest conversion.
+static bool timer_running;                      // Timer1 counting in CTC mode.
+static uint64_t next_match_ps;                  // Time of the next compare match B.
+static uint8_t polls;                           // Consecutive reads polling ADIF.
+
+static uint8_t selected_mux()
+{
+    uint8_t mux = ADMUX & 0x1F;
+
+#if defined(MUX5)
+    if (ADCSRB & (1 << MUX5))
+    {
+        mux |= 0x20;
+    }
+#endif
+
+    return mux;
+}
+
+static uint64_t conversion_ns()
+{
+    uint8_t ps = ADCSRA.value & 0x07;
+    uint64_t prescaler = ps ? (1ULL << ps) : 2;
+
+    return 13 * prescaler * 1000000000ULL / F_CPU;
+}
+
+static bool is_free_running()
+{
+    return (ADCSRA.value & (1 << ADATE)) && !(ADCSRB & 0x07);
+}
+
+static bool is_timer_triggered()
+{
+    return (ADCSRA.value & (1 << ADATE)) && ((ADCSRB & 0x07) == ((1 << ADTS2) | (1 << ADTS0)));
+}
+
+static void start_conversion(uint64_t t_ns)
+{
+    uint8_t ps = ADCSRA.value & 0x07;
+    uint64_t prescaler = ps ? (1ULL << ps) : 2;
+
+    converting = true;
+    conv_mux = latched_mux = selected_mux();
+    conv_sample_ns = t_ns + 3 * prescaler * 1000000000ULL / (2 * F_CPU);
+    conv_end_ns = t_ns + conversion_ns();
+}
+
+static void complete_conversion()
+{
+    sim_time_ns = conv_end_ns;
+    converting = false;
+
+    uint16_t result = sim_convert(conv_mux, conv_sample_ns);
+
+    sim_stats.results++;
+
+    if (ADCSRA.value & (1 << ADIF))
+    {
+        sim_stats.overruns++;
+    }
+
+    ADCL = (uint8_t) result;
+    ADCH = (uint8_t)(result >> 8);
+    ADCSRA.set_flags(1 << ADIF);
+
+    if (is_free_running())
+    {
+        start_conversion(sim_time_ns);
+    }
+}
+
+static void dispatch()
+{
+    if ((ADCSRA.value & (1 << ADIF)) && (ADCSRA.value & (1 << ADIE)) && (SREG & (1 << SREG_I)))
+    {
+        ADCSRA.value &= (uint8_t) ~(1 << ADIF); // Cleared by hardware when the vector is executed.
+        sim_call_isr();
+    }
+}
+
+static void adcsra_read(sim_flag_register_t &reg)
+{
+    // A loop reading ADCSRA with the interrupt disabled waits for ADIF, so the conversion completes.
+    if ((reg.value & (1 << ADEN)) && !(reg.value & ((1 << ADIE) | (1 << ADIF))) &&
+        (converting || start_pending || timer_running) && (++polls >= 2))
+    {
+        polls = 0;
+        sim_model_step();
+    }
+
+    reg.value = (uint8_t)((reg.value & ~(1 << ADSC)) | ((converting || start_pending) ? (1 << ADSC) : 0));
+}
+
+static void adcsra_write(sim_flag_register_t &reg, uint8_t written)
+{
+    polls = 0;
+
+    if (!(reg.value & (1 << ADEN)))
+    {
+        converting = false;
+        start_pending = false;
+    }
+    else if ((written & (1 << ADSC)) && !converting)
+    {
+        start_pending = true;
+    }
+
+    reg.value &= (uint8_t) ~(1 << ADSC);
+}
+
+void sim_model_reset()
+{
+    ADCSRA.value = 0;
+    TIFR1.value = 0;
+    ADCSRB = ADMUX = ADCL = ADCH = DIDR0 = DIDR2 = 0;
+    TCCR1A = TCCR1B = TIMSK1 = 0;
+    OCR1A = OCR1B = TCNT1 = 0;
+
+    converting = false;
+    start_pending = false;
+    latched_mux = 0;
+    timer_running = false;
+    polls = 0;
+}
+
+void sim_model_step()
+{
+    dispatch();
+
+    if (start_pending)
+    {
+        start_pending = false;
+        start_conversion(sim_time_ns);
+    }
+
+    bool counting = ((TCCR1B & 0x07) == (1 << CS10)) && (TCCR1B & (1 << WGM12));
+
+    if (counting && !timer_running)
+    {
+        timer_running = true;
+        next_match_ps = sim_time_ns * 1000 + (uint64_t)(OCR1B + 1) * PS_PER_S / F_CPU;
+    }
+    else if (!counting)
+    {
+        timer_running = false;
+    }
+
+    if (converting)
+    {
+        complete_conversion();
+    }
+    else if (timer_running && (ADCSRA.value & (1 << ADEN)))
+    {
+        // Compare match B at the end of each Timer1 period.
+        sim_time_ns = next_match_ps / 1000;
+        next_match_ps += (uint64_t)(OCR1A + 1) * PS_PER_S / F_CPU;
+
+        if (TIFR1.value & (1 << OCF1B))
+        {
+            sim_stats.missed_triggers++;
+        }
+        else
+        {
+            TIFR1.set_flags((1 << OCF1B) | (1 << OCF1A));
+
+            if (is_timer_triggered())
+            {
+                start_conversion(sim_time_ns);
+                complete_conversion();
+            }
+        }
+    }
+    else
+    {
+        sim_time_ns += conversion_ns();
+    }
+
+    dispatch();
+}
+
+uint8_t sim_latched_mux()
+{
+    return latched_mux;
+}
+
+#endif
@@ -0,0 +1,320 @@
+/**
+ * @file SimCore.cpp
+ * @author Hobbylad ()
+ * @brief Common part of the ScanADC host simulation.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Time, signal generators, interrupt delivery and the Arduino core functions shared by the classic
+ * ATmega and megaAVR-0 peripheral models.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Sim.h"
+#include "SimModel.h"
+
+#include "Arduino.h"
+
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define SIM_INPUTS  64                          // Hardware input values with a generator.
+
+volatile uint8_t SREG;
+volatile uint8_t PORTB, DDRB, PINB, PORTC, DDRC, PINC, PORTD, DDRD, PIND, PORTF, DDRF, PINF;
+
+uint64_t sim_time_ns;
+sim_stats_t sim_stats;
+sim_signal_t sim_signal;
+std::function<int()> sim_serial_available_for_write;
+std::function<void(uint8_t c)> sim_serial_sink;
+
+HardwareSerial Serial;
+
+static sim_generator_t generators[SIM_INPUTS];
+static bool generated[SIM_INPUTS];
+static uint32_t input_conversions[SIM_INPUTS];
+static uint32_t noise_state;
+
+void sim_reset()
+{
+    sim_time_ns = 0;
+    sim_stats = sim_stats_t();
+    sim_signal = NULL;
+    sim_serial_available_for_write = NULL;
+    sim_serial_sink = NULL;
+
+    for (uint8_t i = 0; i < SIM_INPUTS; i++)
+    {
+        generated[i] = false;
+        input_conversions[i] = 0;
+    }
+
+    noise_state = 1;
+
+    SREG = (1 << SREG_I);                      // Interrupts are enabled by the Arduino core.
+    PORTB = DDRB = PINB = PORTC = DDRC = PINC = PORTD = DDRD = PIND = PORTF = DDRF = PINF = 0;
+
+    sim_model_reset();
+}
+
+void sim_set_input(uint8_t mux, const sim_generator_t &generator)
+{
+    if (mux < SIM_INPUTS)
+    {
+        generators[mux] = generator;
+        generated[mux] = true;
+        input_conversions[mux] = 0;
+    }
+}
+
+uint16_t sim_generate(uint8_t mux, uint64_t t_ns)
+{
+    if ((mux >= SIM_INPUTS) || !generated[mux])
+    {
+        return (uint16_t)((mux * 10) & 0x3FF);
+    }
+
+    const sim_generator_t &g = generators[mux];
+    double t = t_ns * 1e-9;
+    double level = g.dc + g.amplitude * sin(2.0 * M_PI * g.frequency_hz * t + g.phase_rad);
+
+    if (g.noise != 0.0)
+    {
+        // Park-Miller generator, so the noise is the same on every run.
+        noise_state = (uint32_t)(((uint64_t) noise_state * 48271) % 2147483647);
+        level += g.noise * (2.0 * noise_state / 2147483647.0 - 1.0);
+    }
+
+    if (g.spike_period && ((++input_conversions[mux] % g.spike_period) == 0))
+    {
+        level += g.spike;
+    }
+
+    if (level < 0.0)
+    {
+        return 0;
+    }
+
+    return (level > 1023.0) ? 1023 : (uint16_t) lround(level);
+}
+
+uint16_t sim_convert(uint8_t mux, uint64_t t_ns)
+{
+    uint16_t result = sim_signal ? sim_signal(mux, t_ns) : sim_generate(mux, t_ns);
+
+    sim_stats.conversions++;
+
+    return (result > 1023) ? 1023 : result;
+}
+
+void sim_call_isr()
+{
+    SREG &= (uint8_t) ~(1 << SREG_I);
+    sim_stats.interrupts++;
+
+    sim_adc_vect();
+
+    SREG |= (1 << SREG_I);
+}
+
+void sim_run(uint32_t count)
+{
+    while (count--)
+    {
+        sim_model_step();
+    }
+}
+
+void sim_run_us(uint32_t us)
+{
+    uint64_t end_ns = sim_time_ns + (uint64_t) us * 1000;
+
+    while (sim_time_ns < end_ns)
+    {
+        sim_model_step();
+    }
+}
+
+uint32_t sim_run_waiting(const std::function<void()> &call, uint32_t limit)
+{
+    std::atomic<bool> done(false);
+    std::thread waiter([&call, &done]() { call(); done = true; });
+    uint32_t count = 0;
+
+    for (;;)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+        if (done || (count == limit))
+        {
+            break;
+        }
+
+        sim_model_step();
+        count++;
+    }
+
+    if (done)
+    {
+        waiter.join();
+    }
+    else
+    {
+        waiter.detach();
+    }
+
+    return count;
+}
+
+unsigned long millis()
+{
+    return (unsigned long)(sim_time_ns / 1000000);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)(sim_time_ns / 1000);
+}
+
+void delay(unsigned long ms)
+{
+    sim_run_us(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    sim_run_us(us);
+}
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+int digitalRead(uint8_t)
+{
+    return HIGH;
+}
+
+void digitalWrite(uint8_t, uint8_t)
+{
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+
+    while (size--)
+    {
+        n += write(*buffer++);
+    }
+
+    return n;
+}
+
+size_t Print::print(const char *s)
+{
+    return write((const uint8_t *) s, strlen(s));
+}
+
+size_t Print::print(char c)
+{
+    return write((uint8_t) c);
+}
+
+size_t Print::print(unsigned char v, int base)
+{
+    return print((unsigned long) v, base);
+}
+
+size_t Print::print(int v, int base)
+{
+    return print((long) v, base);
+}
+
+size_t Print::print(unsigned int v, int base)
+{
+    return print((unsigned long) v, base);
+}
+
+size_t Print::print(long v, int base)
+{
+    char s[24];
+
+    snprintf(s, sizeof(s), (base == HEX) ? "%lX" : "%ld", v);
+
+    return print(s);
+}
+
+size_t Print::print(unsigned long v, int base)
+{
+    char s[24];
+
+    snprintf(s, sizeof(s), (base == HEX) ? "%lX" : "%lu", v);
+
+    return print(s);
+}
+
+size_t Print::print(double v, int digits)
+{
+    char s[48];
+
+    snprintf(s, sizeof(s), "%.*f", digits, v);
+
+    return print(s);
+}
+
+size_t Print::println()
+{
+    return print("\r\n");
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    if (sim_serial_sink)
+    {
+        sim_serial_sink(c);
+    }
+
+    return 1;
+}
+
+int HardwareSerial::availableForWrite()
+{
+    return sim_serial_available_for_write ? sim_serial_available_for_write() : 64;
+}
+
+int HardwareSerial::available()
+{
+    return 0;
+}
+
+int HardwareSerial::read()
+{
+    return -1;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file SimMegaAVR0.cpp
+ * @author Hobbylad ()
+ * @brief megaAVR-0 ADC0 model of the ScanADC host simulation.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Compiled for megaAVR-0 devices. Writing STCONV to ADC0.COMMAND starts a conversion of the input in
+ * ADC0.MUXPOS accumulating 2^SAMPNUM samples of 13 ADC clocks each, with the sum in ADC0.RES and the
+ * RESRDY flag set when the last sample completes. RESRDY is cleared by reading ADC0.RES or by writing a
+ * one to ADC0.INTFLAGS, and is not cleared by executing the vector.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Sim.h"
+#include "SimModel.h"
+
+#include "Arduino.h"
+
+#if defined(SIM_MEGAAVR0)
+
+static void command_write(sim_flag_register_t &reg, uint8_t written);
+static void intflags_read(sim_flag_register_t &reg);
+
+ADC_t ADC0;
+
+static bool converting;                         // Conversion in progress.
+static uint8_t conv_mux;                        // Input latched by the conversion in progress.
+static uint8_t conv_samples_log2;               // Log 2 of samples accumulated by the conversion in progress.
+static uint64_t conv_start_ns;                  // Start time of the conversion in progress.
+static uint8_t latched_mux;                     // Input latched by the latest conversion.
+static uint8_t polls;                           // Consecutive reads polling RESRDY.
+
+sim_result_register_t::operator uint16_t()
+{
+    ADC0.INTFLAGS.value &= (uint8_t) ~ADC_RESRDY_bm;
+
+    return value;
+}
+
+static uint64_t sample_ns()
+{
+    return 13 * (2ULL << (ADC0.CTRLC & ADC_PRESC_gm)) * 1000000000ULL / F_CPU;
+}
+
+static void command_write(sim_flag_register_t &reg, uint8_t written)
+{
+    if ((written & ADC_STCONV_bm) && (ADC0.CTRLA & ADC_ENABLE_bm) && !converting)
+    {
+        converting = true;
+        conv_mux = latched_mux = ADC0.MUXPOS;
+        conv_samples_log2 = ADC0.CTRLB & ADC_SAMPNUM_gm;
+        conv_start_ns = sim_time_ns;
+    }
+
+    reg.value = converting ? ADC_STCONV_bm : 0;
+}
+
+static void intflags_read(sim_flag_register_t &reg)
+{
+    // A loop reading INTFLAGS with the interrupt disabled waits for RESRDY, so the conversion completes.
+    if (converting && !ADC0.INTCTRL && !(reg.value & ADC_RESRDY_bm) && (++polls >= 2))
+    {
+        polls = 0;
+        sim_model_step();
+    }
+}
+
+static void dispatch()
+{
+    if ((ADC0.INTFLAGS.value & ADC_RESRDY_bm) && (ADC0.INTCTRL & ADC_RESRDY_bm) && (SREG & (1 << SREG_I)))
+    {
+        sim_call_isr();
+    }
+}
+
+void sim_model_reset()
+{
+    ADC0.CTRLA = ADC0.CTRLB = ADC0.CTRLC = ADC0.CTRLD = ADC0.CTRLE = ADC0.SAMPCTRL = ADC0.MUXPOS = 0;
+    ADC0.COMMAND.value = 0;
+    ADC0.COMMAND.flags = 0;
+    ADC0.COMMAND.on_read = NULL;
+    ADC0.COMMAND.on_write = command_write;
+    ADC0.EVCTRL = ADC0.INTCTRL = 0;
+    ADC0.INTFLAGS.value = 0;
+    ADC0.INTFLAGS.flags = ADC_RESRDY_bm;
+    ADC0.INTFLAGS.on_read = intflags_read;
+    ADC0.INTFLAGS.on_write = NULL;
+    ADC0.RES.value = 0;
+
+    converting = false;
+    latched_mux = 0;
+    polls = 0;
+}
+
+void sim_model_step()
+{
+    polls = 0;
+
+    dispatch();
+
+    if (converting && (ADC0.CTRLA & ADC_ENABLE_bm))
+    {
+        uint16_t samples = (uint16_t)(1 << conv_samples_log2);
+        uint16_t sum = 0;
+
+        for (uint16_t i = 0; i < samples; i++)
+        {
+            sum += sim_convert(conv_mux, conv_start_ns + i * sample_ns() + sample_ns() / 8);
+        }
+
+        converting = false;
+        ADC0.COMMAND.value = 0;
+        sim_time_ns = conv_start_ns + samples * sample_ns();
+        sim_stats.results++;
+
+        if (ADC0.INTFLAGS.value & ADC_RESRDY_bm)
+        {
+            sim_stats.overruns++;
+        }
+
+        ADC0.RES.value = sum;
+        ADC0.INTFLAGS.set_flags(ADC_RESRDY_bm);
+    }
+    else
+    {
+        converting = false;
+        sim_time_ns += sample_ns();
+    }
+
+    dispatch();
+}
+
+uint8_t sim_latched_mux()
+{
+    return latched_mux;
+}
+
+#endif
@@ -0,0 +1,64 @@
+/**
+ * @file SimModel.h
+ * @author Hobbylad ()
+ * @brief Internal interface of the ScanADC host simulation peripheral models.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Interface between the common part of the model in SimCore.cpp and the ADC peripheral of the
+ * device compiled for in SimClassic.cpp or SimMegaAVR0.cpp.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIM_MODEL_H
+#define SIM_MODEL_H
+
+#include <stdint.h>
+
+/**
+ * @brief Resets the ADC peripheral registers and state.
+ */
+void sim_model_reset();
+
+/**
+ * @brief Completes the next result, or lets the time of one conversion or trigger period pass.
+ */
+void sim_model_step();
+
+/**
+ * @brief Converts an input at a time with the signal function or generators.
+ *
+ * @param[in] mux  Hardware value of the analogue input.
+ * @param[in] t_ns Time of the sample.
+ * @return uint16_t 10-bit result.
+ */
+uint16_t sim_convert(uint8_t mux, uint64_t t_ns);
+
+/**
+ * @brief Delivers the ADC interrupt with interrupts disabled during the ISR, as by the CPU.
+ */
+void sim_call_isr();
+
+#endif
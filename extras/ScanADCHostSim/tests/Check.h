@@ -0,0 +1,69 @@
+/**
+ * @file Check.h
+ * @author Hobbylad ()
+ * @brief Checks of the ScanADC host simulation tests.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Each test is a program that prints the failed checks and exits with a non-zero status if any
+ * check failed.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+static int check_failures;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); check_failures++; } } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { long long a_ = (long long)(a), b_ = (long long)(b); \
+         if (a_ != b_) { printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, a_, b_); \
+                         check_failures++; } } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+    do { double a_ = (double)(a), b_ = (double)(b); \
+         if ((a_ - b_ > (tolerance)) || (b_ - a_ > (tolerance))) \
+         { printf("%s:%d: CHECK_NEAR(%s, %s, %s) failed: %g != %g\n", __FILE__, __LINE__, #a, #b, #tolerance, a_, b_); \
+           check_failures++; } } while (0)
+
+/**
+ * @brief Prints the outcome of a test.
+ *
+ * @param[in] name Test name.
+ * @return int Exit status of the test.
+ */
+static inline int check_result(const char *name)
+{
+    printf("%s: %s\n", name, check_failures ? "FAILED" : "passed");
+
+    return check_failures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * @file test_accumulation.cpp
+ * @author Hobbylad ()
+ * @brief Conversions and interrupts per scan with and without hardware accumulation.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * On megaAVR-0 the ADC0 accumulator sums up to 64 samples per result, so a scan costs one interrupt per
+ * 64 samples of each channel and no conversions are discarded when switching inputs. On the classic
+ * devices every conversion interrupts and one conversion is discarded per channel while the input
+ * selected for the conversion after next is latched.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+static uint64_t scan_conversions[2], scan_interrupts[2];
+static int scans;
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    const ScanADC::channel_config_t config[] =
+    {
+        { ScanADC::MUX_ADC7, 8 },
+        { ScanADC::MUX_ADC6, 0 },
+        { ScanADC::MUX_ADC5, 6 },
+        { ScanADC::MUX_ADC4, 3 },
+    };
+
+    sim_reset();
+    sim_set_input(ScanADC::MUX_ADC7, { 300.0, 0.0, 0.0, 0.0, 40.0 });
+    sim_set_input(ScanADC::MUX_ADC5, { 900.0, 0.0, 0.0, 0.0, 40.0 });
+
+    adc.attach_scan_callback([](const uint16_t *)
+    {
+        if (scans < 2)
+        {
+            scan_conversions[scans] = sim_stats.conversions;
+            scan_interrupts[scans] = sim_stats.interrupts;
+        }
+
+        scans++;
+    });
+
+    adc.begin(config, 4);
+
+    sim_run_us(30000);
+
+    CHECK(scans >= 3);
+
+    uint64_t conversions = scan_conversions[1] - scan_conversions[0];
+    uint64_t interrupts = scan_interrupts[1] - scan_interrupts[0];
+
+#if defined(SIM_MEGAAVR0)
+    CHECK_EQ(conversions, 256 + 1 + 64 + 8);
+    CHECK_EQ(interrupts, 4 + 1 + 1 + 1);
+#else
+    CHECK_EQ(conversions, 256 + 1 + 64 + 8 + 4);
+    CHECK_EQ(interrupts, conversions);
+#endif
+
+    CHECK_NEAR(adc.get_sample(0), 300, 3);
+    CHECK_EQ(adc.get_sample(1), sim_generate(ScanADC::MUX_ADC6, 0));
+    CHECK_NEAR(adc.get_sample(2), 900, 6);
+    CHECK_EQ(adc.get_sample(3), sim_generate(ScanADC::MUX_ADC4, 0));
+    CHECK_EQ(sim_stats.overruns, 0);
+
+    adc.end();
+
+    return check_result("test_accumulation");
+}
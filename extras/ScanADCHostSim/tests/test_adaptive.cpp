@@ -0,0 +1,92 @@
+/**
+ * @file test_adaptive.cpp
+ * @author Hobbylad ()
+ * @brief Adaptive averaging.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * An adaptive channel averages its maximum sample count while the input is steady, drops to its
+ * minimum count as soon as the input changes by the activity threshold and then climbs back.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+static uint16_t level = 500;
+static uint8_t min_log2 = 0xFF;
+static uint16_t first_sample_after_step;
+static bool stepped;
+
+static void on_channel(uint8_t, uint16_t sample)
+{
+    uint8_t log2 = ScanADC::getInstance().get_sample_count_log2(0);
+
+    if (stepped)
+    {
+        if (log2 < min_log2)
+        {
+            min_log2 = log2;
+            first_sample_after_step = sample;
+        }
+    }
+}
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    const ScanADC::channel_config_t config[] = { { ScanADC::MUX_ADC7, 8, 2, 4 } };
+
+    sim_reset();
+
+    // Steady level with one code of dither below the threshold.
+    sim_signal = [](uint8_t, uint64_t t_ns) -> uint16_t { return level + ((t_ns / 13000) & 1); };
+
+    adc.attach_channel_callback(on_channel);
+    adc.begin(config, 1);
+
+    sim_run(4000);
+
+    CHECK_EQ(adc.get_sample_count_log2(0), 8);
+    CHECK_NEAR(adc.get_sample(0), 500, 1);
+
+    level = 700;
+    stepped = true;
+
+    sim_run(300);
+
+    CHECK_EQ(min_log2, 2);
+    CHECK_NEAR(first_sample_after_step, 700, 1);
+
+    sim_run(4000);
+
+    CHECK_EQ(adc.get_sample_count_log2(0), 8);
+    CHECK_NEAR(adc.get_sample(0), 700, 1);
+
+    adc.end();
+
+    return check_result("test_adaptive");
+}
@@ -0,0 +1,85 @@
+/**
+ * @file test_basic.cpp
+ * @author Hobbylad ()
+ * @brief Scans of the default group.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Channels are measured in scan order with the selected input measured from the conversion after
+ * next, so every channel reads exactly its own input, averaged over its sample count, and the ADC is
+ * stopped by end().
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    const ScanADC::channel_config_t config[] =
+    {
+        { ScanADC::MUX_ADC7, 8 },
+        { ScanADC::MUX_ADC6, 0 },
+        { ScanADC::MUX_ADC5, 3 },
+        { ScanADC::MUX_ADC4, 8 },
+    };
+
+    sim_reset();
+    sim_set_input(ScanADC::MUX_ADC4, { 400.4, 0.0, 0.0, 0.0, 0.5 });
+
+    adc.begin(config, 4);
+
+    sim_run_us(40000);
+
+    CHECK_EQ(adc.get_sample(0), sim_generate(ScanADC::MUX_ADC7, 0));
+    CHECK_EQ(adc.get_sample(1), sim_generate(ScanADC::MUX_ADC6, 0));
+    CHECK_EQ(adc.get_sample(2), sim_generate(ScanADC::MUX_ADC5, 0));
+    CHECK_NEAR(adc.get_sample(3), 400, 1);
+    CHECK_EQ(adc.get_sample_count_log2(0), 8);
+    CHECK_EQ(adc.get_sample_count_log2(2), 3);
+
+    // About 3077 conversions of 521 samples per scan.
+    CHECK(adc.get_sn(0) >= 5);
+    CHECK(adc.get_sn(0) <= 6);
+    CHECK(adc.get_sn(1) == adc.get_sn(0));
+    CHECK(adc.get_sn(3) + 1 >= adc.get_sn(0));
+
+    // Back to back conversions of 13 ADC clocks of 1us.
+    CHECK_EQ(sim_time_ns, sim_stats.conversions * 13000);
+    CHECK_EQ(sim_stats.interrupts, sim_stats.results);
+    CHECK_EQ(sim_stats.overruns, 0);
+
+    adc.end();
+
+    uint64_t results = sim_stats.results;
+
+    sim_run(100);
+
+    CHECK_EQ(sim_stats.results, results);
+
+    return check_result("test_basic");
+}
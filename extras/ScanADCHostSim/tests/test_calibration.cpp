@@ -0,0 +1,214 @@
+/**
+ * @file test_calibration.cpp
+ * @author Hobbylad ()
+ * @brief Axis calibration tables.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * The table mapping is compared against the floating point formula over every 10-bit sample for a
+ * captured and a built calibration, within 1 step of an output to 1023 at 30% expo and within 0.4%
+ * of an output to 2000 at 100% expo, with the endpoints and center exact. Ranges beyond the deadzone
+ * shorter than SCAN_CALIBRATION_MIN_RANGE are rejected by build() and capture_end() and the minimum
+ * range is exact. A table printed by print() is parsed back and used from PROGMEM.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Arduino.h"
+#include "ScanCalibration.h"
+#include "Sim.h"
+#include "Check.h"
+
+#include <string>
+
+/**
+ * @brief Calibration formula in floating point.
+ */
+static double expected(const ScanCalibration::calibration_t &c, int sample)
+{
+    double n = 0.0;
+    int d = sample - c.center;
+
+    if (d > (int) c.deadzone)
+    {
+        n = (double)(d - c.deadzone) / (c.max - c.center - c.deadzone);
+    }
+    else if (d < -(int) c.deadzone)
+    {
+        n = (double)(d + c.deadzone) / (c.center - c.min - c.deadzone);
+    }
+
+    n = (n > 1.0) ? 1.0 : ((n < -1.0) ? -1.0 : n);
+
+    double expo = c.expo / 100.0;
+    double y = (1.0 - expo) * n + expo * n * n * n;
+
+    return c.out_max / 2.0 * (1.0 + y);
+}
+
+// Checks the endpoints, beyond them and the center map exactly.
+static void check_endpoints(const ScanCalibration &calibration, const ScanCalibration::calibration_t &c)
+{
+    CHECK_EQ(calibration.apply(c.min), 0);
+    CHECK_EQ(calibration.apply(c.max), c.out_max);
+    CHECK_EQ(calibration.apply(c.center), (c.out_max + 1) / 2);
+
+    if (c.min > 0)
+    {
+        CHECK_EQ(calibration.apply(c.min - 1), 0);
+    }
+
+    if (c.max < 1023)
+    {
+        CHECK_EQ(calibration.apply(c.max + 1), c.out_max);
+    }
+}
+
+static int max_error(const ScanCalibration &calibration, const ScanCalibration::calibration_t &c)
+{
+    int worst = 0;
+
+    for (int sample = 0; sample < 1024; sample++)
+    {
+        int error = abs((int) calibration.apply(sample) - (int) lround(expected(c, sample)));
+
+        worst = (error > worst) ? error : worst;
+    }
+
+    return worst;
+}
+
+int main()
+{
+    static uint16_t table[SCAN_CALIBRATION_TABLE_SIZE];
+    ScanCalibration calibration;
+
+    sim_reset();
+
+    CHECK_EQ(calibration.apply(123), 123);
+
+    calibration.capture_begin();
+
+    for (int sample = 480; sample < 520; sample++)
+    {
+        calibration.capture(sample);
+    }
+
+    CHECK(calibration.capture_end(500, 8, 30, 1023, table));
+
+    const ScanCalibration::calibration_t captured = { 480, 500, 519, 8, 30, 1023 };
+
+    CHECK(max_error(calibration, captured) <= 1);
+    check_endpoints(calibration, captured);
+    CHECK_NEAR(calibration.apply(505), 511.5, 0.5);
+
+    const ScanCalibration::calibration_t built = { 40, 530, 990, 20, 30, 1023 };
+
+    CHECK(ScanCalibration::build(table, built));
+    calibration.begin(table);
+
+    CHECK(max_error(calibration, built) <= 1);
+    check_endpoints(calibration, built);
+
+    // The full cubic curve on a wide output is within 0.4% of the maximum output.
+    const ScanCalibration::calibration_t cubic = { 40, 530, 990, 20, 100, 2000 };
+
+    CHECK(ScanCalibration::build(table, cubic));
+    calibration.begin(table);
+
+    CHECK(max_error(calibration, cubic) <= 2000 * 4 / 1000);
+    check_endpoints(calibration, cubic);
+
+    // Ranges beyond the deadzone too short to reach full scale are rejected on either side, leaving
+    // the table in use, and the minimum range is exact.
+    for (int range = 1; range < SCAN_CALIBRATION_MIN_RANGE; range++)
+    {
+        const ScanCalibration::calibration_t upper = { 40, 530, (uint16_t)(550 + range), 20, 30, 1023 };
+        const ScanCalibration::calibration_t lower = { (uint16_t)(510 - range), 530, 990, 20, 30, 1023 };
+
+        CHECK(!ScanCalibration::build(table, upper));
+        CHECK(!ScanCalibration::build(table, lower));
+        check_endpoints(calibration, cubic);
+
+        calibration.capture_begin();
+        calibration.capture(upper.min);
+        calibration.capture(upper.max);
+
+        CHECK(!calibration.capture_end(upper.center, upper.deadzone, upper.expo, upper.out_max, table));
+        check_endpoints(calibration, cubic);
+    }
+
+    const ScanCalibration::calibration_t shortest = { 505, 530, 555, 20, 30, 1023 };
+
+    CHECK(ScanCalibration::build(table, shortest));
+    calibration.begin(table);
+
+    check_endpoints(calibration, shortest);
+
+    // Without movement on a side the capture is rejected.
+    calibration.capture_begin();
+    calibration.capture(600);
+
+    CHECK(!calibration.capture_end(500, 8, 30, 1023, table));
+    check_endpoints(calibration, shortest);
+
+    ScanCalibration::build(table, built);
+    calibration.begin(table);
+
+    std::string printed;
+
+    sim_serial_sink = [&printed](uint8_t c) { printed += (char) c; };
+    calibration.print(Serial, "table");
+
+    // Parse the initializer back into a table used as PROGMEM.
+    static uint16_t parsed[SCAN_CALIBRATION_TABLE_SIZE];
+    size_t pos = printed.find('{');
+    int count = 0;
+
+    CHECK(printed.find("table[SCAN_CALIBRATION_TABLE_SIZE] PROGMEM =") != std::string::npos);
+
+    while ((pos != std::string::npos) && (count < SCAN_CALIBRATION_TABLE_SIZE))
+    {
+        pos = printed.find_first_of("0123456789", pos);
+
+        if (pos != std::string::npos)
+        {
+            parsed[count++] = (uint16_t) strtoul(printed.c_str() + pos, NULL, 10);
+            pos = printed.find_first_not_of("0123456789", pos);
+        }
+    }
+
+    CHECK_EQ(count, SCAN_CALIBRATION_TABLE_SIZE);
+
+    ScanCalibration progmem;
+
+    progmem.begin_P(parsed);
+
+    for (int sample = 0; sample < 1024; sample += 7)
+    {
+        CHECK_EQ(progmem.apply(sample), calibration.apply(sample));
+    }
+
+    return check_result("test_calibration");
+}
@@ -0,0 +1,101 @@
+/**
+ * @file test_deferred.cpp
+ * @author Hobbylad ()
+ * @brief Deferred callbacks.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Deferred callbacks are called from poll() instead of the ISR, coalesced to the latest sample of each
+ * channel when poll() is called less often than channels complete.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+static int channel_calls[3], scan_calls;
+static uint16_t channel_samples[3];
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    const ScanADC::channel_config_t config[] = { { ScanADC::MUX_ADC7, 2 }, { ScanADC::MUX_ADC6, 2 }, { ScanADC::MUX_ADC5, 2 } };
+
+    sim_reset();
+
+    adc.attach_channel_callback([](uint8_t channel, uint16_t sample) { channel_calls[channel]++; channel_samples[channel] = sample; });
+    adc.attach_scan_callback([](const uint16_t *) { scan_calls++; });
+    adc.set_deferred(true);
+    adc.begin(config, 3);
+
+    sim_run(100);
+
+    CHECK_EQ(channel_calls[0], 0);
+    CHECK_EQ(scan_calls, 0);
+    CHECK(adc.get_sn(2) >= 3);
+
+    adc.poll();
+
+    // Coalesced to one call per channel and scan.
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        CHECK_EQ(channel_calls[i], 1);
+    }
+
+    CHECK_EQ(channel_samples[0], sim_generate(ScanADC::MUX_ADC7, 0));
+    CHECK_EQ(channel_samples[2], sim_generate(ScanADC::MUX_ADC5, 0));
+    CHECK_EQ(scan_calls, 1);
+    CHECK(adc.get_coalesced_count() > 0);
+
+    adc.poll();
+
+    CHECK_EQ(channel_calls[0], 1);
+
+    uint8_t sn = adc.get_sn(0);
+    uint8_t scan_sn = adc.get_sn(2);
+
+    for (int i = 0; i < 50; i++)
+    {
+        sim_run_us(65);
+        adc.poll();
+    }
+
+    // Polled more often than the scans complete.
+    CHECK_EQ(channel_calls[0], 1 + (uint8_t)(adc.get_sn(0) - sn));
+    CHECK_EQ(scan_calls, 1 + (uint8_t)(adc.get_sn(2) - scan_sn));
+
+    adc.set_deferred(false);
+
+    int calls = channel_calls[0];
+
+    sim_run(100);
+
+    CHECK(channel_calls[0] > calls);
+
+    adc.end();
+
+    return check_result("test_deferred");
+}
@@ -0,0 +1,183 @@
+/**
+ * @file test_extmux.cpp
+ * @author Hobbylad ()
+ * @brief External multiplexer channels.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Channels behind an external multiplexer are scanned grouped by address with the select lines written
+ * once per address in each scan, leaving the other pins of the port as they were. The multiplexer
+ * output follows the select lines one conversion late, so every sample is only of its own address if
+ * the switch is covered by a discarded conversion, which on megaAVR-0 devices is the settle begin()
+ * forces. ScanADC::wait_scan() returns once the last channel in scan order has completed, and the
+ * settling of an input behind the multiplexer is measured with its address selected.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+#include <math.h>
+
+static uint8_t order[6], order_n;
+static uint8_t latched;
+static double hold;
+
+static uint8_t address(uint8_t port)
+{
+    return (port >> 4) & 7;
+}
+
+// Level of an input behind the multiplexer at the address it was switched to by the conversion before.
+static uint16_t delayed_signal(uint8_t mux, uint64_t)
+{
+    uint8_t port = latched;
+
+    latched = PORTB;
+
+    return (mux == ScanADC::MUX_ADC7) ? (uint16_t)(100 + 50 * address(port)) : (uint16_t)(mux * 10);
+}
+
+// Input behind address 3 charging the sample and hold by 40% of the difference per conversion.
+static uint16_t slow_signal(uint8_t mux, uint64_t)
+{
+    double level = (mux == ScanADC::MUX_ADC7) ? ((address(PORTB) == 3) ? 600.0 : 100.0 + 50 * address(PORTB)) :
+                   (mux == ScanADC::MUX_0V0) ? 0.0 :
+                   (mux <= ScanADC::MUX_ADC7) ? mux * 10.0 : 225.0;
+    double kept = ((mux == ScanADC::MUX_ADC7) && (address(PORTB) == 3)) ? 0.6 : 0.0;
+
+    hold = level + (hold - level) * kept;
+
+    return (uint16_t) lround(hold);
+}
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    ScanADC::channel_config_t config[6] = {};
+
+    config[0].mux = ScanADC::MUX_ADC7;
+    config[0].mode = ScanADC::CHANNEL_EXT_MUX;
+    config[0].mode_arg = 3;
+    config[1].mux = ScanADC::MUX_ADC6;
+    config[2].mux = ScanADC::MUX_ADC7;
+    config[2].mode = ScanADC::CHANNEL_EXT_MUX;
+    config[2].mode_arg = 1;
+    config[2].sample_count_log2 = 2;
+    config[3].mux = ScanADC::MUX_ADC7;
+    config[3].mode = ScanADC::CHANNEL_EXT_MUX;
+    config[3].mode_arg = 3;
+    config[3].settle = 2;
+    config[4].mux = ScanADC::MUX_ADC7;
+    config[4].mode = ScanADC::CHANNEL_EXT_MUX;
+    config[4].mode_arg = 0;
+    config[4].median = 3;
+    config[5].mux = ScanADC::MUX_ADC5;
+
+    sim_reset();
+    PORTB = 0x05;
+    DDRB = 0x01;
+    latched = PORTB;
+    sim_signal = delayed_signal;
+
+    adc.set_external_mux(&PORTB, &DDRB, 4, 3);
+
+    CHECK_EQ(DDRB, 0x71);
+
+    adc.attach_channel_callback([](uint8_t channel, uint16_t)
+    {
+        if (order_n < 6)
+        {
+            order[order_n++] = channel;
+        }
+    });
+
+    adc.begin(config, 6);
+    sim_run(200);
+
+    // Channels without the multiplexer first, then by address.
+    const uint8_t expected_order[6] = { 1, 5, 4, 2, 0, 3 };
+
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        CHECK_EQ(order[i], expected_order[i]);
+    }
+
+    CHECK_EQ(adc.get_sample(0), 250);
+    CHECK_EQ(adc.get_sample(1), 60);
+    CHECK_EQ(adc.get_sample(2), 150);
+    CHECK_EQ(adc.get_sample(3), 250);
+    CHECK_EQ(adc.get_sample(4), 100);
+    CHECK_EQ(adc.get_sample(5), 50);
+
+    uint8_t changes = 0, last_port = PORTB, sn = adc.get_sn(5);
+
+    for (int i = 0; i < 400; i++)
+    {
+        sim_run(1);
+
+        changes += (PORTB != last_port);
+        last_port = PORTB;
+    }
+
+    CHECK((uint8_t)(adc.get_sn(5) - sn) >= 5);
+    CHECK_NEAR(changes, 3 * (uint8_t)(adc.get_sn(5) - sn), 3);
+    CHECK_EQ(PORTB & 0x0F, 0x05);
+
+    // The scan in progress has completed once channel 3, the last in scan order, has a new sample.
+    for (int i = 0; i < 6; i++)
+    {
+        sim_run(i);
+
+        uint8_t last_sn = adc.get_sn(3);
+
+        sim_run_waiting([&adc]() { adc.wait_scan(); }, 1000);
+
+        CHECK(adc.get_sn(3) != last_sn);
+    }
+
+    sim_signal = slow_signal;
+    hold = 0.0;
+
+    CHECK_EQ(adc.measure_settle(ScanADC::MUX_ADC7, 1, NULL, SCAN_ADC_EXT_MUX(3)), 10);
+    CHECK_EQ(adc.measure_settle(ScanADC::MUX_ADC7, 1, NULL, SCAN_ADC_EXT_MUX(0)), 0);
+    CHECK_EQ(adc.measure_settle(ScanADC::MUX_ADC7, 1, NULL, SCAN_ADC_EXT_MUX(3)), 10);
+
+    adc.calibrate_settle(1);
+    sim_run(400);
+
+    CHECK_NEAR(adc.get_sample(0), 600, 2);
+    CHECK_EQ(adc.get_sample(1), 60);
+    CHECK_EQ(adc.get_sample(2), 150);
+    CHECK_NEAR(adc.get_sample(3), 600, 2);
+    CHECK_EQ(adc.get_sample(4), 100);
+    CHECK_EQ(adc.get_sample(5), 50);
+
+    adc.end();
+    adc.set_external_mux(&PORTB, &DDRB, 4, 0);
+
+    return check_result("test_extmux");
+}
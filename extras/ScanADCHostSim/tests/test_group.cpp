@@ -0,0 +1,91 @@
+/**
+ * @file test_group.cpp
+ * @author Hobbylad ()
+ * @brief Channel groups sharing the ADC.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Groups time-share the ADC at channel boundaries: a group with a scan period is measured once per
+ * period, groups of equal priority take turns, every group reads its own inputs and the ADC stops when
+ * the last group ends.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+static ScanADC::Group battery, temperature;
+static int battery_scans, default_scans, temperature_scans;
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    const ScanADC::channel_config_t config[] = { { ScanADC::MUX_ADC7, 4 }, { ScanADC::MUX_ADC6, 4 } };
+    const ScanADC::channel_config_t battery_config[] = { { ScanADC::MUX_ADC8, 2 } };
+    const ScanADC::channel_config_t temperature_config[] = { { ScanADC::MUX_TEMP, 0 }, { ScanADC::MUX_ADC1, 0 } };
+
+    sim_reset();
+
+    adc.begin(config, 2);
+    adc.attach_scan_callback([](const uint16_t *) { default_scans++; });
+    battery.begin(battery_config, 1, 1, 100);
+    battery.attach_scan_callback([](const uint16_t *) { battery_scans++; });
+    temperature.begin(temperature_config, 2);
+    temperature.attach_scan_callback([](const uint16_t *) { temperature_scans++; });
+
+    sim_run_us(1000000);
+
+    CHECK(battery_scans >= 10);
+    CHECK(battery_scans <= 11);
+    CHECK(default_scans > 1000);
+    CHECK(temperature_scans > 1000);
+    CHECK_EQ(adc.get_sample(0), sim_generate(ScanADC::MUX_ADC7, 0));
+    CHECK_EQ(adc.get_sample(1), sim_generate(ScanADC::MUX_ADC6, 0));
+    CHECK_EQ(battery.get_sample(0), sim_generate(ScanADC::MUX_ADC8, 0));
+    CHECK_EQ(temperature.get_sample(0), sim_generate(ScanADC::MUX_TEMP, 0));
+    CHECK_EQ(temperature.get_sample(1), sim_generate(ScanADC::MUX_ADC1, 0));
+
+    temperature.end();
+    adc.end();
+
+    uint64_t results = sim_stats.results;
+    int scans = battery_scans;
+
+    sim_run_us(300000);
+
+    CHECK(sim_stats.results > results);
+    CHECK(battery_scans >= scans + 3);
+
+    battery.end();
+
+    results = sim_stats.results;
+
+    sim_run(100);
+
+    CHECK_EQ(sim_stats.results, results);
+
+    return check_result("test_group");
+}
@@ -0,0 +1,99 @@
+/**
+ * @file test_history.cpp
+ * @author Hobbylad ()
+ * @brief Sample history.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Channels with a history depth keep their latest samples in a ring copied out oldest first, and the
+ * delta is the change between the latest two samples.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    const ScanADC::channel_config_t config[] =
+    {
+        { ScanADC::MUX_ADC7, 0 },
+        { ScanADC::MUX_ADC6, 0, 0, 0, 0, 5 },
+        { ScanADC::MUX_ADC5, 0, 0, 0, 3, 2 },
+    };
+    uint16_t history[8];
+
+    sim_reset();
+
+    CHECK_EQ(adc.copy_history(0, history, 4), 0);
+
+    // Ramp on channel 1 rising by one code every two conversions.
+    sim_signal = [](uint8_t mux, uint64_t t_ns) -> uint16_t
+    {
+        return (mux == ScanADC::MUX_ADC6) ? (uint16_t)(100 + t_ns / 26000) : 500;
+    };
+
+    adc.begin(config, 3);
+
+    sim_run(8);
+
+    uint8_t n = adc.copy_history(1, history, 8);
+
+    CHECK(n >= 1);
+    CHECK(n < 5);
+    CHECK_EQ(history[n - 1], adc.get_sample(1));
+
+    sim_run(60);
+
+    n = adc.copy_history(1, history, 8);
+
+    CHECK_EQ(n, 5);
+
+    for (uint8_t i = 1; i < n; i++)
+    {
+        CHECK(history[i] > history[i - 1]);
+    }
+
+    CHECK_EQ(history[4], adc.get_sample(1));
+    CHECK_EQ(adc.get_delta(1), history[4] - history[3]);
+
+    uint16_t latest[3];
+
+    CHECK_EQ(adc.copy_history(1, latest, 3), 3);
+    CHECK_EQ(latest[0], history[2]);
+    CHECK_EQ(latest[2], history[4]);
+
+    CHECK_EQ(adc.copy_history(0, history, 8), 0);
+    CHECK_EQ(adc.get_delta(0), 0);
+    CHECK_EQ(adc.copy_history(2, history, 8), 2);
+    CHECK_EQ(adc.get_delta(2), 0);
+    CHECK_EQ(adc.get_sample(2), 500);
+
+    adc.end();
+
+    return check_result("test_history");
+}
@@ -0,0 +1,95 @@
+/**
+ * @file test_inject.cpp
+ * @author Hobbylad ()
+ * @brief Injected measurements.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * An injected measurement is taken between samples of the scan without disturbing the accumulation
+ * of the channel it interrupts, only one can be pending and none is accepted while the ADC is stopped.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+static int calls;
+static uint16_t last;
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    const ScanADC::channel_config_t config[] = { { ScanADC::MUX_ADC7, 8 }, { ScanADC::MUX_ADC6, 8 } };
+
+    sim_reset();
+
+    adc.begin(config, 2);
+
+    sim_run(100);
+
+    CHECK(adc.inject(ScanADC::MUX_ADC9, 2, [](uint16_t sample) { calls++; last = sample; }));
+    CHECK(adc.is_injected_pending());
+    CHECK(!adc.inject(ScanADC::MUX_ADC1));
+
+    int results = 0;
+
+    while (adc.is_injected_pending() && (results < 100))
+    {
+        sim_run(1);
+        results++;
+    }
+
+    // At most two conversions to select the input and four samples.
+    CHECK(results <= 7);
+    CHECK_EQ(calls, 1);
+    CHECK_EQ(last, sim_generate(ScanADC::MUX_ADC9, 0));
+    CHECK_EQ(adc.get_injected_sample(), last);
+    CHECK_EQ(adc.get_injected_sn(), 1);
+
+    for (int i = 0; i < 50; i++)
+    {
+        CHECK(adc.inject(ScanADC::MUX_ADC1));
+        sim_run(37);
+    }
+
+    sim_run(2000);
+
+    CHECK_EQ(adc.get_injected_sn(), 51);
+    CHECK_EQ(adc.get_injected_sample(), sim_generate(ScanADC::MUX_ADC1, 0));
+    CHECK_EQ(adc.get_sample(0), sim_generate(ScanADC::MUX_ADC7, 0));
+    CHECK_EQ(adc.get_sample(1), sim_generate(ScanADC::MUX_ADC6, 0));
+
+    uint16_t sample = 0;
+
+    CHECK(sim_run_waiting([&adc, &sample]() { sample = adc.read_injected(ScanADC::MUX_ADC5, 1); }, 100) < 100);
+    CHECK_EQ(sample, sim_generate(ScanADC::MUX_ADC5, 0));
+
+    adc.end();
+
+    CHECK(!adc.inject(ScanADC::MUX_ADC1));
+
+    return check_result("test_inject");
+}
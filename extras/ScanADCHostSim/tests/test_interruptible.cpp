@@ -0,0 +1,138 @@
+/**
+ * @file test_interruptible.cpp
+ * @author Hobbylad ()
+ * @brief Interruptible ADC ISR.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Scanning with the ISR interruptible gives the same samples as without. On the classic devices the
+ * callbacks run with interrupts enabled and the ADC interrupt disabled, so a callback that lasts
+ * several conversions is not re-entered, and the ADC interrupt is enabled again when the ISR returns.
+ * On megaAVR-0 devices the ISR can not be made interruptible.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+static int calls, interrupts_disabled, adc_interrupt_enabled, depth, depth_max;
+static bool long_callback;
+
+static void channel_callback(uint8_t, uint16_t)
+{
+    calls++;
+    depth++;
+
+    if (depth > depth_max)
+    {
+        depth_max = depth;
+    }
+
+    interrupts_disabled += !(SREG & (1 << SREG_I));
+#if !defined(SIM_MEGAAVR0)
+    adc_interrupt_enabled += !!(ADCSRA & (1 << ADIE));
+#endif
+
+    if (long_callback)
+    {
+        sim_run(3);
+    }
+
+    depth--;
+}
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    const ScanADC::channel_config_t config[] =
+    {
+        { ScanADC::MUX_ADC7, 8 },
+        { ScanADC::MUX_ADC6, 0 },
+        { ScanADC::MUX_ADC5, 3 },
+        { ScanADC::MUX_ADC4, 8, 0, 0, 100 },
+    };
+    uint16_t samples[2][4];
+    uint8_t sn[2][4];
+
+    for (uint8_t mode = 0; mode < 2; mode++)
+    {
+        sim_reset();
+        calls = interrupts_disabled = adc_interrupt_enabled = 0;
+
+#if defined(SIM_MEGAAVR0)
+        CHECK_EQ(adc.set_interruptible(mode), !mode);
+#else
+        CHECK(adc.set_interruptible(mode));
+#endif
+        adc.attach_channel_callback(channel_callback);
+        adc.begin(config, 4);
+        sim_run(5000);
+
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            samples[mode][i] = adc.get_sample(i);
+            sn[mode][i] = adc.get_sn(i);
+        }
+
+        CHECK(calls > 0);
+#if defined(SIM_MEGAAVR0)
+        CHECK_EQ(interrupts_disabled, calls);
+#else
+        CHECK_EQ(interrupts_disabled, mode ? 0 : calls);
+        CHECK_EQ(adc_interrupt_enabled, mode ? 0 : calls);
+        CHECK(ADCSRA & (1 << ADIE));
+#endif
+
+        adc.end();
+    }
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        CHECK_EQ(samples[1][i], samples[0][i]);
+        CHECK_EQ(sn[1][i], sn[0][i]);
+        CHECK_EQ(samples[1][i], config[i].mux * 10);
+    }
+
+#if !defined(SIM_MEGAAVR0)
+    // A conversion completing during a callback does not re-enter the ISR.
+    sim_reset();
+    calls = depth_max = 0;
+    long_callback = true;
+
+    adc.set_interruptible(true);
+    adc.begin(config, 4);
+    sim_run(2000);
+
+    CHECK(calls > 0);
+    CHECK_EQ(depth_max, 1);
+    CHECK(ADCSRA & (1 << ADIE));
+
+    adc.end();
+    adc.set_interruptible(false);
+#endif
+
+    return check_result("test_interruptible");
+}
@@ -0,0 +1,170 @@
+/**
+ * @file test_keypad.cpp
+ * @author Hobbylad ()
+ * @brief Resistor ladder keypad decoding.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * A five key ladder decodes a key after 3 consecutive samples of its level, ignores a bounce and the
+ * level passed while sliding to another key, queues press and release events up to the queue size
+ * and counts the events dropped beyond it. get_keys() leaves the interrupt flag as it was.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "ScanKeypad.h"
+#include "Sim.h"
+#include "Check.h"
+
+#include <string>
+
+static uint16_t level = 1023;
+static ScanKeypad keypad;
+
+// Lets the keypad channel complete a number of scans.
+static void scans(int count)
+{
+    ScanADC &adc = ScanADC::getInstance();
+
+    for (int i = 0; i < count; i++)
+    {
+        uint8_t sn = adc.get_sn(1);
+
+        while (adc.get_sn(1) == sn)
+        {
+            sim_run(1);
+        }
+    }
+}
+
+// Reads the queued events as + or - and the key index.
+static std::string events()
+{
+    std::string s;
+    uint8_t event;
+
+    while (keypad.read_event(event))
+    {
+        s += (event & SCAN_KEYPAD_PRESSED) ? '+' : '-';
+        s += (char)('0' + (event & SCAN_KEYPAD_KEY_MASK));
+    }
+
+    return s;
+}
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    static const uint16_t levels[] = { 0, 143, 327, 512, 675 };
+    static uint16_t thresholds[5];
+    const ScanADC::channel_config_t config[] =
+    {
+        { ScanADC::MUX_ADC7, 0 },
+        { ScanADC::MUX_ADC4, 0 },
+    };
+
+    ScanKeypad::build(levels, 5, 1023, thresholds);
+
+    CHECK_EQ(thresholds[0], 71);
+    CHECK_EQ(thresholds[1], 235);
+    CHECK_EQ(thresholds[2], 419);
+    CHECK_EQ(thresholds[3], 593);
+    CHECK_EQ(thresholds[4], 849);
+
+    sim_reset();
+    sim_signal = [](uint8_t mux, uint64_t) -> uint16_t
+    {
+        return (mux == ScanADC::MUX_ADC4) ? level : 500;
+    };
+
+    keypad.begin(thresholds, 5, 3);
+    adc.attach_keypad(1, &keypad);
+    adc.begin(config, 2);
+
+    scans(5);
+    CHECK_EQ(keypad.get_keys(), 0);
+    CHECK(events() == "");
+
+    level = 330;
+    scans(2);
+    CHECK_EQ(keypad.get_keys(), 0);
+    scans(1);
+    CHECK_EQ(keypad.get_keys(), 0x0004);
+    CHECK(events() == "+2");
+
+    // Bounce shorter than the debounce count.
+    level = 1023;
+    scans(1);
+    level = 330;
+    scans(1);
+    level = 1023;
+    scans(1);
+    CHECK_EQ(keypad.get_keys(), 0x0004);
+    CHECK(events() == "");
+
+    scans(3);
+    CHECK_EQ(keypad.get_keys(), 0);
+    CHECK(events() == "-2");
+
+    // Level of key 3 passed on the way to key 1.
+    level = 600;
+    scans(1);
+    level = 140;
+    scans(5);
+    CHECK_EQ(keypad.get_keys(), 0x0002);
+    CHECK(events() == "+1");
+
+    level = 0;
+    scans(3);
+    CHECK_EQ(keypad.get_keys(), 0x0001);
+    CHECK(events() == "-1+0");
+
+    for (int i = 0; i < 10; i++)
+    {
+        level = (i & 1) ? 1023 : 500;
+        scans(3);
+    }
+
+    CHECK_EQ(keypad.get_keys(), 0);
+    CHECK(events() == "-0+3-3+3-3+3-3+3");
+    CHECK_EQ(keypad.get_dropped_count(), 3);
+
+    // Interrupts stay enabled, or disabled when read from a callback.
+    CHECK(SREG & (1 << SREG_I));
+    cli();
+    keypad.get_keys();
+    CHECK(!(SREG & (1 << SREG_I)));
+    sei();
+
+    adc.detach_keypad(&keypad);
+    level = 330;
+    scans(5);
+    CHECK_EQ(keypad.get_keys(), 0);
+    CHECK(events() == "");
+
+    adc.end();
+
+    return check_result("test_keypad");
+}
@@ -0,0 +1,195 @@
+/**
+ * @file test_lockin.cpp
+ * @author Hobbylad ()
+ * @brief Lock-in measurement of bridge sensors.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * A bridge signal of 37 codes on a level of 400, switched by the excitation pin from the start of the
+ * next conversion, is read exactly by lock-in channels with phases of 1 and 4 samples, and within 2
+ * codes under 200 codes of 50Hz interference that swings a plain average by up to 400 codes. Injected
+ * measurements preempt a long lock-in channel at the end of a phase without disturbing its sample, and
+ * the excitation is off after end().
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+#include <math.h>
+
+static double amplitude;
+static uint8_t latched;
+static uint64_t inject_conversions, injected_conversions;
+static uint16_t injected_sample;
+
+// Input level with the bridge excited by the port state at the start of the conversion, which on the
+// classic devices is the state at the conversion before as the next conversion starts before the ISR.
+static uint16_t bridge_signal(uint8_t mux, uint64_t t_ns)
+{
+#if defined(SIM_MEGAAVR0)
+    uint8_t port = PORTD;
+#else
+    uint8_t port = latched;
+#endif
+    uint16_t level = (uint16_t)(400 + amplitude * sin(t_ns * 1e-9 * 2 * M_PI * 50));
+
+    latched = PORTD;
+
+    if (mux == ScanADC::MUX_ADC7)
+    {
+        return level + ((port & 0x10) ? 37 : 0);
+    }
+
+    if (mux == ScanADC::MUX_ADC6)
+    {
+        return level + ((port & 0x10) ? 5 : 0);
+    }
+
+    return level;
+}
+
+// Checks the samples stay within a range, relative to SCAN_ADC_LOCKIN_ZERO for the lock-in channels.
+static void check_range(const int *low, const int *high)
+{
+    ScanADC &adc = ScanADC::getInstance();
+    int min[3] = { 9999, 9999, 9999 }, max[3] = { -9999, -9999, -9999 };
+
+    sim_run(600);
+
+    for (int i = 0; i < 300; i++)
+    {
+        sim_run(97);
+
+        for (uint8_t c = 0; c < 3; c++)
+        {
+            int v = adc.get_sample(c) - ((c < 2) ? SCAN_ADC_LOCKIN_ZERO : 0);
+
+            min[c] = (v < min[c]) ? v : min[c];
+            max[c] = (v > max[c]) ? v : max[c];
+        }
+    }
+
+    for (uint8_t c = 0; c < 3; c++)
+    {
+        CHECK(min[c] >= low[c]);
+        CHECK(max[c] <= high[c]);
+    }
+}
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    ScanADC::channel_config_t config[3] = {};
+
+    config[0].mux = ScanADC::MUX_ADC7;
+    config[0].sample_count_log2 = 4;
+    config[0].mode = ScanADC::CHANNEL_LOCKIN;
+    config[0].mode_arg = 0;
+    config[1].mux = ScanADC::MUX_ADC6;
+    config[1].sample_count = 64;
+    config[1].mode = ScanADC::CHANNEL_LOCKIN;
+    config[1].mode_arg = 2;
+    config[1].settle = 1;
+    config[1].median = 3;
+    config[2].mux = ScanADC::MUX_ADC5;
+    config[2].sample_count_log2 = 5;
+
+    sim_reset();
+    sim_signal = bridge_signal;
+    PORTD = 0x01;
+    DDRD = 0;
+
+    adc.set_excitation(&PORTD, &DDRD, 4);
+
+    CHECK_EQ(DDRD, 0x10);
+
+    adc.begin(config, 3);
+
+    const int exact_low[3] = { 37, 5, 400 }, exact_high[3] = { 37, 5, 400 };
+
+    check_range(exact_low, exact_high);
+
+    amplitude = 200;
+
+    const int noisy_low[3] = { 35, 0, 200 }, noisy_high[3] = { 39, 10, 599 };
+
+    check_range(noisy_low, noisy_high);
+
+    amplitude = 0;
+
+    for (int i = 0; i < 30; i++)
+    {
+        adc.inject(ScanADC::MUX_ADC5, 0);
+        sim_run(7 + i);
+    }
+
+    check_range(exact_low, exact_high);
+
+    adc.end();
+
+    CHECK_EQ(PORTD, 0x01);
+
+    // One lock-in channel of 2 x 4096 samples in phases of 16.
+    ScanADC::channel_config_t long_config[1] = {};
+
+    long_config[0].mux = ScanADC::MUX_ADC7;
+    long_config[0].sample_count_log2 = 12;
+    long_config[0].mode = ScanADC::CHANNEL_LOCKIN;
+    long_config[0].mode_arg = 4;
+
+    adc.begin(long_config, 1);
+    sim_run_waiting([&adc]() { adc.wait_scan(); }, 100000);
+
+    for (int i = 0; i < 20; i++)
+    {
+        sim_run_us(1000 + 777 * i);
+
+        inject_conversions = sim_stats.conversions;
+        adc.inject(ScanADC::MUX_ADC5, 2, [](uint16_t sample)
+        {
+            injected_conversions = sim_stats.conversions;
+            injected_sample = sample;
+        });
+        sim_run_us(2000);
+
+        CHECK(injected_conversions - inject_conversions <= 16 + 4 + 4);
+        CHECK_EQ(injected_sample, 400);
+    }
+
+    uint8_t sn = adc.get_sn(0);
+
+    sim_run_waiting([&adc]() { adc.wait_scan(); }, 100000);
+    sim_run_us(300000);
+
+    CHECK((uint8_t)(adc.get_sn(0) - sn) >= 2);
+    CHECK_EQ(adc.get_sample(0), SCAN_ADC_LOCKIN_ZERO + 37);
+
+    adc.end();
+    adc.set_excitation(&PORTD, &DDRD, 0xFF);
+
+    return check_result("test_lockin");
+}
@@ -0,0 +1,260 @@
+/**
+ * @file test_mains.cpp
+ * @author Hobbylad ()
+ * @brief Mains hum rejection and Timer1 triggering.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Measures the residual of 500 codes of mains hum around mid scale for averages locked to the mains
+ * at every phase, and prints the rejection in dB behind the figures in the README. Locked to the
+ * mains, conversions are triggered by Timer1 compare match B with no conversion discarded between
+ * channels, and they continue after a conversion interrupt is lost while the interrupt is masked,
+ * while the ISR is interruptible and by a write to ADCSRA outside the library.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+#include <math.h>
+
+#define HUM         500.0
+#define MID         512.0
+#define PHASES      8
+
+#if !defined(SIM_MEGAAVR0)
+/**
+ * @brief Measures the worst residual hum of a channel over phases of the hum.
+ *
+ * @param[in] mains     Mains frequency locked to or MAINS_OFF.
+ * @param[in] hum_hz    Hum frequency.
+ * @param[in] config    Channel configuration.
+ * @return double Worst absolute difference between sample and mid scale.
+ */
+static double residual(ScanADC::mains_t mains, double hum_hz, const ScanADC::channel_config_t &config)
+{
+    ScanADC &adc = ScanADC::getInstance();
+    double worst = 0.0;
+
+    for (int p = 0; p < PHASES; p++)
+    {
+        sim_reset();
+        sim_set_input(config.mux, { MID, HUM, hum_hz, 2.0 * M_PI * p / PHASES });
+
+        adc.set_mains(mains);
+        adc.begin(&config, 1);
+
+        for (int scan = 0; scan < 4; scan++)
+        {
+            uint8_t sn = adc.get_sn(0);
+
+            while (adc.get_sn(0) == sn)
+            {
+                sim_run(1);
+            }
+
+            // The first scan can start with a conversion of the input at reset.
+            if (scan > 0)
+            {
+                double r = fabs(adc.get_sample(0) - MID);
+
+                worst = (r > worst) ? r : worst;
+            }
+        }
+
+        adc.end();
+    }
+
+    return worst;
+}
+
+static void print_rejection(const char *mode, double r)
+{
+    // Below half a code the residual is limited by the 10-bit result.
+    printf("  %-28s residual %6.2f codes, rejection %s%.1fdB\n", mode, r, (r < 0.5) ? "over " : "",
+           20.0 * log10(HUM / ((r > 0.5) ? r : 0.5)));
+}
+
+#endif
+
+static void check_rejection()
+{
+#if !defined(SIM_MEGAAVR0)
+    ScanADC::channel_config_t config = { ScanADC::MUX_ADC7, 6 };
+    double r;
+
+    r = residual(ScanADC::MAINS_50HZ, 50.0, config);
+    print_rejection("50Hz, 64 samples", r);
+    CHECK(r < 0.5);
+
+    config.sample_count_log2 = 8;
+    r = residual(ScanADC::MAINS_50HZ, 50.0, config);
+    print_rejection("50Hz, 256 samples", r);
+    CHECK(r < 0.5);
+
+    config.sample_count = 192;
+    r = residual(ScanADC::MAINS_50HZ, 50.0, config);
+    print_rejection("50Hz, 192 samples", r);
+    CHECK(r < 0.5);
+
+    config.sample_count = 320;
+    r = residual(ScanADC::MAINS_50HZ, 50.0, config);
+    print_rejection("50Hz, 320 samples", r);
+    CHECK(r < 0.5);
+
+    r = residual(ScanADC::MAINS_60HZ, 60.0, config);
+    print_rejection("60Hz, 320 samples", r);
+    CHECK(r < 0.5);
+
+    config.sample_count = 0;
+    r = residual(ScanADC::MAINS_60HZ, 60.0, config);
+    print_rejection("60Hz, 256 samples", r);
+    CHECK(r < 0.5);
+
+    r = residual(ScanADC::MAINS_OFF, 50.0, config);
+    print_rejection("Free running, 256 samples", r);
+    CHECK(r > 400.0);
+#endif
+}
+
+#if !defined(SIM_MEGAAVR0)
+static void wait_scans(int scans)
+{
+    ScanADC &adc = ScanADC::getInstance();
+
+    for (int i = 0; i < scans; i++)
+    {
+        uint8_t sn = adc.get_sn(1);
+        int results = 0;
+
+        while ((adc.get_sn(1) == sn) && (results++ < 1000))
+        {
+            sim_run(1);
+        }
+    }
+}
+
+#endif
+
+static void check_triggering()
+{
+#if !defined(SIM_MEGAAVR0)
+    ScanADC &adc = ScanADC::getInstance();
+    const ScanADC::channel_config_t config[] = { { ScanADC::MUX_ADC7, 6 }, { ScanADC::MUX_ADC6, 6 } };
+
+    sim_reset();
+
+    CHECK(adc.set_mains(ScanADC::MAINS_50HZ));
+
+    adc.begin(config, 2);
+
+    wait_scans(2);
+
+    // 64 samples of each channel per 20ms cycle with no conversion discarded.
+    uint64_t conversions = sim_stats.conversions;
+    uint64_t start_ns = sim_time_ns;
+
+    wait_scans(4);
+
+    CHECK_EQ(sim_stats.conversions - conversions, 4 * 128);
+    CHECK_NEAR((sim_time_ns - start_ns) / 1e6, 4 * 40.0, 0.01);
+    CHECK_EQ(adc.get_sample(0), sim_generate(ScanADC::MUX_ADC7, 0));
+    CHECK_EQ(adc.get_sample(1), sim_generate(ScanADC::MUX_ADC6, 0));
+    CHECK_EQ(sim_stats.missed_triggers, 0);
+
+    // A conversion completing while interrupts are disabled is still delivered after get_sample().
+    cli();
+    sim_run(1);
+    adc.get_sample(0);
+    sei();
+
+    conversions = sim_stats.conversions;
+    wait_scans(2);
+
+    CHECK(sim_stats.conversions - conversions >= 128);
+
+    // A conversion completing during an interruptible callback reading a sample.
+    adc.set_interruptible(true);
+    adc.attach_channel_callback([](uint8_t, uint16_t)
+    {
+        sim_run(1);
+        ScanADC::getInstance().get_sample(0);
+    });
+
+    wait_scans(2);
+
+    adc.attach_channel_callback(NULL);
+    adc.set_interruptible(false);
+
+    conversions = sim_stats.conversions;
+    wait_scans(2);
+
+    CHECK(sim_stats.conversions - conversions >= 128);
+    CHECK_EQ(adc.get_sample(0), sim_generate(ScanADC::MUX_ADC7, 0));
+
+    // An interrupt lost by a read-modify-write of ADCSRA outside the library is recovered by unlock().
+    cli();
+    sim_run(1);
+    ADCSRA |= 0;
+    sei();
+    sim_run(10);
+
+    uint64_t missed = sim_stats.missed_triggers;
+
+    CHECK(missed > 0);
+
+    adc.get_sample(0);
+
+    conversions = sim_stats.conversions;
+    wait_scans(2);
+
+    CHECK(sim_stats.conversions - conversions >= 128);
+    CHECK_EQ(sim_stats.missed_triggers, missed);
+
+    // Back to free running.
+    CHECK(adc.set_mains(ScanADC::MAINS_OFF));
+
+    conversions = sim_stats.conversions;
+    start_ns = sim_time_ns;
+    sim_run(1000);
+
+    CHECK_EQ(sim_stats.conversions - conversions, 1000);
+    CHECK_EQ(sim_time_ns - start_ns, 1000 * 13000ULL);
+    CHECK_EQ(adc.get_sample(0), sim_generate(ScanADC::MUX_ADC7, 0));
+
+    adc.end();
+#else
+    CHECK(!ScanADC::getInstance().set_mains(ScanADC::MAINS_50HZ));
+#endif
+}
+
+int main()
+{
+    check_rejection();
+    check_triggering();
+
+    return check_result("test_mains");
+}
@@ -0,0 +1,119 @@
+/**
+ * @file test_median.cpp
+ * @author Hobbylad ()
+ * @brief Median filter of raw samples.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Every filtered sample of a channel without averaging equals the median of the latest 3, 5 or 7
+ * conversions of pseudo random input, as selected by std::nth_element, and a channel averaging a
+ * filtered input with a spike every 20 conversions reads the level without the spikes while the
+ * unfiltered channel is biased by them.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+#include <algorithm>
+#include <vector>
+
+static std::vector<uint16_t> conversions;
+static int filtered;
+static int mismatches;
+static uint8_t median;
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+
+    for (median = 3; median <= 7; median += 2)
+    {
+        const ScanADC::channel_config_t config[] =
+        {
+            { ScanADC::MUX_ADC7, 0, 0, 0, 0, 0, median },
+        };
+        uint32_t seed = 1;
+
+        sim_reset();
+        conversions.clear();
+        filtered = 0;
+        mismatches = 0;
+
+        sim_signal = [&seed](uint8_t, uint64_t) -> uint16_t
+        {
+            seed = seed * 1103515245UL + 12345UL;
+            conversions.push_back((seed >> 16) & 0x3FF);
+
+            return conversions.back();
+        };
+
+        // The sample is the median of the conversions up to the one just completed.
+        adc.attach_channel_callback([](uint8_t, uint16_t sample)
+        {
+            std::vector<uint16_t> window(conversions.end() - median, conversions.end());
+
+            std::nth_element(window.begin(), window.begin() + median / 2, window.end());
+            filtered++;
+            mismatches += (sample != window[median / 2]);
+        });
+
+        adc.begin(config, 1);
+        sim_run(3000);
+        adc.end();
+
+        CHECK(filtered >= 300);
+        CHECK_EQ(mismatches, 0);
+    }
+
+    const ScanADC::channel_config_t config[] =
+    {
+        { ScanADC::MUX_ADC7, 6 },
+        { ScanADC::MUX_ADC6, 6, 0, 0, 0, 0, 3 },
+        { ScanADC::MUX_ADC5, 8, 0, 0, 0, 0, 5 },
+        { ScanADC::MUX_ADC4, 0, 0, 0, 0, 0, 7 },
+    };
+
+    sim_reset();
+    adc.attach_channel_callback(NULL);
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        sim_set_input(config[i].mux, { 300.0, 0.0, 0.0, 0.0, 0.0, 20, 700.0 });
+    }
+
+    adc.begin(config, 4);
+    sim_run_us(200000);
+
+    CHECK(adc.get_sample(0) > 320);
+    CHECK_EQ(adc.get_sample(1), 300);
+    CHECK_EQ(adc.get_sample(2), 300);
+    CHECK_EQ(adc.get_sample(3), 300);
+
+    adc.end();
+
+    return check_result("test_median");
+}
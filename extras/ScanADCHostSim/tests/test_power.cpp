@@ -0,0 +1,234 @@
+/**
+ * @file test_power.cpp
+ * @author Hobbylad ()
+ * @brief AC power measurement.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * A 50Hz supply of 400 codes with a current of 300 codes lagging by 30 degrees reads within 0.03% of
+ * the exact RMS voltage, current and real power over windows of 10 cycles, and the window follows a
+ * change to 60Hz and of the DC level. A voltage without a crossing closes a window of 2047 pairs. The
+ * channel settle count discards conversions of the voltage before the inputs alternate. Injected
+ * measurements are taken within a few conversions while a window is in progress, and windows with an
+ * injected measurement every 5ms still complete with the same accuracy.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "ScanPower.h"
+#include "Sim.h"
+#include "Check.h"
+
+#include <math.h>
+
+#include <vector>
+
+static double amplitude_v = 400.0, amplitude_i = 300.0, dc_v = 512.0, frequency = 50.0;
+static std::vector<uint8_t> converted;
+static uint64_t inject_conversions, injected_conversions;
+static uint16_t injected_sample;
+static ScanPower power;
+
+// Voltage on ADC7 and current lagging by 30 degrees on ADC1, in codes.
+static uint16_t supply_signal(uint8_t mux, uint64_t t_ns)
+{
+    double w = 2 * M_PI * frequency * t_ns * 1e-9;
+
+    converted.push_back(mux);
+
+    if (mux == ScanADC::MUX_ADC7)
+    {
+        return (uint16_t) lround(dc_v + amplitude_v * sin(w));
+    }
+
+    if (mux == ScanADC::MUX_ADC1)
+    {
+        return (uint16_t) lround(500.0 + amplitude_i * sin(w - M_PI / 6));
+    }
+
+    return (mux == ScanADC::MUX_ADC5) ? 400 : 300;
+}
+
+// Lets a window end and reads it.
+static bool next_window(ScanPower::result_t &result)
+{
+    uint8_t sn = power.get_sn();
+
+    for (uint32_t n = 0; (power.get_sn() == sn) && (n < 200000); n += 100)
+    {
+        sim_run(100);
+    }
+
+    return power.read(result);
+}
+
+static void check_window(const ScanPower::result_t &result, uint16_t frequency_chz)
+{
+    CHECK_NEAR(result.v_rms_mv, amplitude_v / sqrt(2) * 781.25, 70);
+    CHECK_NEAR(result.i_rms_ma, amplitude_i / sqrt(2) * 48.828, 5);
+    CHECK_NEAR(result.power_mw, amplitude_v * amplitude_i / 2 * cos(M_PI / 6) * 0.78125 * 48.828, 600);
+    CHECK_NEAR(result.frequency_chz, frequency_chz, 2);
+}
+
+// Counts the conversions of the voltage after the power channel is selected until the first current.
+static int first_voltages()
+{
+    size_t i = 0;
+
+    while ((i < converted.size()) && (converted[i] != ScanADC::MUX_ADC6))
+    {
+        i++;
+    }
+
+    while ((i < converted.size()) && (converted[i] != ScanADC::MUX_ADC7))
+    {
+        i++;
+    }
+
+    int count = 0;
+
+    while ((i < converted.size()) && (converted[i] == ScanADC::MUX_ADC7))
+    {
+        count++;
+        i++;
+    }
+
+    return count;
+}
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    ScanADC::channel_config_t config[2] = {};
+    ScanPower::result_t result;
+
+    config[0].mux = ScanADC::MUX_ADC6;
+    config[0].sample_count_log2 = 2;
+    config[1].mux = ScanADC::MUX_ADC7;
+
+    sim_reset();
+    sim_signal = supply_signal;
+
+    power.begin(ScanADC::MUX_ADC1, 10, 781250, 48828);
+    adc.begin(config, 2);
+    adc.attach_power(1, &power);
+
+    for (int k = 0; k < 4; k++)
+    {
+        CHECK(next_window(result));
+        check_window(result, 5000);
+        CHECK_NEAR(result.samples, 7692, 2);
+        CHECK_EQ(adc.get_sample(1), 512);
+        CHECK_EQ(adc.get_sample(0), 300);
+    }
+
+    CHECK(!power.read(result));
+
+    frequency = 60.0;
+    dc_v = 530.0;
+
+    next_window(result);
+    next_window(result);
+    CHECK(next_window(result));
+    check_window(result, 6000);
+    CHECK_EQ(adc.get_sample(1), 530);
+
+    amplitude_v = 0.0;
+
+    next_window(result);
+    CHECK(next_window(result));
+    CHECK_EQ(result.v_rms_mv, 0);
+    CHECK_EQ(result.frequency_chz, 0);
+    CHECK_EQ(result.samples, 2047);
+
+    // Injected measurements part way through windows.
+    amplitude_v = 400.0;
+    frequency = 50.0;
+    dc_v = 512.0;
+
+    next_window(result);
+    next_window(result);
+
+    for (int i = 0; i < 20; i++)
+    {
+        sim_run_us(3000 + 1777 * i);
+
+        inject_conversions = sim_stats.conversions;
+        injected_conversions = 0;
+        adc.inject(ScanADC::MUX_ADC5, 1, [](uint16_t sample)
+        {
+            injected_conversions = sim_stats.conversions;
+            injected_sample = sample;
+        });
+        sim_run_us(1000);
+
+        CHECK(injected_conversions > inject_conversions);
+        CHECK(injected_conversions - inject_conversions <= 2 + 2 + 2);
+        CHECK_EQ(injected_sample, 400);
+    }
+
+    uint8_t sn = power.get_sn();
+
+    for (int i = 0; i < 200; i++)
+    {
+        adc.inject(ScanADC::MUX_ADC5, 0);
+        sim_run_us(5000);
+    }
+
+    CHECK((uint8_t)(power.get_sn() - sn) >= 4);
+    CHECK(power.read(result));
+    check_window(result, 5000);
+    // At most the time of two pairs is lost to each of the 40 injected measurements of a window.
+    CHECK(result.samples >= 7692 - 2 * 40 - 2);
+
+    // Settle counts discard conversions of the voltage after selecting it.
+    for (uint8_t settle = 0; settle <= 3; settle += 3)
+    {
+        config[1].settle = settle;
+
+        adc.end();
+        adc.begin(config, 2);
+        adc.attach_power(1, &power);
+
+        converted.clear();
+        CHECK(next_window(result));
+        CHECK_EQ(first_voltages(), settle + 1);
+        CHECK(next_window(result));
+        check_window(result, 5000);
+    }
+
+    // The window in progress ends before the channel is measured as an analogue input again.
+    adc.detach_power(&power);
+    sim_run_us(300000);
+    sn = adc.get_sn(1);
+    sim_run(1000);
+
+    CHECK((uint8_t)(adc.get_sn(1) - sn) > 50);
+    CHECK_NEAR(adc.get_sample(1), 512, 401);
+
+    adc.end();
+
+    return check_result("test_power");
+}
@@ -0,0 +1,119 @@
+/**
+ * @file test_reciprocal.cpp
+ * @author Hobbylad ()
+ * @brief Reciprocal averaging of arbitrary sample counts.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Every sample count that is not a power of two is divided exactly by its fixed point reciprocal over
+ * the full accumulator range of 10-bit samples plus rounding, exhaustively for counts up to 600 and at
+ * every quotient boundary for larger counts, and a channel averages exactly over a count such as 1538.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+static uint32_t k;
+
+int main()
+{
+    ScanADC::reciprocal_t reciprocal;
+    uint32_t errors = 0;
+
+    for (uint32_t count = 3; count <= 65535; count++)
+    {
+        if (!(count & (count - 1)))
+        {
+            continue;
+        }
+
+        reciprocal.set((uint16_t) count);
+
+        uint32_t x_max = count * 1023 + (count >> 1);
+
+        if (count <= 600)
+        {
+            for (uint32_t x = 0; x <= x_max; x++)
+            {
+                errors += (reciprocal.divide(x) != x / count);
+            }
+        }
+        else
+        {
+            for (uint32_t q = 0; q <= 1023; q++)
+            {
+                uint32_t x = q * count;
+
+                errors += (reciprocal.divide(x) != q);
+                errors += (reciprocal.divide(x + count - 1) != q);
+
+                if (x > 0)
+                {
+                    errors += (reciprocal.divide(x - 1) != q - 1);
+                }
+            }
+
+            errors += (reciprocal.divide(x_max) != x_max / count);
+        }
+
+        if (errors)
+        {
+            printf("count %u\n", count);
+            break;
+        }
+    }
+
+    CHECK_EQ(errors, 0);
+
+    ScanADC &adc = ScanADC::getInstance();
+    ScanADC::channel_config_t config[] =
+    {
+        { ScanADC::MUX_ADC7, 0, 0, 0, 1538 },
+        { ScanADC::MUX_ADC6, 0, 0, 0, 3 },
+    };
+
+    sim_reset();
+
+    // 501 two times out of three averages to 500.67, rounded to 501.
+    sim_signal = [](uint8_t mux, uint64_t) -> uint16_t
+    {
+        return (mux == ScanADC::MUX_ADC7) ? (uint16_t)(500 + ((k++ % 3) != 0)) : 1023;
+    };
+
+    adc.begin(config, 2);
+
+    sim_run(4000);
+
+    CHECK(adc.get_sn(0) >= 2);
+    CHECK_EQ(adc.get_sample(0), 501);
+    CHECK_EQ(adc.get_sample(1), 1023);
+    CHECK_EQ(adc.get_sample_count_log2(0), 0);
+
+    adc.end();
+
+    return check_result("test_reciprocal");
+}
@@ -0,0 +1,175 @@
+/**
+ * @file test_settle.cpp
+ * @author Hobbylad ()
+ * @brief Settling conversions after selecting an input.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * A channel takes its settle count of conversions more per scan, up to the largest count of 31, in
+ * addition to the conversion of the previous input discarded on the classic devices. Without a
+ * settle count the classic devices discard only that conversion when switching between channels,
+ * and no conversion of the previous input is accumulated. An input charging the sample and hold
+ * capacitor by 40% of the difference per conversion is measured by ScanADC::measure_settle() to
+ * need 10 conversions to settle within 1 code, and after ScanADC::calibrate_settle() the channel
+ * reads the input level instead of the crosstalk.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+#include <math.h>
+
+static uint64_t scan_conversions[3];
+static int scans;
+static double hold;
+
+// Level of an input and the fraction of the previous level the sample and hold keeps.
+static double level(uint8_t mux)
+{
+    return (mux == ScanADC::MUX_ADC7) ? 600.0 :
+           (mux == ScanADC::MUX_ADC6) ? 800.0 :
+           (mux == ScanADC::MUX_ADC5) ? 100.0 :
+           (mux == ScanADC::MUX_0V0) ? 0.0 : 225.0;
+}
+
+static double kept(uint8_t mux)
+{
+    return (mux == ScanADC::MUX_ADC7) ? 0.6 : 0.0;
+}
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+#if defined(SIM_MEGAAVR0)
+    const uint8_t discarded = 0;
+#else
+    const uint8_t discarded = 1;
+#endif
+    const uint8_t settles[] = { 0, 3, 31 };
+
+    adc.attach_scan_callback([](const uint16_t *)
+    {
+        if (scans < 3)
+        {
+            scan_conversions[scans] = sim_stats.conversions;
+        }
+
+        scans++;
+    });
+
+    for (uint8_t i = 0; i < sizeof(settles); i++)
+    {
+        ScanADC::channel_config_t config[] =
+        {
+            { ScanADC::MUX_ADC7, 0 },
+        };
+
+        config[0].settle = settles[i];
+
+        sim_reset();
+        scans = 0;
+
+        adc.begin(config, 1);
+        sim_run(2000);
+
+        CHECK(scans >= 3);
+        CHECK_EQ(scan_conversions[2] - scan_conversions[1], discarded + 1 + settles[i]);
+        CHECK_EQ(adc.get_sample(0), ScanADC::MUX_ADC7 * 10);
+
+        adc.end();
+    }
+
+    const ScanADC::channel_config_t switched[] =
+    {
+        { ScanADC::MUX_ADC7, 2 },
+        { ScanADC::MUX_ADC6, 2 },
+        { ScanADC::MUX_ADC5, 2 },
+    };
+
+    sim_reset();
+    scans = 0;
+
+    adc.begin(switched, 3);
+    sim_run(2000);
+
+    CHECK(scans >= 3);
+    CHECK_EQ(scan_conversions[2] - scan_conversions[1], 3 * (discarded + 4));
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        CHECK_EQ(adc.get_sample(i), switched[i].mux * 10);
+    }
+
+    adc.end();
+
+    adc.attach_scan_callback(NULL);
+
+    const ScanADC::channel_config_t config[] =
+    {
+        { ScanADC::MUX_ADC7, 0 },
+        { ScanADC::MUX_ADC6, 0 },
+        { ScanADC::MUX_ADC5, 2 },
+    };
+    uint16_t leakage = 0;
+
+    sim_reset();
+    hold = 0.0;
+
+    sim_signal = [](uint8_t mux, uint64_t) -> uint16_t
+    {
+        hold = level(mux) + (hold - level(mux)) * kept(mux);
+
+        return (uint16_t) lround(hold);
+    };
+
+    CHECK_EQ(adc.measure_settle(ScanADC::MUX_ADC7), 0);
+
+    adc.begin(config, 3);
+    sim_run(100);
+
+    CHECK(adc.get_sample(0) < 500);
+
+    CHECK_EQ(adc.measure_settle(ScanADC::MUX_ADC7, 1, &leakage), 10);
+    CHECK_EQ(leakage, 135);
+    CHECK_EQ(adc.measure_settle(ScanADC::MUX_ADC6, 1, &leakage), 0);
+    CHECK_EQ(leakage, 0);
+
+    adc.calibrate_settle(1);
+
+    uint8_t sn = adc.get_sn(0);
+
+    sim_run(300);
+
+    CHECK((uint8_t)(adc.get_sn(0) - sn) >= 5);
+    CHECK_NEAR(adc.get_sample(0), 600, 2);
+    CHECK_EQ(adc.get_sample(1), 800);
+    CHECK_EQ(adc.get_sample(2), 100);
+
+    adc.end();
+
+    return check_result("test_settle");
+}
@@ -0,0 +1,235 @@
+/**
+ * @file test_stream.cpp
+ * @author Hobbylad ()
+ * @brief Binary frame stream.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Frames written through a throttled serial port decode with ScanStreamDecoder to the samples
+ * written, frames that do not fit the transmit buffer are dropped whole and the delta frames after a
+ * drop are preceded by a key frame. Samples over 10 bits, such as lock-in samples around 1024, are
+ * sent in varint key frames and decode unchanged, also when encoded for replay. Samples of 1023,
+ * 1024, 2047 and 32767 and differences at the delta limits decode unchanged, with differences beyond
+ * them sent as key frames.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Arduino.h"
+#include "ScanStream.h"
+#include "ScanStreamDecoder.h"
+#include "Sim.h"
+#include "Check.h"
+
+#include <vector>
+
+#define FRAMES      200
+#define CHANNELS    4
+
+static uint16_t frames[FRAMES][CHANNELS];
+
+// Fills the frames with samples up to a limit, with a jump every 13 frames.
+static void fill_frames(uint16_t limit)
+{
+    for (int k = 0; k < FRAMES; k++)
+    {
+        for (int i = 0; i < CHANNELS; i++)
+        {
+            frames[k][i] = (uint16_t)((k * (i + 1) * 7 + i * 100 + ((k % 13) ? 0 : 500)) % (limit + 1));
+        }
+    }
+}
+
+// Counts the frames of a type received.
+static int count_frames(const std::vector<uint8_t> &received, uint8_t type)
+{
+    int count = 0;
+
+    for (size_t i = 0; i + SCAN_STREAM_HEADER_SIZE <= received.size(); )
+    {
+        count += (received[i + 2] == type);
+        i += SCAN_STREAM_HEADER_SIZE + received[i + 5] + SCAN_STREAM_CHECKSUM_SIZE;
+    }
+
+    return count;
+}
+
+static void check_encoding(ScanStream::encoding_t encoding, uint16_t limit)
+{
+    std::vector<uint8_t> received;
+    int budget = 0;
+    ScanStream stream;
+    uint64_t decoded = 0, mismatches = 0;
+
+    sim_reset();
+    sim_serial_sink = [&received](uint8_t c) { received.push_back(c); };
+    sim_serial_available_for_write = [&budget]() { return budget; };
+
+    stream.begin(Serial, CHANNELS, encoding, 64, 8);
+
+    for (int k = 0; k < FRAMES; k++)
+    {
+        stream.write_frame(frames[k]);
+
+        // Port drains 9 bytes per frame 7 frames out of 10.
+        budget = ((k % 10) < 7) ? 9 : 0;
+        stream.poll();
+    }
+
+    budget = 1000;
+    stream.poll();
+
+    ScanStreamDecoder decoder([&decoded, &mismatches](const scan_frame_t &frame)
+    {
+        decoded++;
+
+        for (int i = 0; i < CHANNELS; i++)
+        {
+            mismatches += (frame.samples[i] != frames[frame.seq][i]);
+        }
+    });
+
+    decoder.feed(received.data(), received.size());
+
+    CHECK(stream.get_dropped() > 0);
+    CHECK_EQ(decoded + stream.get_dropped(), FRAMES);
+    CHECK_EQ(mismatches, 0);
+    CHECK_EQ(decoder.get_stats().checksum_errors, 0);
+    CHECK_EQ(decoder.get_stats().undecodable, 0);
+    CHECK_EQ(decoder.get_stats().discarded_bytes, 0);
+
+    // Key frames are packed unless a sample exceeds 10 bits.
+    if (limit > 0x3FF)
+    {
+        CHECK(count_frames(received, SCAN_STREAM_FRAME_VARINT) > 0);
+    }
+    else
+    {
+        CHECK_EQ(count_frames(received, SCAN_STREAM_FRAME_VARINT), 0);
+    }
+
+    CHECK(count_frames(received, SCAN_STREAM_FRAME_PACKED10) > 0);
+
+    stream.end();
+}
+
+// Frames encoded for replay decode to the samples encoded.
+static void check_replay()
+{
+    std::vector<uint8_t> frame;
+    std::vector<uint16_t> samples(CHANNELS);
+    uint64_t decoded = 0, mismatches = 0;
+
+    ScanStreamDecoder decoder([&decoded, &mismatches](const scan_frame_t &frame)
+    {
+        decoded++;
+
+        for (int i = 0; i < CHANNELS; i++)
+        {
+            mismatches += (frame.samples[i] != frames[frame.seq][i]);
+        }
+    });
+
+    for (int k = 0; k < FRAMES; k++)
+    {
+        samples.assign(frames[k], frames[k] + CHANNELS);
+        ScanStreamDecoder::encode_key((uint8_t) k, samples, frame);
+        decoder.feed(frame.data(), frame.size());
+    }
+
+    CHECK_EQ(decoded, FRAMES);
+    CHECK_EQ(mismatches, 0);
+    CHECK_EQ(decoder.get_stats().checksum_errors, 0);
+}
+
+// Samples at the limits of each frame type, and differences at and beyond the delta limits.
+static const uint16_t limit_frames[][CHANNELS] =
+{
+    { 1023, 1023, 1023, 1023 },         // Packed key frame
+    { 1024, 1023, 2047, 0 },            // Delta frame
+    { 2047, 0, 32767, 1023 },           // Varint key frame, difference of 30720
+    { 16384, 1024, 32767, 0 },          // Delta frame
+    { 32767, 1024, 16384, 16383 },      // Delta frame, differences of 16383 and -16383
+    { 16383, 1024, 0, 0 },              // Delta frame, differences of -16384
+    { 32767, 0, 32767, 32767 },         // Varint key frame, difference of 16384
+};
+
+#define LIMIT_FRAMES    (sizeof(limit_frames) / sizeof(limit_frames[0]))
+
+static void check_limits()
+{
+    std::vector<uint8_t> received;
+    ScanStream stream;
+    uint64_t decoded = 0, mismatches = 0;
+
+    sim_reset();
+    sim_serial_sink = [&received](uint8_t c) { received.push_back(c); };
+    sim_serial_available_for_write = []() { return 1000; };
+
+    stream.begin(Serial, CHANNELS, ScanStream::ENCODING_DELTA, 128, 255);
+
+    for (size_t k = 0; k < LIMIT_FRAMES; k++)
+    {
+        CHECK(stream.write_frame(limit_frames[k]));
+        stream.poll();
+    }
+
+    ScanStreamDecoder decoder([&decoded, &mismatches](const scan_frame_t &frame)
+    {
+        decoded++;
+
+        for (int i = 0; i < CHANNELS; i++)
+        {
+            mismatches += (frame.samples[i] != limit_frames[frame.seq][i]);
+        }
+    });
+
+    decoder.feed(received.data(), received.size());
+
+    CHECK_EQ(decoded, LIMIT_FRAMES);
+    CHECK_EQ(mismatches, 0);
+    CHECK_EQ(decoder.get_stats().checksum_errors, 0);
+    CHECK_EQ(decoder.get_stats().undecodable, 0);
+    CHECK_EQ(count_frames(received, SCAN_STREAM_FRAME_PACKED10), 1);
+    CHECK_EQ(count_frames(received, SCAN_STREAM_FRAME_DELTA), 4);
+    CHECK_EQ(count_frames(received, SCAN_STREAM_FRAME_VARINT), 2);
+
+    stream.end();
+}
+
+int main()
+{
+    // 10-bit samples, then lock-in samples up to 2047.
+    for (uint16_t limit = 0x3FF; limit <= 0x7FF; limit += 0x400)
+    {
+        fill_frames(limit);
+        check_encoding(ScanStream::ENCODING_PACKED10, limit);
+        check_encoding(ScanStream::ENCODING_DELTA, limit);
+        check_replay();
+    }
+
+    check_limits();
+
+    return check_result("test_stream");
+}
@@ -0,0 +1,173 @@
+/**
+ * @file test_tone.cpp
+ * @author Hobbylad ()
+ * @brief Tone detection with Goertzel filters.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Tones of 100 and 300 codes sampled at 3200Hz locked to 50Hz mains read within 1/4 code in blocks of
+ * 128 conversions with an empty bin reading 0, and a 20kHz tone of 200 codes free running within 1/2
+ * code. Injected measurements are taken within a few conversions while a block is in progress, and
+ * with an injected measurement every 1.4ms the blocks keep their length and the tone its phase, so it
+ * reads lower only by the conversions missed.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "ScanTone.h"
+#include "Sim.h"
+#include "Check.h"
+
+#include <math.h>
+
+static double amplitude_1 = 300.0, frequency_1 = 1200.0, amplitude_2 = 100.0, frequency_2 = 700.0;
+static uint64_t inject_conversions, injected_conversions;
+static uint16_t injected_sample;
+static ScanTone tone;
+
+// Two tones on ADC7, a level of 400 on ADC5 and 300 elsewhere.
+static uint16_t tone_signal(uint8_t mux, uint64_t t_ns)
+{
+    double t = t_ns * 1e-9;
+
+    if (mux == ScanADC::MUX_ADC7)
+    {
+        return (uint16_t) lround(512.0 + amplitude_1 * sin(2 * M_PI * frequency_1 * t) +
+                                 amplitude_2 * sin(2 * M_PI * frequency_2 * t + 1.0));
+    }
+
+    return (mux == ScanADC::MUX_ADC5) ? 400 : 300;
+}
+
+// Lets blocks end.
+static bool next_blocks(int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        uint8_t sn = tone.get_sn();
+
+        for (uint32_t n = 0; tone.get_sn() == sn; n += 100)
+        {
+            if (n >= 400000)
+            {
+                return false;
+            }
+
+            sim_run(100);
+        }
+    }
+
+    return true;
+}
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    ScanADC::channel_config_t config[2] = {};
+    static const uint16_t frequencies[] = { 700, 1200, 950 };
+    static const uint16_t ultrasonic[] = { 20000, 25000 };
+
+    config[0].mux = ScanADC::MUX_ADC6;
+    config[0].sample_count_log2 = 2;
+    config[1].mux = ScanADC::MUX_ADC7;
+    config[1].settle = 2;
+
+    sim_reset();
+    sim_signal = tone_signal;
+
+    CHECK(!tone.begin(frequencies, 3, 3200, 4));
+    CHECK(!tone.begin(frequencies, 5, 3200, 7));
+    CHECK(!tone.begin(frequencies, 3, 2000, 7));
+
+    adc.begin(config, 2);
+
+#if !defined(SIM_MEGAAVR0)
+    CHECK(tone.begin(frequencies, 3, 3200, 7));
+    adc.set_mains(ScanADC::MAINS_50HZ);
+    adc.attach_tone(1, &tone);
+
+    CHECK(next_blocks(2));
+    CHECK_NEAR(tone.get_magnitude(0), 100 * 16, 4);
+    CHECK_NEAR(tone.get_magnitude(1), 300 * 16, 4);
+    CHECK(tone.get_magnitude(2) <= 4);
+    CHECK_EQ(adc.get_sample(1), 512);
+    CHECK_EQ(adc.get_sample(0), 300);
+
+    adc.detach_tone(&tone);
+    next_blocks(1);
+    adc.set_mains(ScanADC::MAINS_OFF);
+#endif
+
+    CHECK(tone.begin(ultrasonic, 2, 76923, 9));
+    amplitude_1 = 200.0;
+    frequency_1 = 20000.0;
+    amplitude_2 = 0.0;
+    adc.attach_tone(1, &tone);
+
+    CHECK(next_blocks(3));
+    CHECK_NEAR(tone.get_magnitude(0), 200 * 16, 8);
+    CHECK(tone.get_magnitude(1) < 2 * 16);
+    CHECK_EQ(adc.get_sample(1), 512);
+
+    // Injected measurements part way through blocks.
+    for (int i = 0; i < 20; i++)
+    {
+        sim_run_us(1000 + 177 * i);
+
+        inject_conversions = sim_stats.conversions;
+        injected_conversions = 0;
+        adc.inject(ScanADC::MUX_ADC5, 1, [](uint16_t sample)
+        {
+            injected_conversions = sim_stats.conversions;
+            injected_sample = sample;
+        });
+        sim_run_us(500);
+
+        CHECK(injected_conversions > inject_conversions);
+        CHECK(injected_conversions - inject_conversions <= 2 + 2);
+        CHECK_EQ(injected_sample, 400);
+    }
+
+    // The blocks continue over the injected measurements, each missing at most 6 conversions.
+    for (int k = 0; k < 6; k++)
+    {
+        uint8_t sn = tone.get_sn();
+
+        for (int i = 0; i < 5; i++)
+        {
+            adc.inject(ScanADC::MUX_ADC5, 0);
+            sim_run_us(1400);
+        }
+
+        CHECK_EQ((uint8_t)(tone.get_sn() - sn), 1);
+        CHECK(tone.get_magnitude(0) >= 200 * 16 * (512 - 5 * 6) / 512 - 8);
+        CHECK(tone.get_magnitude(0) <= 200 * 16 + 8);
+        CHECK_NEAR(adc.get_sample(1), 512, 2);
+    }
+
+    adc.end();
+
+    return check_result("test_tone");
+}
@@ -0,0 +1,176 @@
+/**
+ * @file test_touch.cpp
+ * @author Hobbylad ()
+ * @brief Capacitive touch keys.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * A 15pF pad on PB3 sharing its charge with a 14pF sample and hold capacitor reads a rise of over 100
+ * codes when a 10pF touch is added, stays touched while held and is released with the touch. A 3pF
+ * drift spread over 300000 conversions is followed by the baseline without a touch being reported.
+ * The pad is never driven while it is converted, and injected measurements do not disturb it.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanADC.h"
+#include "Sim.h"
+#include "Check.h"
+
+static double hold, pad, pad_pf = 15.0, drift_pf;
+static uint8_t latched_port, latched_ddr;
+static uint32_t conversions, driven_while_converted;
+
+// Charge sharing of the pad on PB3 wired to ADC7 with the pin state at the start of the conversion,
+// which on the classic devices is the state at the conversion before as the next conversion starts
+// before the ISR.
+static uint16_t pad_signal(uint8_t mux, uint64_t)
+{
+#if defined(SIM_MEGAAVR0)
+    uint8_t port = PORTB, ddr = DDRB;
+#else
+    uint8_t port = latched_port, ddr = latched_ddr;
+#endif
+
+    latched_port = PORTB;
+    latched_ddr = DDRB;
+    conversions++;
+
+    if ((ddr & 0x08) && (port & 0x08))
+    {
+        pad = 1023.0;
+    }
+
+    if (mux == ScanADC::MUX_ADC7)
+    {
+        double c = pad_pf + drift_pf;
+
+        driven_while_converted += !!(ddr & 0x08);
+        hold = pad = (pad * c + hold * 14.0) / (c + 14.0);
+    }
+    else
+    {
+        hold = (mux == ScanADC::MUX_0V0) ? 0.0 : 300.0;
+    }
+
+    return (uint16_t)(hold + 0.5);
+}
+
+int main()
+{
+    ScanADC &adc = ScanADC::getInstance();
+    ScanADC::channel_config_t config[2] = {};
+
+    config[0].mux = ScanADC::MUX_ADC6;
+    config[0].sample_count_log2 = 2;
+    config[1].mux = ScanADC::MUX_ADC7;
+    config[1].sample_count_log2 = 3;
+    config[1].mode = ScanADC::CHANNEL_TOUCH;
+    config[1].mode_arg = 11;
+    config[1].median = 5;
+
+    sim_reset();
+    sim_signal = pad_signal;
+    PORTB = 0x81;
+    DDRB = 0x80;
+
+    adc.begin(config, 2);
+    sim_run(2000);
+
+    uint16_t untouched = adc.get_sample(1);
+
+    CHECK(untouched > 400);
+    CHECK_NEAR(adc.get_touch_delta(1), 0, 1);
+    CHECK(!adc.is_touched(1));
+    CHECK_EQ(adc.get_sample(0), 300);
+
+    pad_pf = 25.0;
+    sim_run(300);
+
+    CHECK(adc.get_touch_delta(1) > 100);
+    CHECK(adc.is_touched(1));
+
+    // The baseline does not follow a touch.
+    sim_run(20000);
+
+    CHECK(adc.get_touch_delta(1) > 100);
+    CHECK(adc.is_touched(1));
+
+    pad_pf = 15.0;
+    sim_run(300);
+
+    CHECK_EQ(adc.get_sample(1), untouched);
+    CHECK_NEAR(adc.get_touch_delta(1), 0, 1);
+    CHECK(!adc.is_touched(1));
+
+    int16_t delta_max = 0;
+    bool touched = false;
+
+    for (int i = 0; i < 300; i++)
+    {
+        drift_pf = i * 0.01;
+        sim_run(1000);
+
+        delta_max = (adc.get_touch_delta(1) > delta_max) ? adc.get_touch_delta(1) : delta_max;
+        touched |= adc.is_touched(1);
+    }
+
+    CHECK(adc.get_sample(1) > untouched + 30);
+    CHECK(delta_max <= 3);
+    CHECK(!touched);
+
+    // Charge, share and convert, without median priming, for each of the 8 samples, and on classic
+    // devices the conversion of the touch pad discarded when switching to the other channel.
+    uint8_t sn = adc.get_sn(1);
+    uint32_t start = conversions;
+
+    sim_run(1000);
+
+    uint32_t per_scan = (conversions - start) / (uint8_t)(adc.get_sn(1) - sn);
+
+#if defined(SIM_MEGAAVR0)
+    CHECK_NEAR(per_scan, 8 * 2 + 4, 2);
+#else
+    CHECK_NEAR(per_scan, 8 * 3 + 4 + 1, 2);
+#endif
+    CHECK_EQ(driven_while_converted, 0);
+    CHECK_EQ(PORTB & 0x80, 0x80);
+    CHECK_EQ(DDRB & 0x80, 0x80);
+
+    for (int i = 0; i < 30; i++)
+    {
+        adc.inject(ScanADC::MUX_ADC5, 0);
+        sim_run(5 + i);
+    }
+
+    sim_run(500);
+
+    CHECK_NEAR(adc.get_touch_delta(1), 0, 3);
+    CHECK(!adc.is_touched(1));
+    CHECK_EQ(driven_while_converted, 0);
+
+    adc.end();
+
+    return check_result("test_touch");
+}
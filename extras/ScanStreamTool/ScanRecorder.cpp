@@ -0,0 +1,182 @@
+/**
+ * @file ScanRecorder.cpp
+ * @author Hobbylad ()
+ * @brief Memory mapped columnar recording of decoded ScanStream frames.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanRecorder.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ScanRecorder::ScanRecorder() :
+    fd(-1), size(0), base(NULL), header(NULL), seq(NULL), samples(NULL)
+{
+}
+
+ScanRecorder::~ScanRecorder()
+{
+    close();
+}
+
+bool ScanRecorder::create(const char *path, uint32_t channel_count, uint64_t capacity)
+{
+    close();
+
+    fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    scan_record_header_t h;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SCAN_RECORD_MAGIC, sizeof(h.magic));
+    h.version = SCAN_RECORD_VERSION;
+    h.channel_count = channel_count;
+    h.capacity = capacity;
+    h.frame_count = 0;
+    h.seq_offset = sizeof(scan_record_header_t);
+    h.sample_offset = h.seq_offset + (capacity * sizeof(uint64_t));
+
+    uint64_t file_size = h.sample_offset + (capacity * channel_count * sizeof(uint16_t));
+
+    if ((ftruncate(fd, (off_t) file_size) != 0) ||
+        (pwrite(fd, &h, sizeof(h), 0) != (ssize_t) sizeof(h)))
+    {
+        close();
+        return false;
+    }
+
+    return map(true);
+}
+
+bool ScanRecorder::open(const char *path)
+{
+    close();
+
+    fd = ::open(path, O_RDONLY);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    return map(false);
+}
+
+bool ScanRecorder::map(bool writable)
+{
+    struct stat st;
+
+    if ((fstat(fd, &st) != 0) || ((size_t) st.st_size < sizeof(scan_record_header_t)))
+    {
+        close();
+        return false;
+    }
+
+    size = (size_t) st.st_size;
+
+    void *p = mmap(NULL, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+
+    if (p == MAP_FAILED)
+    {
+        size = 0;
+        close();
+        return false;
+    }
+
+    base = (uint8_t *) p;
+    header = (scan_record_header_t *) base;
+
+    uint64_t expected_size = header->sample_offset +
+                             (header->capacity * header->channel_count * sizeof(uint16_t));
+
+    if ((memcmp(header->magic, SCAN_RECORD_MAGIC, sizeof(header->magic)) != 0) ||
+        (header->version != SCAN_RECORD_VERSION) ||
+        (header->frame_count > header->capacity) ||
+        (expected_size > size))
+    {
+        close();
+        return false;
+    }
+
+    seq = (uint64_t *)(base + header->seq_offset);
+    samples = (uint16_t *)(base + header->sample_offset);
+
+    return true;
+}
+
+bool ScanRecorder::append(const scan_frame_t &frame)
+{
+    if (!header || (header->frame_count >= header->capacity) ||
+        (frame.samples.size() != header->channel_count))
+    {
+        return false;
+    }
+
+    uint64_t i = header->frame_count;
+
+    seq[i] = frame.seq;
+
+    for (uint32_t c = 0; c < header->channel_count; c++)
+    {
+        samples[(c * header->capacity) + i] = frame.samples[c];
+    }
+
+    // Publish the frame after its columns are written.
+    header->frame_count = i + 1;
+
+    return true;
+}
+
+void ScanRecorder::close()
+{
+    if (base)
+    {
+        msync(base, size, MS_SYNC);
+        munmap(base, size);
+    }
+
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+
+    fd = -1;
+    size = 0;
+    base = NULL;
+    header = NULL;
+    seq = NULL;
+    samples = NULL;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file ScanRecorder.h
+ * @author Hobbylad ()
+ * @brief Memory mapped columnar recording of decoded ScanStream frames.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * A recording is a single file with a fixed size header followed by one column per field, so each
+ * channel can be analysed in place as a contiguous array without copying:
+ *
+ * | Offset              | Content                                                     |
+ * |---------------------|-------------------------------------------------------------|
+ * | 0                   | scan_record_header_t                                        |
+ * | seq_offset          | capacity x uint64_t extended frame sequence numbers         |
+ * | sample_offset       | capacity x uint16_t samples of channel 0                    |
+ * | ...                 | capacity x uint16_t samples of each further channel         |
+ *
+ * All values are little endian. Only the first frame_count entries of each column are valid.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCAN_RECORDER_H
+#define SCAN_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ScanStreamDecoder.h"
+
+#define SCAN_RECORD_MAGIC           "SCANREC1"  // File identification.
+#define SCAN_RECORD_VERSION         1           // File format version.
+
+/**
+ * @brief Recording file header.
+ */
+struct scan_record_header_t
+{
+    char magic[8];                              /**< SCAN_RECORD_MAGIC without terminator. */
+    uint32_t version;                           /**< SCAN_RECORD_VERSION. */
+    uint32_t channel_count;                     /**< Channels per frame. */
+    uint64_t capacity;                          /**< Frames the columns can hold. */
+    uint64_t frame_count;                       /**< Frames recorded. */
+    uint64_t seq_offset;                        /**< File offset of sequence number column. */
+    uint64_t sample_offset;                     /**< File offset of channel 0 sample column. */
+    uint8_t reserved[16];                       /**< Zero. Pads header to 64 bytes. */
+};
+
+/**
+ * @brief Class to write or read a memory mapped columnar recording of frames.
+ */
+class ScanRecorder
+{
+    public:
+
+    /**
+    * @brief Constructs a closed recorder.
+    */
+    ScanRecorder();
+
+    /**
+    * @brief Closes the recording.
+    */
+    ~ScanRecorder();
+
+    /**
+    * @brief Creates a recording, replacing any existing file.
+    *
+    * The file is sized for @a capacity frames up front. Space not written remains sparse on
+    * file systems that support it.
+    *
+    * @param[in] path          File path.
+    * @param[in] channel_count Channels per frame.
+    * @param[in] capacity      Maximum frames to record.
+    * @return bool True if created.
+    */
+    bool create(const char *path, uint32_t channel_count, uint64_t capacity);
+
+    /**
+    * @brief Opens an existing recording read only.
+    *
+    * @param[in] path File path.
+    * @return bool True if opened and the header is valid.
+    */
+    bool open(const char *path);
+
+    /**
+    * @brief Appends a frame to a created recording.
+    *
+    * @param[in] frame Decoded frame with channel count samples.
+    * @return bool True if appended, false if full or the channel count differs.
+    */
+    bool append(const scan_frame_t &frame);
+
+    /**
+    * @brief Flushes and unmaps the recording.
+    */
+    void close();
+
+    /**
+    * @brief Get the channels per frame.
+    *
+    * @return uint32_t Channel count.
+    */
+    inline uint32_t get_channel_count() const
+    {
+        return header ? header->channel_count : 0;
+    }
+
+    /**
+    * @brief Get the frames recorded.
+    *
+    * @return uint64_t Frame count.
+    */
+    inline uint64_t get_frame_count() const
+    {
+        return header ? header->frame_count : 0;
+    }
+
+    /**
+    * @brief Get the sequence number column.
+    *
+    * @return const uint64_t* Frame count sequence numbers.
+    */
+    inline const uint64_t *get_seq() const
+    {
+        return seq;
+    }
+
+    /**
+    * @brief Get a channel sample column.
+    *
+    * @param[in] channel Channel index.
+    * @return const uint16_t* Frame count samples.
+    */
+    inline const uint16_t *get_channel(uint32_t channel) const
+    {
+        return samples + (channel * header->capacity);
+    }
+
+    private:
+
+    /**
+    * @brief Prevent copy constructor.
+    */
+    ScanRecorder(const ScanRecorder &) = delete;
+
+    /**
+    * @brief Prevent assignment.
+    */
+    ScanRecorder& operator=(const ScanRecorder &) = delete;
+
+    /**
+    * @brief Maps the open file and sets the column pointers.
+    *
+    * @param[in] writable Map for writing.
+    * @return bool True if mapped.
+    */
+    bool map(bool writable);
+
+    int fd;                                     // File descriptor.
+    size_t size;                                // Mapped size.
+    uint8_t *base;                              // Mapped file.
+    scan_record_header_t *header;               // Header within mapping.
+    uint64_t *seq;                              // Sequence number column within mapping.
+    uint16_t *samples;                          // Channel 0 sample column within mapping.
+};
+
+#endif
@@ -0,0 +1,276 @@
+/**
+ * @file ScanStreamDecoder.cpp
+ * @author Hobbylad ()
+ * @brief Host side decoder of the ScanStream binary frame stream.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Decodes the frames produced by the ScanStream class of the ScanADC library on a Linux host. The
+ * frame format is documented in src/ScanStream.h.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "ScanStreamDecoder.h"
+
+ScanStreamDecoder::ScanStreamDecoder(frame_handler_t handler) :
+    handler(handler), stats(), has_last(false), synced(false), last_seq(0)
+{
+}
+
+void ScanStreamDecoder::feed(const uint8_t *data, size_t size)
+{
+    pending.insert(pending.end(), data, data + size);
+
+    const uint8_t *p = pending.data();
+    size_t i = 0;
+
+    while ((pending.size() - i) >= SCAN_STREAM_HEADER_SIZE)
+    {
+        if ((p[i] != SCAN_STREAM_SYNC0) || (p[i + 1] != SCAN_STREAM_SYNC1))
+        {
+            stats.discarded_bytes++;
+            i++;
+            continue;
+        }
+
+        size_t frame_size = SCAN_STREAM_HEADER_SIZE + p[i + 5] + SCAN_STREAM_CHECKSUM_SIZE;
+
+        if ((pending.size() - i) < frame_size)
+        {
+            break;
+        }
+
+        // Fletcher-16 checksum from type to end of payload.
+        uint16_t sum1 = 0, sum2 = 0;
+
+        for (size_t j = i + 2; j < i + frame_size - SCAN_STREAM_CHECKSUM_SIZE; j++)
+        {
+            sum1 = (sum1 + p[j]) % 255;
+            sum2 = (sum2 + sum1) % 255;
+        }
+
+        if ((p[i + frame_size - 2] != sum1) || (p[i + frame_size - 1] != sum2))
+        {
+            // Either a corrupted frame or sync bytes within data, so resynchronise from the next byte.
+            stats.checksum_errors++;
+            stats.discarded_bytes++;
+            i++;
+            continue;
+        }
+
+        decode(p + i);
+        i += frame_size;
+    }
+
+    pending.erase(pending.begin(), pending.begin() + i);
+}
+
+void ScanStreamDecoder::decode(const uint8_t *frame)
+{
+    uint8_t type = frame[2], sn = frame[3], count = frame[4], length = frame[5];
+    const uint8_t *payload = frame + SCAN_STREAM_HEADER_SIZE;
+    uint64_t seq = sn;
+    uint8_t gap = 0;
+
+    if (synced)
+    {
+        gap = (uint8_t)(sn - (uint8_t)(last_seq + 1));
+        seq = last_seq + 1 + gap;
+        stats.dropped += gap;
+    }
+
+    synced = true;
+    last_seq = seq;
+
+    scan_frame_t decoded;
+    decoded.seq = seq;
+    decoded.samples.resize(count);
+
+    if (type == SCAN_STREAM_FRAME_PACKED10)
+    {
+        if (length != ((count * 10 + 7) / 8))
+        {
+            stats.checksum_errors++;
+            has_last = false;
+            return;
+        }
+
+        uint32_t bits = 0;
+        uint8_t bit_cnt = 0;
+
+        for (uint8_t i = 0; i < count; i++)
+        {
+            while (bit_cnt < 10)
+            {
+                bits |= (uint32_t)(*payload++) << bit_cnt;
+                bit_cnt += 8;
+            }
+
+            decoded.samples[i] = bits & 0x3FF;
+            bits >>= 10;
+            bit_cnt -= 10;
+        }
+    }
+    else if ((type == SCAN_STREAM_FRAME_DELTA) || (type == SCAN_STREAM_FRAME_VARINT))
+    {
+        bool delta = (type == SCAN_STREAM_FRAME_DELTA);
+
+        if (delta && (!has_last || gap || (last.samples.size() != count)))
+        {
+            stats.undecodable++;
+            has_last = false;
+            return;
+        }
+
+        const uint8_t *end = payload + length;
+
+        for (uint8_t i = 0; i < count; i++)
+        {
+            uint16_t zigzag;
+
+            if (payload >= end)
+            {
+                stats.checksum_errors++;
+                has_last = false;
+                return;
+            }
+
+            zigzag = *payload++;
+
+            if (zigzag & 0x80)
+            {
+                if (payload >= end)
+                {
+                    stats.checksum_errors++;
+                    has_last = false;
+                    return;
+                }
+
+                zigzag = (zigzag & 0x7F) | ((uint16_t)(*payload++) << 7);
+            }
+
+            if (!delta)
+            {
+                decoded.samples[i] = zigzag;
+                continue;
+            }
+
+            int16_t difference = (int16_t)((zigzag >> 1) ^ (uint16_t)(-(int16_t)(zigzag & 1)));
+
+            decoded.samples[i] = (uint16_t)(last.samples[i] + difference);
+        }
+
+        if (payload != end)
+        {
+            stats.checksum_errors++;
+            has_last = false;
+            return;
+        }
+    }
+    else
+    {
+        stats.checksum_errors++;
+        has_last = false;
+        return;
+    }
+
+    stats.frames++;
+    last = decoded;
+    has_last = true;
+
+    handler(decoded);
+}
+
+void ScanStreamDecoder::encode_key(uint8_t sn, const std::vector<uint16_t> &samples, std::vector<uint8_t> &frame)
+{
+    uint8_t count = (uint8_t) samples.size();
+    bool packed = true;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        packed = packed && (samples[i] <= 0x3FF);
+    }
+
+    frame.clear();
+    frame.push_back(SCAN_STREAM_SYNC0);
+    frame.push_back(SCAN_STREAM_SYNC1);
+    frame.push_back(packed ? SCAN_STREAM_FRAME_PACKED10 : SCAN_STREAM_FRAME_VARINT);
+    frame.push_back(sn);
+    frame.push_back(count);
+    frame.push_back(0);
+
+    if (packed)
+    {
+        uint32_t bits = 0;
+        uint8_t bit_cnt = 0;
+
+        for (uint8_t i = 0; i < count; i++)
+        {
+            bits |= (uint32_t) samples[i] << bit_cnt;
+            bit_cnt += 10;
+
+            while (bit_cnt >= 8)
+            {
+                frame.push_back((uint8_t) bits);
+                bits >>= 8;
+                bit_cnt -= 8;
+            }
+        }
+
+        if (bit_cnt)
+        {
+            frame.push_back((uint8_t) bits);
+        }
+    }
+    else
+    {
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (samples[i] < 0x80)
+            {
+                frame.push_back((uint8_t) samples[i]);
+            }
+            else
+            {
+                frame.push_back((uint8_t) samples[i] | 0x80);
+                frame.push_back((uint8_t)(samples[i] >> 7));
+            }
+        }
+    }
+
+    frame[5] = (uint8_t)(frame.size() - SCAN_STREAM_HEADER_SIZE);
+
+    uint16_t sum1 = 0, sum2 = 0;
+
+    for (size_t j = 2; j < frame.size(); j++)
+    {
+        sum1 = (sum1 + frame[j]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+
+    frame.push_back((uint8_t) sum1);
+    frame.push_back((uint8_t) sum2);
+}
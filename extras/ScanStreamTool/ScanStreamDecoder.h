@@ -0,0 +1,144 @@
+/**
+ * @file ScanStreamDecoder.h
+ * @author Hobbylad ()
+ * @brief Host side decoder of the ScanStream binary frame stream.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Decodes the frames produced by the ScanStream class of the ScanADC library on a Linux host. The
+ * frame format is documented in src/ScanStream.h.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCAN_STREAM_DECODER_H
+#define SCAN_STREAM_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+#define SCAN_STREAM_SYNC0           0xA5        // First frame synchronisation byte.
+#define SCAN_STREAM_SYNC1           0x5A        // Second frame synchronisation byte.
+#define SCAN_STREAM_HEADER_SIZE     6           // Sync, type, sequence number, channel count and payload length.
+#define SCAN_STREAM_CHECKSUM_SIZE   2           // Fletcher-16 checksum.
+#define SCAN_STREAM_FRAME_PACKED10  0x01        // 10-bit samples packed back to back.
+#define SCAN_STREAM_FRAME_DELTA     0x02        // Zigzag varint differences to previous frame.
+#define SCAN_STREAM_FRAME_VARINT    0x03        // Varint samples when a sample exceeds 10 bits.
+
+/**
+ * @brief Decoded frame.
+ */
+struct scan_frame_t
+{
+    uint64_t seq;                               /**< Sequence number extended beyond 8 bits, counting dropped frames. */
+    std::vector<uint16_t> samples;              /**< Channel samples. */
+};
+
+/**
+ * @brief Decoder statistics.
+ */
+struct scan_stream_stats_t
+{
+    uint64_t frames;                            /**< Frames decoded. */
+    uint64_t dropped;                           /**< Frames missing from the sequence numbers. */
+    uint64_t undecodable;                       /**< Delta frames received without their previous frame. */
+    uint64_t checksum_errors;                   /**< Frames with a checksum or format error. */
+    uint64_t discarded_bytes;                   /**< Bytes discarded while searching for synchronisation. */
+};
+
+/**
+ * @brief Class to decode a ScanStream byte stream into frames.
+ *
+ * Bytes are fed in as they are received in chunks of any size. The decoder searches for the sync
+ * bytes, validates the checksum and sequence number, and calls the frame handler for every frame it
+ * can decode. Frames missing from the sequence are counted as dropped. Delta frames following a drop
+ * cannot be decoded and are counted until the next packed or varint key frame.
+ */
+class ScanStreamDecoder
+{
+    public:
+
+    /**
+    * @brief Definition of the frame handler called for each decoded frame.
+    */
+    typedef std::function<void(const scan_frame_t &frame)> frame_handler_t;
+
+    /**
+    * @brief Constructs a decoder calling @a handler for each decoded frame.
+    *
+    * @param[in] handler Frame handler.
+    */
+    explicit ScanStreamDecoder(frame_handler_t handler);
+
+    /**
+    * @brief Decodes received bytes.
+    *
+    * @param[in] data Received bytes.
+    * @param[in] size Received byte count.
+    */
+    void feed(const uint8_t *data, size_t size);
+
+    /**
+    * @brief Get the decoder statistics.
+    *
+    * @return const scan_stream_stats_t& Statistics.
+    */
+    inline const scan_stream_stats_t &get_stats() const
+    {
+        return stats;
+    }
+
+    /**
+    * @brief Encodes a key frame in the ScanStream format, packed unless a sample exceeds 10 bits.
+    *
+    * Used to replay recorded frames as a stream.
+    *
+    * @param[in]  sn      Frame sequence number.
+    * @param[in]  samples Channel samples.
+    * @param[out] frame   Encoded frame.
+    */
+    static void encode_key(uint8_t sn, const std::vector<uint16_t> &samples, std::vector<uint8_t> &frame);
+
+    private:
+
+    /**
+    * @brief Decodes a complete frame with a valid checksum.
+    *
+    * @param[in] frame Frame bytes from the first sync byte.
+    */
+    void decode(const uint8_t *frame);
+
+    frame_handler_t handler;                    // Frame handler.
+    std::vector<uint8_t> pending;               // Received bytes not yet decoded.
+    scan_stream_stats_t stats;                  // Statistics.
+    scan_frame_t last;                          // Last decoded frame for delta decoding.
+    bool has_last;                              // Last decoded frame is the last frame received.
+    bool synced;                                // At least one frame received.
+    uint64_t last_seq;                          // Sequence number of last frame received.
+};
+
+#endif
@@ -0,0 +1,366 @@
+/**
+ * @file ScanStreamTool.cpp
+ * @author Hobbylad ()
+ * @brief Linux command line tool to record, dump and replay ScanStream frame streams.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * Usage:
+ *
+ *   scan_stream record <input> <recording> [-b baud] [-n capacity]
+ *       Decodes the frame stream from a serial device, file or - for stdin, validating sequence
+ *       numbers, and writes the frames to a memory mapped columnar recording. Stops at end of
+ *       input or on SIGINT and prints the decoder statistics.
+ *
+ *   scan_stream dump <recording>
+ *       Prints a recording as comma separated values.
+ *
+ *   scan_stream replay <recording> [-r frames_per_second]
+ *       Creates a pseudo-terminal, prints its device path and writes the recording to it as a
+ *       packed frame stream with the recorded sequence numbers, so drops are replayed too. The
+ *       device can be recorded again to test the receive path without hardware.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanRecorder.h"
+#include "ScanStreamDecoder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <vector>
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int)
+{
+    stop_requested = 1;
+}
+
+static speed_t baud_to_speed(long baud)
+{
+    switch (baud)
+    {
+        case 9600:    return B9600;
+        case 19200:   return B19200;
+        case 38400:   return B38400;
+        case 57600:   return B57600;
+        case 115200:  return B115200;
+        case 230400:  return B230400;
+        case 460800:  return B460800;
+        case 500000:  return B500000;
+        case 921600:  return B921600;
+        case 1000000: return B1000000;
+        case 2000000: return B2000000;
+        default:      return B0;
+    }
+}
+
+// Opens the input, configuring a terminal device for raw input at the baud rate.
+static int open_input(const char *path, long baud)
+{
+    int fd = (strcmp(path, "-") == 0) ? STDIN_FILENO : open(path, O_RDONLY | O_NOCTTY);
+
+    if ((fd >= 0) && isatty(fd))
+    {
+        struct termios tio;
+
+        if (tcgetattr(fd, &tio) == 0)
+        {
+            speed_t speed = baud_to_speed(baud);
+
+            cfmakeraw(&tio);
+            tio.c_cc[VMIN] = 1;
+            tio.c_cc[VTIME] = 0;
+
+            if (speed != B0)
+            {
+                cfsetispeed(&tio, speed);
+                cfsetospeed(&tio, speed);
+            }
+
+            tcsetattr(fd, TCSANOW, &tio);
+        }
+    }
+
+    return fd;
+}
+
+static int record(const char *input, const char *path, long baud, uint64_t capacity)
+{
+    int fd = open_input(input, baud);
+
+    if (fd < 0)
+    {
+        fprintf(stderr, "Cannot open %s: %s\n", input, strerror(errno));
+        return 1;
+    }
+
+    ScanRecorder recorder;
+    bool created = false, full = false;
+
+    ScanStreamDecoder decoder([&](const scan_frame_t &frame)
+    {
+        if (!created)
+        {
+            created = recorder.create(path, (uint32_t) frame.samples.size(), capacity);
+
+            if (!created)
+            {
+                fprintf(stderr, "Cannot create %s: %s\n", path, strerror(errno));
+                stop_requested = 1;
+                return;
+            }
+        }
+
+        if (!recorder.append(frame) && !full)
+        {
+            fprintf(stderr, "Recording full or channel count changed, frames not recorded\n");
+            full = true;
+        }
+    });
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    uint8_t buffer[4096];
+
+    while (!stop_requested)
+    {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+
+        if (n > 0)
+        {
+            decoder.feed(buffer, (size_t) n);
+        }
+        else if ((n == 0) || (errno != EINTR))
+        {
+            break;
+        }
+    }
+
+    const scan_stream_stats_t &stats = decoder.get_stats();
+
+    fprintf(stderr, "frames %llu dropped %llu undecodable %llu checksum_errors %llu discarded_bytes %llu\n",
+            (unsigned long long) stats.frames, (unsigned long long) stats.dropped,
+            (unsigned long long) stats.undecodable, (unsigned long long) stats.checksum_errors,
+            (unsigned long long) stats.discarded_bytes);
+
+    recorder.close();
+
+    if (fd != STDIN_FILENO)
+    {
+        close(fd);
+    }
+
+    return 0;
+}
+
+static int dump(const char *path)
+{
+    ScanRecorder recorder;
+
+    if (!recorder.open(path))
+    {
+        fprintf(stderr, "Cannot open recording %s\n", path);
+        return 1;
+    }
+
+    uint32_t channel_count = recorder.get_channel_count();
+    uint64_t frame_count = recorder.get_frame_count();
+    const uint64_t *seq = recorder.get_seq();
+    std::vector<const uint16_t *> channels;
+
+    printf("seq");
+
+    for (uint32_t c = 0; c < channel_count; c++)
+    {
+        channels.push_back(recorder.get_channel(c));
+        printf(",ch%u", c);
+    }
+
+    printf("\n");
+
+    for (uint64_t i = 0; i < frame_count; i++)
+    {
+        printf("%llu", (unsigned long long) seq[i]);
+
+        for (uint32_t c = 0; c < channel_count; c++)
+        {
+            printf(",%u", channels[c][i]);
+        }
+
+        printf("\n");
+    }
+
+    return 0;
+}
+
+static int replay(const char *path, long rate)
+{
+    ScanRecorder recorder;
+
+    if (!recorder.open(path))
+    {
+        fprintf(stderr, "Cannot open recording %s\n", path);
+        return 1;
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if ((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0))
+    {
+        fprintf(stderr, "Cannot create pseudo-terminal: %s\n", strerror(errno));
+        return 1;
+    }
+
+    // Raw mode so frame bytes are not translated by the line discipline.
+    struct termios tio;
+
+    if (tcgetattr(master, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(master, TCSANOW, &tio);
+    }
+
+    printf("%s\n", ptsname(master));
+    fflush(stdout);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    uint32_t channel_count = recorder.get_channel_count();
+    uint64_t frame_count = recorder.get_frame_count();
+    const uint64_t *seq = recorder.get_seq();
+    std::vector<uint16_t> samples(channel_count);
+    std::vector<uint8_t> frame;
+    struct timespec period = { 0, 0 };
+
+    if (rate > 0)
+    {
+        period.tv_sec = 1 / rate;
+        period.tv_nsec = (1000000000L / rate) % 1000000000L;
+    }
+
+    for (uint64_t i = 0; (i < frame_count) && !stop_requested; i++)
+    {
+        for (uint32_t c = 0; c < channel_count; c++)
+        {
+            samples[c] = recorder.get_channel(c)[i];
+        }
+
+        ScanStreamDecoder::encode_key((uint8_t) seq[i], samples, frame);
+
+        size_t written = 0;
+
+        while ((written < frame.size()) && !stop_requested)
+        {
+            ssize_t n = write(master, frame.data() + written, frame.size() - written);
+
+            if (n > 0)
+            {
+                written += (size_t) n;
+            }
+            else if (errno != EINTR)
+            {
+                fprintf(stderr, "Write failed: %s\n", strerror(errno));
+                return 1;
+            }
+        }
+
+        if (rate > 0)
+        {
+            nanosleep(&period, NULL);
+        }
+    }
+
+    // Allow the reader to drain the pseudo-terminal before it is closed.
+    tcdrain(master);
+    close(master);
+
+    return 0;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "  scan_stream record <input> <recording> [-b baud] [-n capacity]\n"
+            "  scan_stream dump <recording>\n"
+            "  scan_stream replay <recording> [-r frames_per_second]\n");
+}
+
+int main(int argc, char *argv[])
+{
+    long baud = 115200, rate = 1000;
+    uint64_t capacity = 1000000;
+    std::vector<const char *> args;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-b") == 0) && (i + 1 < argc))
+        {
+            baud = strtol(argv[++i], NULL, 0);
+        }
+        else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+        {
+            capacity = strtoull(argv[++i], NULL, 0);
+        }
+        else if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc))
+        {
+            rate = strtol(argv[++i], NULL, 0);
+        }
+        else
+        {
+            args.push_back(argv[i]);
+        }
+    }
+
+    if ((args.size() == 3) && (strcmp(args[0], "record") == 0))
+    {
+        return record(args[1], args[2], baud, capacity);
+    }
+
+    if ((args.size() == 2) && (strcmp(args[0], "dump") == 0))
+    {
+        return dump(args[1]);
+    }
+
+    if ((args.size() == 2) && (strcmp(args[0], "replay") == 0))
+    {
+        return replay(args[1], rate);
+    }
+
+    usage();
+
+    return 2;
+}
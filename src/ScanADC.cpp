@@ -42,183 +42,1777 @@
  */
 
 #include "ScanADC.h"
+#include "ScanKeypad.h"
+#include "ScanPower.h"
+#include "ScanTone.h"
 
 #include "Arduino.h"
 #include <avr/interrupt.h>
 
-ISR(ADC_vect)
+inline ScanADC::Group *ScanADC::schedule()
+{
+    Group *start = (group && group->next) ? group->next : groups;
+    Group *g = start;
+    Group *best = NULL;
+    uint16_t now_ms = (uint16_t) millis();
+
+    do
+    {
+        if (g->is_due(now_ms) && (!best || (g->priority > best->priority)))
+        {
+            best = g;
+        }
+
+        g = g->next ? g->next : groups;
+    }
+    while (g != start);
+
+    if (best && (best->chan_i == 0))
+    {
+        best->scan_start_ms = now_ms;
+    }
+
+    return best;
+}
+
+inline void ScanADC::prepare(uint8_t mux, uint8_t sample_count_log2, const reciprocal_t *reciprocal,
+                             uint8_t median, uint8_t settle)
+{
+    // The median filter needs every raw sample, so there is no hardware accumulation.
+    uint8_t hw_log2 = (median > 1) ? 0 : hw_sample_count_log2(reciprocal ? reciprocal->count_log2 : sample_count_log2);
+
+    settle_cnt = settle + (is_pipelined() ? 1 : 0);
+    accumulate_hw_log2 = hw_log2;
+
+    // Discarded conversions are single samples.
+    select(mux);
+    set_hw_sample_count_log2(settle_cnt ? 0 : hw_log2);
+
+    sample_reciprocal = reciprocal;
+
+    uint16_t count;
+
+    if (reciprocal)
+    {
+        this->sample_count_log2 = 0;
+        count = reciprocal->count;
+    }
+    else
+    {
+        this->sample_count_log2 = sample_count_log2;
+        count = 1U << sample_count_log2;
+    }
+
+    sample_cnt_target = count >> hw_log2;
+    sample_round = count >> 1;
+
+    if (median > 1)
+    {
+        median_n = median;
+        median_head = 0;
+        median_fill = 0;
+        accumulate_state = ISR_STATE_ACCUMULATE_MEDIAN;
+    }
+    else
+    {
+        // Up to 64 10-bit samples sum to at most 16 bits.
+        accumulate_state = (count <= SCAN_ADC_NARROW_SAMPLES) ? ISR_STATE_ACCUMULATE_NARROW : ISR_STATE_ACCUMULATE;
+    }
+
+    state = settle_cnt ? ISR_STATE_DELAY : accumulate_state;
+}
+
+inline void ScanADC::excite(bool on)
+{
+    if (exc_port)
+    {
+        *exc_port = on ? (*exc_port | exc_mask) : (*exc_port & ~exc_mask);
+    }
+}
+
+inline void ScanADC::prepare_lockin(uint8_t phase_log2, uint8_t sample_count_log2)
+{
+    if (phase_log2 > sample_count_log2)
+    {
+        phase_log2 = sample_count_log2;
+    }
+
+    uint8_t hw_log2 = hw_sample_count_log2(phase_log2);
+
+    // The settle count of prepare() applies after every switch of the excitation.
+    lockin_settle = settle_cnt;
+    accumulate_hw_log2 = hw_log2;
+    set_hw_sample_count_log2(settle_cnt ? 0 : hw_log2);
+
+    lockin_phase_cnt = 1U << (phase_log2 - hw_log2);
+    lockin_cnt = lockin_phase_cnt;
+    lockin_offset = (uint32_t) SCAN_ADC_LOCKIN_ZERO << hw_log2;
+
+    // Phases counted by the sample counter, even ones with the excitation on.
+    sample_cnt_target = 2U << (sample_count_log2 - phase_log2);
+
+    excite(!(sample_cnt & 1));
+
+    accumulate_state = ISR_STATE_ACCUMULATE_LOCKIN;
+    state = settle_cnt ? ISR_STATE_DELAY : accumulate_state;
+}
+
+inline void ScanADC::next_phase()
+{
+    excite(!(sample_cnt & 1));
+
+    lockin_cnt = lockin_phase_cnt;
+    settle_cnt = lockin_settle;
+
+    if (settle_cnt)
+    {
+        set_hw_sample_count_log2(0);
+        state = ISR_STATE_DELAY;
+    }
+}
+
+inline void ScanADC::prepare_touch(uint8_t mux, const touch_t &touch)
+{
+    // No hardware accumulation as every conversion of the pad follows a charge.
+    sample_cnt_target <<= accumulate_hw_log2;
+    accumulate_hw_log2 = 0;
+    set_hw_sample_count_log2(0);
+
+    touch_port = touch.port;
+    touch_ddr = touch.ddr;
+    touch_mask = touch.mask;
+    touch_mux = mux;
+
+    accumulate_state = ISR_STATE_TOUCH_CHARGE;
+    charge_touch();
+}
+
+inline void ScanADC::charge_touch()
+{
+    select(MUX_0V0);
+
+    *touch_port |= touch_mask;
+    *touch_ddr |= touch_mask;
+
+    state = ISR_STATE_TOUCH_SHARE;
+}
+
+inline void ScanADC::share_touch()
+{
+    // Input without pull-up, so the pad keeps its charge until the conversion samples it.
+    *touch_ddr &= ~touch_mask;
+    *touch_port &= ~touch_mask;
+
+    select(touch_mux);
+
+    settle_cnt = is_pipelined() ? 1 : 0;
+    state = settle_cnt ? ISR_STATE_DELAY : ISR_STATE_TOUCH_CHARGE;
+}
+
+inline void ScanADC::prepare_power(uint8_t mux, ScanPower *power, bool resume)
+{
+    // Every conversion is a sample of its own and the sample is the DC level without averaging.
+    accumulate_hw_log2 = 0;
+    set_hw_sample_count_log2(0);
+    sample_count_log2 = 0;
+    sample_reciprocal = NULL;
+
+    this->power = power;
+    power_v_mux = mux;
+    power_i_mux = power->current_mux;
+
+    if (resume)
+    {
+        power->resume();
+    }
+    else
+    {
+        power->start();
+    }
+
+    // The voltage is selected and the settle count discards its first conversions. When pipelined
+    // the last result discarded is of the previous input. It is taken in ISR_STATE_POWER_CURRENT,
+    // which ignores it as no voltage has been converted yet, while selecting the current keeps the
+    // inputs alternating two results ahead.
+    if (is_pipelined())
+    {
+        settle_cnt--;
+        accumulate_state = ISR_STATE_POWER_CURRENT;
+    }
+    else
+    {
+        accumulate_state = ISR_STATE_POWER_VOLTAGE;
+    }
+
+    state = settle_cnt ? ISR_STATE_DELAY : accumulate_state;
+}
+
+inline void ScanADC::prepare_tone(ScanTone *tone, bool resume)
+{
+    // The filters need every raw conversion and the sample is the mean of the block.
+    accumulate_hw_log2 = 0;
+    sample_count_log2 = 0;
+    sample_reciprocal = NULL;
+
+    if (!settle_cnt)
+    {
+        set_hw_sample_count_log2(0);
+    }
+
+    this->tone = tone;
+
+    if (!resume)
+    {
+        tone->start();
+    }
+
+    accumulate_state = ISR_STATE_TONE;
+    state = settle_cnt ? ISR_STATE_DELAY : accumulate_state;
+}
+
+inline void ScanADC::select_external(uint8_t address)
+{
+    if (address != ext_address)
+    {
+        ext_address = address;
+        *ext_port = (*ext_port & ~ext_mask) | ((uint8_t)(address << ext_shift) & ext_mask);
+    }
+}
+
+inline void ScanADC::prepare_channel(const Group *g, bool resume)
+{
+    uint8_t chan_i = g->order ? g->order[g->chan_i] : g->chan_i;
+    const reciprocal_t *reciprocal = NULL;
+
+    if (g->reciprocal && g->reciprocal[chan_i].count)
+    {
+        reciprocal = &g->reciprocal[chan_i];
+    }
+
+    const Group::channel_t &config = g->chan[chan_i];
+    ScanPower *power = g->powers;
+
+    ScanTone *tone = g->tones;
+
+    while (power && (power->channel != chan_i))
+    {
+        power = power->next;
+    }
+
+    while (tone && (tone->channel != chan_i))
+    {
+        tone = tone->next;
+    }
+
+    // Only the block paused by an injected measurement advances over the conversions missed.
+    tone_skip = tone_skip && resume && tone;
+
+    if ((config.mode == CHANNEL_EXT_MUX) && ext_port)
+    {
+        select_external(config.mode_arg);
+    }
+
+    prepare(config.mux, g->chan_log2[chan_i], reciprocal, config.median, config.settle);
+
+    if (power)
+    {
+        prepare_power(config.mux, power, resume);
+    }
+    else if (tone)
+    {
+        prepare_tone(tone, resume);
+    }
+    else if (config.mode == CHANNEL_TOUCH)
+    {
+        prepare_touch(config.mux, g->touch[chan_i]);
+    }
+    else if (config.mode == CHANNEL_LOCKIN)
+    {
+        prepare_lockin(config.mode_arg, g->chan_log2[chan_i]);
+    }
+}
+
+/**
+ * @brief Compare and exchange of a selection network, leaving the lower value in @a a.
+ *
+ * Exchanges with a conditional branch, which on AVR costs fewer cycles than a branchless exchange.
+ *
+ * @param[in,out] a First value.
+ * @param[in,out] b Second value.
+ */
+static inline void sort2(uint16_t &a, uint16_t &b)
+{
+    uint16_t t = a;
+
+    if (b < t)
+    {
+        a = b;
+        b = t;
+    }
+}
+
+inline bool ScanADC::filter_median(uint16_t &sample)
+{
+    uint8_t n = median_n;
+    uint8_t head = median_head;
+
+    median_window[head] = sample;
+    median_head = (++head == n) ? 0 : head;
+
+    if (median_fill < n - 1)
+    {
+        median_fill++;
+        return false;
+    }
+
+    // Median selection networks of 3, 7 and 13 compare and exchanges on a copy of the window.
+    // The sequence of compares is fixed, only the exchanges depend on the samples.
+    uint16_t p[SCAN_ADC_MEDIAN_MAX];
+
+    memcpy(p, median_window, sizeof(uint16_t) * n);
+
+    if (n == 3)
+    {
+        sort2(p[0], p[1]);
+        sort2(p[1], p[2]);
+        sort2(p[0], p[1]);
+        sample = p[1];
+    }
+    else if (n == 5)
+    {
+        sort2(p[0], p[1]);
+        sort2(p[3], p[4]);
+        sort2(p[0], p[3]);
+        sort2(p[1], p[4]);
+        sort2(p[1], p[2]);
+        sort2(p[2], p[3]);
+        sort2(p[1], p[2]);
+        sample = p[2];
+    }
+    else
+    {
+        sort2(p[0], p[5]);
+        sort2(p[0], p[3]);
+        sort2(p[1], p[6]);
+        sort2(p[2], p[4]);
+        sort2(p[0], p[1]);
+        sort2(p[3], p[5]);
+        sort2(p[2], p[6]);
+        sort2(p[2], p[3]);
+        sort2(p[3], p[6]);
+        sort2(p[4], p[5]);
+        sort2(p[1], p[4]);
+        sort2(p[1], p[3]);
+        sort2(p[3], p[4]);
+        sample = p[3];
+    }
+
+    return true;
+}
+
+inline void ScanADC::next_channel()
+{
+    if (inject_pending)
+    {
+        start_injected();
+        return;
+    }
+
+    Group *g = schedule();
+
+    if (!g)
+    {
+        state = ISR_STATE_INIT;
+        return;
+    }
+
+    group = g;
+    sample_accumulator = 0;
+    sample_cnt = 0;
+
+    prepare_channel(g);
+}
+
+inline void ScanADC::end_channel()
+{
+    state = ISR_STATE_INIT;
+
+    // The next channel is selected immediately. When pipelined the conversion in progress is of the
+    // completed channel and is the one discarded in addition to the settle count, as the next starts
+    // with the input selected now. At a channel boundary, so an injected measurement started by
+    // next_channel() has no channel to resume.
+    next_channel();
+}
+
+void ScanADC::start_injected()
+{
+    // Save the channel being measured unless at a channel boundary.
+    inject_resume = (state != ISR_STATE_INIT);
+
+    if (state == ISR_STATE_TONE)
+    {
+        tone_skip = true;
+    }
+
+    resume_sample_cnt = sample_cnt;
+    resume_sample_accumulator = sample_accumulator;
+
+    injecting = true;
+    sample_accumulator = 0;
+    sample_cnt = 0;
+
+    prepare(inject_mux, inject_sample_count_log2);
+}
+
+void ScanADC::resume_injected()
+{
+    injecting = false;
+
+    if (inject_resume)
+    {
+        sample_accumulator = resume_sample_accumulator;
+        sample_cnt = resume_sample_cnt;
+
+        prepare_channel(group, true);
+    }
+    else
+    {
+        end_channel();
+    }
+}
+
+/**
+ * @brief Detects a touch from a touch channel sample and updates the baseline.
+ *
+ * @param[in,out] touch  Touch detection.
+ * @param[in]     sample Sample of the pad.
+ */
+static inline void detect_touch(ScanADC::touch_t &touch, uint16_t sample)
+{
+    uint32_t level = (uint32_t) sample << 16;
+
+    if (touch.baseline == 0)
+    {
+        touch.baseline = level;
+    }
+
+    int16_t delta = (int16_t)(sample - (uint16_t)((touch.baseline + 0x8000) >> 16));
+
+    if (touch.touched)
+    {
+        touch.touched = (delta >= (touch.threshold >> 1));
+    }
+    else
+    {
+        touch.touched = (delta >= touch.threshold);
+    }
+
+    // Follow slow changes of the untouched pad only.
+    if (!touch.touched)
+    {
+        touch.baseline += (int32_t)(level - touch.baseline) >> SCAN_ADC_TOUCH_BASELINE_LOG2;
+    }
+}
+
+inline void ScanADC::complete(uint32_t accumulator)
+{
+    uint8_t samples_log2 = sample_count_log2;
+
+    if (sample_reciprocal)
+    {
+        accumulator = sample_reciprocal->divide(accumulator + sample_round);
+    }
+    else if (samples_log2 != 0)
+    {
+        accumulator += sample_round;
+        accumulator >>= samples_log2;
+    }
+
+    if (injecting)
+    {
+        injected_sample = (uint16_t) accumulator;
+        injected_sn++;
+
+        if (injected_cb)
+        {
+            injected_cb((uint16_t) accumulator);
+        }
+
+        inject_pending = false;
+        resume_injected();
+        return;
+    }
+
+    Group *g = group;
+    uint8_t scan_i = g->chan_i;
+    uint8_t chan_i = g->order ? g->order[scan_i] : scan_i;
+    const Group::channel_t &config = g->chan[chan_i];
+
+    if (config.activity_threshold)
+    {
+        uint16_t previous = g->sample[chan_i];
+        uint16_t change = ((uint16_t) accumulator > previous) ? ((uint16_t) accumulator - previous)
+                                                              : (previous - (uint16_t) accumulator);
+
+        if (change > config.activity_threshold)
+        {
+            g->chan_log2[chan_i] = config.min_sample_count_log2;
+        }
+        else if (samples_log2 < config.sample_count_log2)
+        {
+            g->chan_log2[chan_i] = samples_log2 + 1;
+        }
+    }
+
+    g->sample_log2[chan_i] = samples_log2;
+
+    if (g->timestamps)
+    {
+        g->timestamps[chan_i] = micros();
+    }
+
+    g->sample[chan_i] = (uint16_t) accumulator;
+    g->sn[chan_i]++;
+
+    if (g->history)
+    {
+        history_t &h = g->history[chan_i];
+
+        if (h.depth)
+        {
+            uint8_t head = h.head;
+
+            h.values[head] = (uint16_t) accumulator;
+            h.head = (++head == h.depth) ? 0 : head;
+
+            if (h.count < h.depth)
+            {
+                h.count++;
+            }
+        }
+    }
+
+    if (config.mode == CHANNEL_TOUCH)
+    {
+        detect_touch(g->touch[chan_i], (uint16_t) accumulator);
+    }
+
+    for (ScanKeypad *k = g->keypads; k; k = k->next)
+    {
+        if (k->channel == chan_i)
+        {
+            k->update((uint16_t) accumulator);
+        }
+    }
+
+    if (g->channel_cb)
+    {
+        if (g->deferred)
+        {
+            uint8_t mask = 1 << (chan_i & 7);
+
+            if (g->pending[chan_i >> 3] & mask)
+            {
+                g->coalesced_cnt++;
+            }
+
+            g->pending[chan_i >> 3] |= mask;
+            g->deferred_cnt++;
+        }
+        else
+        {
+            g->channel_cb(chan_i, (uint16_t) accumulator);
+        }
+    }
+
+    if (++scan_i == g->chan_count)
+    {
+        if (g->channel_scan_cb)
+        {
+            if (g->deferred)
+            {
+                if (g->scan_pending)
+                {
+                    g->coalesced_cnt++;
+                }
+
+                g->scan_pending = true;
+                g->deferred_cnt++;
+            }
+            else
+            {
+                g->channel_scan_cb((const uint16_t *) g->sample);
+            }
+        }
+
+        scan_i = 0;
+    }
+
+    g->chan_i = scan_i;
+
+    end_channel();
+}
+
+ISR(SCAN_ADC_vect)
 {
     ScanADC &adc_scan = ScanADC::getInstance();
 
-    switch (adc_scan.state)
+    // Read before releasing as the result is overwritten by the next conversion.
+    uint16_t result = ScanADC::read();
+
+#if !defined(SCAN_ADC_MEGAAVR0)
+    bool interruptible = adc_scan.interruptible;
+
+    if (interruptible)
+    {
+        ScanADC::isr_release();
+    }
+#endif
+
+    if (adc_scan.tone_skip)
+    {
+        // Each result until the paused block continues stands for the conversions it missed, which
+        // are accumulated by hardware except while discarding.
+        if (adc_scan.state == ScanADC::ISR_STATE_TONE)
+        {
+            adc_scan.tone_skip = false;
+        }
+        else
+        {
+            uint8_t missed = (adc_scan.state == ScanADC::ISR_STATE_DELAY) ? 1 : 1U << adc_scan.accumulate_hw_log2;
+
+            adc_scan.tone->skip(missed);
+        }
+    }
+
+    switch (adc_scan.state)
+    {
+        case ScanADC::ISR_STATE_INIT:
+        {
+            adc_scan.next_channel();
+        }
+        break;
+
+        case ScanADC::ISR_STATE_DELAY:
+        {
+            if (adc_scan.inject_pending && !adc_scan.injecting)
+            {
+                adc_scan.start_injected();
+                break;
+            }
+
+            if (--adc_scan.settle_cnt == 0)
+            {
+                ScanADC::set_hw_sample_count_log2(adc_scan.accumulate_hw_log2);
+                adc_scan.state = adc_scan.accumulate_state;
+            }
+        }
+        break;
+
+        case ScanADC::ISR_STATE_ACCUMULATE_MEDIAN:
+        {
+            if (!adc_scan.filter_median(result))
+            {
+                break;
+            }
+        }
+        // fall through
+
+        case ScanADC::ISR_STATE_ACCUMULATE:
+        {
+            uint32_t accumulator = adc_scan.sample_accumulator;
+
+            accumulator += result;
+
+            if (++adc_scan.sample_cnt == adc_scan.sample_cnt_target)
+            {
+                adc_scan.complete(accumulator);
+            }
+            else
+            {
+                adc_scan.sample_accumulator = accumulator;
+
+                if (adc_scan.inject_pending && !adc_scan.injecting)
+                {
+                    adc_scan.start_injected();
+                }
+            }
+        }
+        break;
+
+        case ScanADC::ISR_STATE_ACCUMULATE_NARROW:
+        {
+            // Same as ISR_STATE_ACCUMULATE with the low bytes of the accumulator and counter only.
+            uint16_t accumulator = adc_scan.sample_accumulator_narrow;
+
+            accumulator += result;
+
+            if (++adc_scan.sample_cnt_narrow == (uint8_t) adc_scan.sample_cnt_target)
+            {
+                adc_scan.complete(accumulator);
+            }
+            else
+            {
+                adc_scan.sample_accumulator_narrow = accumulator;
+
+                if (adc_scan.inject_pending && !adc_scan.injecting)
+                {
+                    adc_scan.start_injected();
+                }
+            }
+        }
+        break;
+
+        case ScanADC::ISR_STATE_ACCUMULATE_LOCKIN:
+        {
+            // Results with the excitation off (odd phases) are subtracted from an offset, so the sum
+            // stays positive and averages to the difference plus SCAN_ADC_LOCKIN_ZERO.
+            if (adc_scan.sample_cnt & 1)
+            {
+                adc_scan.sample_accumulator += adc_scan.lockin_offset - result;
+            }
+            else
+            {
+                adc_scan.sample_accumulator += result;
+            }
+
+            if (--adc_scan.lockin_cnt == 0)
+            {
+                if (++adc_scan.sample_cnt == adc_scan.sample_cnt_target)
+                {
+                    adc_scan.complete(adc_scan.sample_accumulator);
+                }
+                else if (adc_scan.inject_pending && !adc_scan.injecting)
+                {
+                    // Between phases, as resuming starts the next phase from its beginning.
+                    adc_scan.start_injected();
+                }
+                else
+                {
+                    adc_scan.next_phase();
+                }
+            }
+        }
+        break;
+
+        case ScanADC::ISR_STATE_TOUCH_CHARGE:
+        {
+            // The result is the pad selected after charging, so accumulate and charge again.
+            uint32_t accumulator = adc_scan.sample_accumulator;
+
+            accumulator += result;
+
+            if (++adc_scan.sample_cnt == adc_scan.sample_cnt_target)
+            {
+                adc_scan.complete(accumulator);
+            }
+            else
+            {
+                adc_scan.sample_accumulator = accumulator;
+                adc_scan.charge_touch();
+            }
+        }
+        break;
+
+        case ScanADC::ISR_STATE_TOUCH_SHARE:
+        {
+            adc_scan.share_touch();
+        }
+        break;
+
+        // When pipelined the input selected two results earlier is converted, so the input of the
+        // result is selected again. Otherwise the input selected last is converted.
+        case ScanADC::ISR_STATE_POWER_VOLTAGE:
+        {
+            if (adc_scan.power->add_voltage(result))
+            {
+                adc_scan.complete(adc_scan.power->offset_v);
+            }
+            else if (adc_scan.inject_pending && !adc_scan.injecting)
+            {
+                // Between sample pairs, as the window continues from the next voltage on resuming.
+                adc_scan.start_injected();
+            }
+            else
+            {
+                ScanADC::select(ScanADC::is_pipelined() ? adc_scan.power_v_mux : adc_scan.power_i_mux);
+                adc_scan.state = ScanADC::ISR_STATE_POWER_CURRENT;
+            }
+        }
+        break;
+
+        case ScanADC::ISR_STATE_POWER_CURRENT:
+        {
+            adc_scan.power->add_current(result);
+
+            ScanADC::select(ScanADC::is_pipelined() ? adc_scan.power_i_mux : adc_scan.power_v_mux);
+            adc_scan.state = ScanADC::ISR_STATE_POWER_VOLTAGE;
+        }
+        break;
+
+        case ScanADC::ISR_STATE_TONE:
+        {
+            if (adc_scan.tone->add(result))
+            {
+                adc_scan.complete(adc_scan.tone->mean);
+            }
+            else if (adc_scan.inject_pending && !adc_scan.injecting)
+            {
+                // The block continues on resuming, advanced over the conversions missed.
+                adc_scan.start_injected();
+            }
+        }
+        break;
+    }
+
+    ScanADC::convert();
+
+#if !defined(SCAN_ADC_MEGAAVR0)
+    if (interruptible)
+    {
+        ScanADC::isr_reacquire();
+    }
+#endif
+}
+
+#if defined(SCAN_ADC_MEGAAVR0)
+void ScanADC::start(uint8_t mux)
+{
+    ADC0.CTRLA = 0;
+    ADC0.CTRLB = ADC_SAMPNUM_ACC1_gc;          // No hardware accumulation until configured by ISR
+    ADC0.CTRLC = ADC_SAMPCAP_bm |              // Reduced sampling capacitance for reference above 1V
+                 ADC_REFSEL_VDDREF_gc |        // VDD reference
+                 ADC_PRESC_DIV16_gc;           // Divide clock by 16 for 1MHz ADC clock at 16MHz
+    ADC0.MUXPOS = mux;                         // ADC channel to start
+    ADC0.INTFLAGS = ADC_RESRDY_bm;
+    ADC0.INTCTRL = ADC_RESRDY_bm;              // ADC result ready interrupt enable
+    ADC0.CTRLA = ADC_RESSEL_10BIT_gc |         // 10-bit resolution
+                 ADC_ENABLE_bm;                // ADC enable
+
+    ADC0.COMMAND = ADC_STCONV_bm;              // ADC start conversion.
+
+    sei(); // Enable global interrupts.
+}
+
+void ScanADC::stop()
+{
+    ADC0.INTCTRL = 0;
+    ADC0.CTRLA = 0;
+}
+#else
+void ScanADC::trigger(mains_t mains)
+{
+    const uint8_t adts_mask = (1 << ADTS2) | (1 << ADTS1) | (1 << ADTS0)
+#if defined(ADTS3)
+                              | (1 << ADTS3)
+#endif
+                              ;
+
+    if (mains != MAINS_OFF)
+    {
+        uint32_t rate = (uint32_t) SCAN_ADC_MAINS_SAMPLES * mains;
+
+        TCCR1B = 0;
+        TCCR1A = 0;
+        TCNT1 = 0;
+        OCR1A = (uint16_t)(((F_CPU + (rate / 2)) / rate) - 1); // Period rounded to nearest CPU clock
+        OCR1B = OCR1A;
+        TIFR1 = (1 << OCF1B);
+        TCCR1B = (1 << WGM12) | (1 << CS10);                   // CTC mode with TOP at OCR1A, no prescaling
+
+        ADCSRB = (ADCSRB & ~adts_mask) | (1 << ADTS2) | (1 << ADTS0); // Timer1 compare match B trigger
+    }
+    else if (ADCSRB & (1 << ADTS0))
+    {
+        TCCR1B = 0;
+
+        ADCSRB &= ~adts_mask;              // Free running
+        ADCSRA = (ADCSRA & ~(1 << ADIF)) | (1 << ADSC); // Restart conversions as no trigger is pending
+    }
+}
+
+void ScanADC::start(uint8_t mux)
+{
+    ADCSRB = 0;
+    trigger(getInstance().mains);
+
+    ADMUX = (1 << REFS0) |             // AVCC reference with external capacitor at AREF pin
+            (0 << ADLAR) |             // Format of sample ((ADCH << 8) | ADCL)
+            (mux & 0x1F);              // ADC channel to start
+
+    ADCSRA = (1 << ADPS2) | (0 << ADPS1) | (0 << ADPS0) | // Divide clock by 16 for 76.9KHz sample rate
+             (1 << ADEN) |                                // ADC enable
+             (1 << ADATE) |                               // ADC auto-trigger enable
+             (1 << ADIE);                                 // ADC interrupt enable
+
+    ADCSRA |= (1 << ADSC); // ADC start conversion.
+
+    sei(); // Enable global interrupts.
+}
+
+void ScanADC::stop()
+{
+    ADCSRA = 0;
+
+    if (ADCSRB & (1 << ADTS0))
+    {
+        TCCR1B = 0;                        // Stop Timer1 triggering conversions
+    }
+}
+#endif
+
+void ScanADC::attach(Group *g)
+{
+    bool running = is_running();
+    uint8_t old_state = lock();
+    Group **link = &groups;
+
+    while (*link && ((*link)->priority >= g->priority))
+    {
+        link = &(*link)->next;
+    }
+
+    g->next = *link;
+    *link = g;
+
+    if (running)
+    {
+        unlock(old_state);
+        return;
+    }
+
+    state = ISR_STATE_INIT;
+    group = NULL;
+    injecting = false;
+    tone_skip = false;
+
+    start(g->chan[0].mux);
+}
+
+void ScanADC::detach(Group *g)
+{
+    uint8_t old_state = lock();
+    Group **link = &groups;
+
+    while (*link && (*link != g))
+    {
+        link = &(*link)->next;
+    }
+
+    if (*link)
+    {
+        *link = g->next;
+        g->next = NULL;
+    }
+
+    if (group == g)
+    {
+        // Abandon the channel being measured, with the excitation off if it is a lock-in channel.
+        excite(false);
+
+        if (injecting)
+        {
+            inject_resume = false;
+        }
+        else
+        {
+            state = ISR_STATE_INIT;
+        }
+
+        group = NULL;
+    }
+
+    if (groups)
+    {
+        unlock(old_state);
+    }
+    else
+    {
+        stop();
+        inject_pending = false;
+    }
+}
+
+void ScanADC::reciprocal_t::set(uint16_t count)
+{
+    uint8_t log2 = 0;
+
+    while ((1U << log2) < count)
+    {
+        log2++;
+    }
+
+    // The accumulator of up to count x 1024 is shifted to 15 bits so the product with the 17-bit
+    // multiplier fits 32 bits.
+    multiplier = (uint32_t)((1ULL << (16 + log2)) / count);
+    this->count = count;
+    count_log2 = __builtin_ctz(count);
+    pre_shift = (log2 > 5) ? (log2 - 5) : 0;
+    post_shift = 16 + log2 - pre_shift;
+}
+
+/**
+ * @brief Rounds the size of a sub-array of the group allocation up so the next one starts aligned.
+ *
+ * The widest members of the sub-arrays are the pointers and 32-bit values of touch_t. Every type is
+ * byte aligned on AVR, so no padding is added there.
+ *
+ * @param[in] size Size of the sub-array.
+ * @return uint16_t Size rounded up to the alignment of touch_t.
+ */
+static inline uint16_t align_size(uint16_t size)
+{
+    const uint16_t align = alignof(ScanADC::touch_t);
+
+    return (size + align - 1) & ~(align - 1);
+}
+
+bool ScanADC::Group::begin(const channel_config_t *channel_config, uint8_t channel_count,
+                           uint8_t priority, uint16_t scan_period_ms)
+{
+    end();
+
+    uint8_t reciprocal_count = 0,
+            history_count = 0,
+            order_count = 0,
+            touch_count = 0;
+    uint16_t history_values = 0;
+
+    for (uint8_t i = 0; i < channel_count; i++)
+    {
+        uint16_t count = channel_config[i].sample_count;
+
+        if (count & (count - 1))
+        {
+            reciprocal_count = channel_count;
+        }
+
+        if (channel_config[i].history_depth)
+        {
+            history_count = channel_count;
+            history_values += channel_config[i].history_depth;
+        }
+
+        if (channel_config[i].mode == CHANNEL_EXT_MUX)
+        {
+            order_count = channel_count;
+        }
+
+        if (channel_config[i].mode == CHANNEL_TOUCH)
+        {
+            touch_count = channel_count;
+        }
+    }
+
+    uint16_t chan_size = align_size(sizeof(channel_t) * channel_count),
+             sn_size = align_size(sizeof(uint8_t) * channel_count),
+             sample_size = align_size(sizeof(uint16_t) * channel_count),
+             log2_size = align_size(sizeof(uint8_t) * channel_count),
+             reciprocal_size = align_size(sizeof(reciprocal_t) * reciprocal_count),
+             history_size = align_size(sizeof(history_t) * history_count),
+             history_values_size = align_size(sizeof(uint16_t) * history_values),
+             touch_size = align_size(sizeof(touch_t) * touch_count),
+             order_size = align_size(sizeof(uint8_t) * order_count),
+             pending_size = sizeof(uint8_t) * ((channel_count + 7) / 8),
+             alloc_size = chan_size + sn_size + sample_size + (2 * log2_size) + reciprocal_size +
+                          history_size + history_values_size + touch_size + order_size + pending_size;
+
+    uint8_t *p = (uint8_t *) malloc(alloc_size);
+
+    if (!p)
+    {
+        return false;
+    }
+
+    memset(p, 0, alloc_size);
+
+    chan = (channel_t *) p;
+    p+= chan_size;
+    sn = (uint8_t *) p;
+    p+= sn_size;
+    sample = (uint16_t *) p;
+    p+= sample_size;
+    chan_log2 = p;
+    p+= log2_size;
+    sample_log2 = p;
+    p+= log2_size;
+    reciprocal = reciprocal_count ? (reciprocal_t *) p : NULL;
+    p+= reciprocal_size;
+    history = history_count ? (history_t *) p : NULL;
+    p+= history_size;
+
+    for (uint8_t i = 0; i < history_count; i++)
+    {
+        history[i].values = (uint16_t *) p;
+        history[i].depth = channel_config[i].history_depth;
+        p+= sizeof(uint16_t) * history[i].depth;
+    }
+
+    p+= history_values_size - (sizeof(uint16_t) * history_values);
+    touch = touch_count ? (touch_t *) p : NULL;
+    p+= touch_size;
+    order = order_count ? p : NULL;
+    p+= order_size;
+    pending = p;
+    scan_pending = false;
+    deferred_cnt = 0;
+    coalesced_cnt = 0;
+
+    for (uint8_t i = 0; i < channel_count; i++)
+    {
+        const channel_config_t &config = channel_config[i];
+        uint8_t mode = config.mode;
+        uint8_t sample_count_log2 = config.sample_count_log2;
+        uint8_t activity_threshold = config.activity_threshold;
+        uint8_t median = config.median;
+        uint8_t settle = config.settle;
+        uint16_t count = config.sample_count;
+
+        if (mode == CHANNEL_TOUCH)
+        {
+            uint8_t pin = config.mode_arg;
+            uint8_t port = digitalPinToPort(pin);
+
+            if (port == NOT_A_PIN)
+            {
+                mode = CHANNEL_ANALOG;
+            }
+            else
+            {
+                touch[i].port = portOutputRegister(port);
+                touch[i].ddr = portModeRegister(port);
+                touch[i].mask = digitalPinToBitMask(pin);
+                touch[i].threshold = config.touch_threshold ? config.touch_threshold : SCAN_ADC_TOUCH_THRESHOLD;
+
+                // Every sample is a charge share of its own.
+                median = 0;
+            }
+        }
+
+        if (mode == CHANNEL_LOCKIN)
+        {
+            // Excitation phases are power of two counts of raw samples.
+            if (count & (count - 1))
+            {
+                count = 0;
+            }
+
+            median = 0;
+        }
+
+        if (count)
+        {
+            uint8_t log2 = 0;
+
+            while ((1U << log2) < count)
+            {
+                log2++;
+            }
+
+            if (count == (1U << log2))
+            {
+                // Power of two counts are averaged by shifting.
+                sample_count_log2 = log2;
+            }
+            else
+            {
+                reciprocal[i].set(count);
+                sample_count_log2 = 0;
+            }
+
+            activity_threshold = 0;
+        }
+
+#if defined(SCAN_ADC_MEGAAVR0)
+        // No conversion is discarded when switching, so one lets the external multiplexer switch.
+        if ((mode == CHANNEL_EXT_MUX) && !settle)
+        {
+            settle = 1;
+        }
+#endif
+
+        channel_t &c = chan[i];
+
+        c.mux = config.mux;
+        c.sample_count_log2 = sample_count_log2;
+        c.min_sample_count_log2 = (config.min_sample_count_log2 < sample_count_log2) ? config.min_sample_count_log2
+                                                                                     : sample_count_log2;
+        c.activity_threshold = activity_threshold;
+        c.median = median ? (median | 1) : 0;
+        c.settle = settle;
+        c.mode = mode;
+        c.mode_arg = config.mode_arg;
+
+        chan_log2[i] = sample_count_log2;
+        sample_log2[i] = sample_count_log2;
+    }
+
+    // Stable insertion sort of the scan order by external multiplexer address, so the select
+    // lines change once per address in each scan.
+    for (uint8_t i = 0; i < order_count; i++)
+    {
+        uint8_t j = i;
+
+        while ((j > 0) && (ext_mux_key(chan[order[j - 1]]) > ext_mux_key(chan[i])))
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+
+        order[j] = i;
+    }
+
+    chan_count = channel_count;
+    chan_i = 0;
+
+    this->priority = priority;
+    this->scan_period_ms = scan_period_ms;
+    scan_start_ms = (uint16_t) millis() - scan_period_ms;
+
+    ScanADC::getInstance().attach(this);
+
+    return true;
+}
+
+void ScanADC::Group::end()
+{
+    if (chan)
+    {
+        ScanADC::getInstance().detach(this);
+
+        free(chan);
+        chan = NULL;
+    }
+}
+
+void ScanADC::Group::attach_channel_callback(channel_callback_t cb)
+{
+    uint8_t old_state = lock();
+
+    channel_cb = cb;
+    unlock(old_state);
+}
+
+void ScanADC::Group::attach_scan_callback(channel_scan_callback_t cb)
+{
+    uint8_t old_state = lock();
+
+    channel_scan_cb = cb;
+    unlock(old_state);
+}
+
+void ScanADC::Group::attach_timestamps(volatile uint32_t *timestamps)
+{
+    uint8_t old_state = lock();
+
+    this->timestamps = timestamps;
+    unlock(old_state);
+}
+
+void ScanADC::Group::set_deferred(bool deferred)
+{
+    uint8_t old_state = lock();
+
+    this->deferred = deferred;
+    unlock(old_state);
+}
+
+void ScanADC::Group::poll()
+{
+    if (!chan)
     {
-        case ScanADC::ISR_STATE_INIT:
-        {
-            uint8_t mux = adc_scan.config[adc_scan.chan_i].mux;
+        return;
+    }
 
-            ADCSRB = (ADCSRB & (~(1 << MUX5))) | ((mux & 0x20) ? (1 << MUX5) : 0);
-            ADMUX = (ADMUX & 0xE0) | (mux & 0x1F);
+    for (uint8_t i = 0; i < chan_count; i += 8)
+    {
+        uint8_t old_state = lock();
+        uint8_t bits = pending[i >> 3];
 
-            adc_scan.sample_accumulator = 0;
-            adc_scan.sample_cnt = 0;
-            adc_scan.sample_cnt_target = 1;
-            adc_scan.sample_cnt_target <<= adc_scan.config[adc_scan.chan_i].sample_count_log2;
+        pending[i >> 3] = 0;
+        unlock(old_state);
 
-            adc_scan.state = ScanADC::ISR_STATE_DELAY;
+        for (uint8_t channel = i; bits; channel++, bits >>= 1)
+        {
+            if ((bits & 1) && channel_cb)
+            {
+                channel_cb(channel, get_sample(channel));
+            }
         }
-        break;
+    }
 
-        case ScanADC::ISR_STATE_DELAY:
+    uint8_t old_state = lock();
+    bool scan = scan_pending;
+
+    scan_pending = false;
+    unlock(old_state);
+
+    if (scan && channel_scan_cb)
+    {
+        channel_scan_cb((const uint16_t *) sample);
+    }
+}
+
+uint16_t ScanADC::Group::get_deferred_count() const
+{
+    uint16_t cnt;
+    uint8_t old_state = lock();
+
+    cnt = deferred_cnt;
+    unlock(old_state);
+
+    return cnt;
+}
+
+uint16_t ScanADC::Group::get_coalesced_count() const
+{
+    uint16_t cnt;
+    uint8_t old_state = lock();
+
+    cnt = coalesced_cnt;
+    unlock(old_state);
+
+    return cnt;
+}
+
+void ScanADC::poll()
+{
+    for (Group *g = groups; g; g = g->next)
+    {
+        g->poll();
+    }
+}
+
+void ScanADC::Group::wait_channel(uint8_t channel) const
+{
+    uint8_t last_sn = sn[channel];
+
+    while (last_sn == sn[channel])
+    {
+        last_sn = sn[channel];
+    }
+}
+
+void ScanADC::Group::wait_scan() const
+{
+    if (chan_count > 0)
+    {
+        // Last channel in scan order, which differs from the last index when sorted by address.
+        wait_channel(order ? order[chan_count - 1] : chan_count - 1);
+    }
+}
+
+uint16_t ScanADC::Group::get_sample(uint8_t channel) const
+{
+    uint16_t s;
+    uint8_t old_state = lock();
+
+    s = sample[channel];
+    unlock(old_state);
+
+    return s;
+}
+
+uint8_t ScanADC::Group::copy_history(uint8_t channel, uint16_t *dest, uint8_t n) const
+{
+    if (!history)
+    {
+        return 0;
+    }
+
+    const history_t &h = history[channel];
+    uint8_t old_state = lock();
+
+    if (n > h.count)
+    {
+        n = h.count;
+    }
+
+    // Oldest of the n latest samples.
+    uint8_t i = (h.head >= n) ? (h.head - n) : (h.head + h.depth - n);
+
+    for (uint8_t k = 0; k < n; k++)
+    {
+        dest[k] = h.values[i];
+
+        if (++i == h.depth)
         {
-            adc_scan.state = ScanADC::ISR_STATE_ACCUMULATE;
+            i = 0;
         }
-        break;
+    }
 
-        case ScanADC::ISR_STATE_ACCUMULATE:
-        {
-            uint32_t accumulator = adc_scan.sample_accumulator;
-            uint8_t low, high;
+    unlock(old_state);
+
+    return n;
+}
 
-            low = ADCL;
-            high = ADCH;
+int16_t ScanADC::Group::get_delta(uint8_t channel) const
+{
+    uint16_t s[2];
 
-            accumulator += (uint16_t)((high << 8) | low);
+    if (copy_history(channel, s, 2) < 2)
+    {
+        return 0;
+    }
 
-            if (++adc_scan.sample_cnt == adc_scan.sample_cnt_target)
-            {
-                uint8_t samples_log2 = adc_scan.config[adc_scan.chan_i].sample_count_log2;
+    return (int16_t)(s[1] - s[0]);
+}
 
-                if (samples_log2 != 0)
-                {
-                    accumulator += (adc_scan.sample_cnt_target >> 1);
-                    accumulator >>= samples_log2;
-                }
+int16_t ScanADC::Group::get_touch_delta(uint8_t channel) const
+{
+    if (!touch || (chan[channel].mode != CHANNEL_TOUCH))
+    {
+        return 0;
+    }
 
-                adc_scan.sample[adc_scan.chan_i] = (uint16_t) accumulator;
-                adc_scan.sn[adc_scan.chan_i]++;
+    uint8_t old_state = lock();
+    uint16_t s = sample[channel];
+    uint32_t baseline = touch[channel].baseline;
 
-                if (adc_scan.channel_cb)
-                {
-                    adc_scan.channel_cb(adc_scan.chan_i, (uint16_t) accumulator);
-                }
+    unlock(old_state);
 
-                if (++adc_scan.chan_i == adc_scan.chan_count)
-                {
-                    if (adc_scan.channel_scan_cb)
-                    {
-                        adc_scan.channel_scan_cb(adc_scan.sample);
-                    }
+    return (int16_t)(s - (uint16_t)((baseline + 0x8000) >> 16));
+}
 
-                    adc_scan.chan_i = 0;
-                }
+void ScanADC::Group::calibrate_settle(uint8_t tolerance)
+{
+    for (uint8_t i = 0; i < chan_count; i++)
+    {
+        bool ext_mux = (chan[i].mode == CHANNEL_EXT_MUX);
+        uint8_t settle = ScanADC::getInstance().measure_settle((mux_t) chan[i].mux, tolerance, NULL,
+                                                               ext_mux ? SCAN_ADC_EXT_MUX(chan[i].mode_arg) : 0);
 
-                adc_scan.state = ScanADC::ISR_STATE_INIT;
-            }
-            else
-            {
-                adc_scan.sample_accumulator = accumulator;
-            }
+#if defined(SCAN_ADC_MEGAAVR0)
+        if (ext_mux && !settle)
+        {
+            settle = 1;
         }
-        break;
+#endif
+
+        uint8_t old_state = lock();
+
+        chan[i].settle = settle;
+        unlock(old_state);
     }
 }
 
-void ScanADC::begin(const channel_config_t *channel_config, uint8_t channel_count)
+void ScanADC::Group::attach_keypad(uint8_t channel, ScanKeypad *keypad)
 {
-    end();
+    detach_keypad(keypad);
 
-    ADCSRB = 0;
+    uint8_t old_state = lock();
 
-    uint16_t config_size = sizeof(channel_config_t) * channel_count,
-             sn_size = sizeof(uint8_t) * channel_count,
-             sample_size = sizeof(uint16_t) * channel_count,
-             alloc_size = config_size + sn_size + sample_size;
+    keypad->channel = channel;
+    keypad->next = keypads;
+    keypads = keypad;
+    unlock(old_state);
+}
 
-    void *p = malloc(alloc_size);
-    memset(p, 0, alloc_size);
+void ScanADC::Group::attach_power(uint8_t channel, ScanPower *power)
+{
+    detach_power(power);
 
-    config = (channel_config_t *) p;
-    p+= config_size;
-    sn = (uint8_t *) p;
-    p+= sn_size;
-    sample = (uint16_t *) p;
+    uint8_t old_state = lock();
 
-    memcpy(config, channel_config, config_size);
+    power->channel = channel;
+    power->next = powers;
+    powers = power;
+    unlock(old_state);
+}
 
-    chan_count = channel_count;
+void ScanADC::Group::detach_power(ScanPower *power)
+{
+    uint8_t old_state = lock();
+    ScanPower **p = &powers;
 
-    state = ISR_STATE_INIT;
-    chan_i = 0;
+    while (*p && (*p != power))
+    {
+        p = &(*p)->next;
+    }
 
-    ADMUX = (1 << REFS0) | // AVCC reference with external capacitor at AREF pin
-            (0 << ADLAR) | // Format of sample ((ADCH << 8) | ADCL)
-            config[0].mux; // ADC channel to start
+    if (*p)
+    {
+        *p = power->next;
+    }
 
-    ADCSRA = (1 << ADPS2) | (0 << ADPS1) | (0 << ADPS0) | // Divide clock by 16 for 76.9KHz sample rate
-             (1 << ADEN) |                                // ADC enable
-             (1 << ADATE) |                               // ADC auto-trigger enable
-             (1 << ADIE);                                 // ADC interrupt enable
+    unlock(old_state);
+}
 
-    ADCSRA |= (1 << ADSC); // ADC start conversion.
+void ScanADC::Group::attach_tone(uint8_t channel, ScanTone *tone)
+{
+    detach_tone(tone);
 
-    sei(); // Enable global interrupts.
+    uint8_t old_state = lock();
+
+    tone->channel = channel;
+    tone->next = tones;
+    tones = tone;
+    unlock(old_state);
 }
 
-void ScanADC::end()
+void ScanADC::Group::detach_tone(ScanTone *tone)
 {
-    ADCSRA = 0;
+    uint8_t old_state = lock();
+    ScanTone **t = &tones;
+
+    while (*t && (*t != tone))
+    {
+        t = &(*t)->next;
+    }
 
-    if (config)
+    if (*t)
     {
-        free(config);
-        config = NULL;
+        *t = tone->next;
     }
+
+    unlock(old_state);
 }
 
-void ScanADC::attach_channel_callback(channel_callback_t cb)
+void ScanADC::Group::detach_keypad(ScanKeypad *keypad)
 {
-    uint8_t old_ADCSRA = ADCSRA;
+    uint8_t old_state = lock();
+    ScanKeypad **k = &keypads;
 
-    ADCSRA &= ~(1 << ADIE);
-    channel_cb = cb;
-    ADCSRA = old_ADCSRA;
+    while (*k && (*k != keypad))
+    {
+        k = &(*k)->next;
+    }
+
+    if (*k)
+    {
+        *k = keypad->next;
+    }
+
+    unlock(old_state);
 }
 
-void ScanADC::attach_scan_callback(channel_scan_callback_t cb)
+uint8_t ScanADC::measure_settle(mux_t mux, uint8_t tolerance, uint16_t *leakage, uint8_t ext_mux)
 {
-    uint8_t old_ADCSRA = ADCSRA;
+    // Conversions of the previous input measured after switching.
+    const uint8_t first = is_pipelined() ? 1 : 0;
+    const uint8_t length = 1 + SCAN_ADC_SETTLE_MAX;
+    const uint8_t repeat = 16;
+    const uint8_t from[2] = { MUX_0V0, SETTLE_REFERENCE };
+    uint16_t sum[2][length];
 
-    ADCSRA &= ~(1 << ADIE);
-    channel_scan_cb = cb;
-    ADCSRA = old_ADCSRA;
+    if (!is_running())
+    {
+        return 0;
+    }
+
+    memset(sum, 0, sizeof(sum));
+
+    uint8_t old_state = lock();
+
+    set_hw_sample_count_log2(0);
+
+    // The inputs switched from are internal, so the external multiplexer stays on the address.
+    if (ext_mux && ext_port)
+    {
+        select_external(ext_mux - 1);
+    }
+
+    for (uint8_t r = 0; r < repeat; r++)
+    {
+        for (uint8_t k = 0; k < 2; k++)
+        {
+            // Settle on the input switched from, then switch to the input measured.
+            for (uint8_t i = 0; i < first + 8; i++)
+            {
+                read_polled(from[k]);
+            }
+
+            read_polled(mux);
+
+            for (uint8_t i = 0; i < first; i++)
+            {
+                read_polled(mux);
+            }
+
+            for (uint8_t i = 0; i < length; i++)
+            {
+                sum[k][i] += read_polled(mux);
+            }
+        }
+    }
+
+    uint8_t settle = SCAN_ADC_SETTLE_MAX;
+    bool settled = true;
+
+    // First conversion from which the crosstalk stays within tolerance.
+    for (uint8_t i = length; i-- > 0;)
+    {
+        uint16_t crosstalk = (sum[0][i] > sum[1][i]) ? (sum[0][i] - sum[1][i]) : (sum[1][i] - sum[0][i]);
+
+        crosstalk = (crosstalk + (repeat / 2)) / repeat;
+
+        if (crosstalk > tolerance)
+        {
+            settled = false;
+        }
+
+        if (settled)
+        {
+            settle = i;
+        }
+
+        if ((i == 0) && leakage)
+        {
+            *leakage = crosstalk;
+        }
+    }
+
+    // Restart the channel or injected measurement in progress with its input selected again.
+    if (state != ISR_STATE_INIT)
+    {
+        if (injecting)
+        {
+            prepare(inject_mux, inject_sample_count_log2);
+        }
+        else
+        {
+            prepare_channel(group);
+        }
+
+        if (!is_pipelined())
+        {
+            // The conversion started by read_polled(), or triggered since, is of the measured input.
+            settle_cnt++;
+            set_hw_sample_count_log2(0);
+            state = ISR_STATE_DELAY;
+        }
+    }
+
+    unlock(old_state);
+
+    return settle;
 }
 
-void ScanADC::wait_channel(uint8_t channel) const
+bool ScanADC::inject(mux_t mux, uint8_t sample_count_log2, injected_callback_t cb)
 {
-    uint8_t last_sn = sn[channel];
+    bool running = is_running();
+    uint8_t old_state = lock();
+    bool requested = false;
 
-    while (last_sn == sn[channel])
+    if (!inject_pending && running)
     {
-        last_sn = sn[channel];
+        inject_mux = mux;
+        inject_sample_count_log2 = sample_count_log2;
+        injected_cb = cb;
+        inject_pending = true;
+        requested = true;
     }
+
+    unlock(old_state);
+
+    return requested;
 }
 
-void ScanADC::wait_scan() const
+void ScanADC::wait_injected() const
 {
-    if (chan_count > 0)
+    while (inject_pending)
     {
-        wait_channel(chan_count - 1);
     }
 }
 
-uint16_t ScanADC::get_sample(uint8_t channel) const
+uint16_t ScanADC::get_injected_sample() const
 {
     uint16_t s;
-    uint8_t old_ADCSRA = ADCSRA;
+    uint8_t old_state = lock();
 
-    ADCSRA &= ~(1 << ADIE);
-    s = sample[channel];
-    ADCSRA = old_ADCSRA;
+    s = injected_sample;
+    unlock(old_state);
 
     return s;
 }
+
+uint16_t ScanADC::read_injected(mux_t mux, uint8_t sample_count_log2)
+{
+    wait_injected();
+
+    if (!inject(mux, sample_count_log2))
+    {
+        return 0;
+    }
+
+    wait_injected();
+
+    return get_injected_sample();
+}
+
+bool ScanADC::set_mains(mains_t mains)
+{
+#if defined(SCAN_ADC_MEGAAVR0)
+    return (mains == MAINS_OFF);
+#else
+    uint8_t old_state = lock();
+
+    this->mains = mains;
+
+    if (is_running())
+    {
+        trigger(mains);
+    }
+
+    unlock(old_state);
+
+    return true;
+#endif
+}
+
+bool ScanADC::set_interruptible(bool interruptible)
+{
+#if defined(SCAN_ADC_MEGAAVR0)
+    return !interruptible;
+#else
+    uint8_t old_state = lock();
+
+    this->interruptible = interruptible;
+
+    unlock(old_state);
+
+    return true;
+#endif
+}
+
+void ScanADC::set_external_mux(volatile uint8_t *port, volatile uint8_t *ddr, uint8_t shift, uint8_t bits)
+{
+    uint8_t mask = (uint8_t)(((1U << bits) - 1) << shift);
+    uint8_t old_state = lock();
+
+    ext_port = bits ? port : NULL;
+    ext_mask = mask;
+    ext_shift = shift;
+    ext_address = 0xFF;
+
+    unlock(old_state);
+
+    if (bits && ddr)
+    {
+        // Other interrupt handlers may write the direction register too.
+        uint8_t old_SREG = SREG;
+        cli();
+        *ddr |= mask;
+        SREG = old_SREG;
+    }
+}
+
+void ScanADC::set_excitation(volatile uint8_t *port, volatile uint8_t *ddr, uint8_t bit)
+{
+    bool enable = (bit < 8);
+    uint8_t mask = enable ? (uint8_t)(1 << bit) : 0;
+    uint8_t old_state = lock();
+
+    exc_port = enable ? port : NULL;
+    exc_mask = mask;
+
+    unlock(old_state);
+
+    if (enable && ddr)
+    {
+        uint8_t old_SREG = SREG;
+        cli();
+        *ddr |= mask;
+        SREG = old_SREG;
+    }
+}
@@ -47,13 +47,92 @@
 #include "stdint.h"
 #include "stdlib.h"
 
-#define MAX_CHANNELS 16
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/**
+ * Largest channel count of a scan, including channels behind external multiplexers.
+ */
+#define MAX_CHANNELS 128
+
+/**
+ * Conversions per mains cycle when locked to the mains frequency by ScanADC::set_mains().
+ */
+#define SCAN_ADC_MAINS_SAMPLES 64
+
+/**
+ * Largest sample count accumulated by the ISR with a 16-bit accumulator and 8-bit counter. Defining
+ * it as 0 always uses the 32-bit accumulator, as the cycle runner does to measure the narrow path.
+ */
+#ifndef SCAN_ADC_NARROW_SAMPLES
+#define SCAN_ADC_NARROW_SAMPLES 64
+#elif SCAN_ADC_NARROW_SAMPLES > 64
+#error "SCAN_ADC_NARROW_SAMPLES above 64 overflows the 16-bit accumulator"
+#endif
+
+/**
+ * Longest median filter applied to raw samples before accumulation.
+ */
+#define SCAN_ADC_MEDIAN_MAX 7
+
+/**
+ * Largest settling count recommended by ScanADC::measure_settle().
+ */
+#define SCAN_ADC_SETTLE_MAX 15
+
+/**
+ * Value of the ext_mux argument of ScanADC::measure_settle() to select @a address of the external
+ * multiplexer.
+ */
+#define SCAN_ADC_EXT_MUX(address) ((address) + 1)
+
+/**
+ * Sample of a lock-in channel when the excitation makes no difference.
+ */
+#define SCAN_ADC_LOCKIN_ZERO 1024
+
+/**
+ * Sample rise over the baseline detected as a touch when channel_config_t::touch_threshold is 0.
+ */
+#define SCAN_ADC_TOUCH_THRESHOLD 16
+
+/**
+ * Log 2 of the measurements the touch baseline takes to follow a change of an untouched pad.
+ */
+#define SCAN_ADC_TOUCH_BASELINE_LOG2 8
+
+#if defined(__AVR_ATmega4809__) || defined(__AVR_ATmega4808__) || \
+    defined(__AVR_ATmega3209__) || defined(__AVR_ATmega3208__)
+/**
+ * Defined for megaAVR-0 devices with the ADC0 peripheral, hardware accumulation and a result
+ * ready interrupt instead of the classic ATmega ADC registers.
+ */
+#define SCAN_ADC_MEGAAVR0
+
+/**
+ * ADC result ready interrupt vector used by the library.
+ */
+#define SCAN_ADC_vect ADC0_RESRDY_vect
+#else
+/**
+ * ADC conversion complete interrupt vector used by the library.
+ */
+#define SCAN_ADC_vect ADC_vect
+#endif
 
 /**
  * ADC Interrupt Service Routine (ISR) has C linkage. Declaration used to create
  * a friend of the class to access member variables.
+ *
+ * The vector name is taken from ADC_vect (or ADC0_RESRDY_vect) in <avr/io.h> rather than
+ * hard coded, as the vector number differs between devices. This also allows the library to be
+ * compiled unmodified against an emulated <avr/io.h> that maps the vector to a host function.
  */
-extern "C" void __vector_29();
+extern "C" void SCAN_ADC_vect(void);
+
+class ScanKeypad;
+class ScanPower;
+class ScanTone;
 
 /**
  * @brief Class to scan analogue inputs with ADC measuring and averaging in background under interrupt control.
@@ -102,7 +181,7 @@ class ScanADC
         MUX_ADC6 = 6,   /**< ADC6 analogue input. */
         MUX_ADC7 = 7,   /**< ADC7 analogue input. */
         MUX_1V1  = 30,  /**< 1.1V internal bandgap. */
-        MUX_0V0  = 31   /**< GND. */
+        MUX_0V0  = 31,  /**< GND. */
         MUX_ADC8 = 32,  /**< ADC8 analogue input. */
         MUX_ADC9 = 33,  /**< ADC9 analogue input. */
         MUX_ADC10 = 34, /**< ADC10 analogue input. */
@@ -142,12 +221,55 @@ class ScanADC
 
 #endif
 
+#if defined(SCAN_ADC_MEGAAVR0)
+    /**
+     * @brief ATmega4809/ATmega4808/ATmega3209/ATmega3208 Hardware analogue input MUX value.
+     *
+     * Only available for megaAVR-0 devices defined by Arduino environment.
+     */
+    typedef enum _mux3_t
+    {
+        MUX_ADC0 = ADC_MUXPOS_AIN0_gc,      /**< AIN0 analogue input. */
+        MUX_ADC1 = ADC_MUXPOS_AIN1_gc,      /**< AIN1 analogue input. */
+        MUX_ADC2 = ADC_MUXPOS_AIN2_gc,      /**< AIN2 analogue input. */
+        MUX_ADC3 = ADC_MUXPOS_AIN3_gc,      /**< AIN3 analogue input. */
+        MUX_ADC4 = ADC_MUXPOS_AIN4_gc,      /**< AIN4 analogue input. */
+        MUX_ADC5 = ADC_MUXPOS_AIN5_gc,      /**< AIN5 analogue input. */
+        MUX_ADC6 = ADC_MUXPOS_AIN6_gc,      /**< AIN6 analogue input. */
+        MUX_ADC7 = ADC_MUXPOS_AIN7_gc,      /**< AIN7 analogue input. */
+        MUX_ADC8 = ADC_MUXPOS_AIN8_gc,      /**< AIN8 analogue input. */
+        MUX_ADC9 = ADC_MUXPOS_AIN9_gc,      /**< AIN9 analogue input. */
+        MUX_ADC10 = ADC_MUXPOS_AIN10_gc,    /**< AIN10 analogue input. */
+        MUX_ADC11 = ADC_MUXPOS_AIN11_gc,    /**< AIN11 analogue input. */
+        MUX_ADC12 = ADC_MUXPOS_AIN12_gc,    /**< AIN12 analogue input. */
+        MUX_ADC13 = ADC_MUXPOS_AIN13_gc,    /**< AIN13 analogue input. */
+        MUX_ADC14 = ADC_MUXPOS_AIN14_gc,    /**< AIN14 analogue input. */
+        MUX_ADC15 = ADC_MUXPOS_AIN15_gc,    /**< AIN15 analogue input. */
+        MUX_DACREF = ADC_MUXPOS_DACREF_gc,  /**< DAC reference of analogue comparator. */
+        MUX_TEMP = ADC_MUXPOS_TEMPSENSE_gc, /**< Temperature sensor. */
+        MUX_0V0 = ADC_MUXPOS_GND_gc,        /**< GND. */
+    } mux_t;
+
+#endif
+
 #if !defined(__AVR_ATmega328P__) && !defined(__AVR_ATmega168__) &&  \
     !defined(__AVR_ATmega1280__) && !defined(__AVR_ATmega2560__) && \
-    !defined(__AVR_ATmega32U4__) && !defined(__AVR_ATmega16U4__)
-#error "This library only supports AVR ATmega devices!"
+    !defined(__AVR_ATmega32U4__) && !defined(__AVR_ATmega16U4__) && \
+    !defined(SCAN_ADC_MEGAAVR0)
+#error "This library only supports AVR ATmega and megaAVR-0 devices!"
 #endif
 
+    /**
+    * @brief Measurement of the input of a channel selected by channel_config_t::mode.
+    */
+    enum channel_mode_t
+    {
+        CHANNEL_ANALOG = 0,                /**< Analogue input of the ADC. */
+        CHANNEL_EXT_MUX = 1,               /**< Input at mode_arg address of the external multiplexer set by set_external_mux(). */
+        CHANNEL_LOCKIN = 2,                /**< Lock-in of the excitation set by set_excitation(), every 2 ^ mode_arg samples. */
+        CHANNEL_TOUCH = 3                  /**< Capacitive touch pad on Arduino pin mode_arg. */
+    };
+
     /**
     * @brief Structure to hold configuration for a single channel.
     *
@@ -156,11 +278,131 @@ class ScanADC
     * The #sample_count_log2 is the log 2 of the sample count to accumulate and average to
     * produce a single sample for the channel. The actual sample count value is 2 to the power
     * of #sample_count_log2.
+    *
+    * When #activity_threshold is not zero the averaging adapts to the signal activity. A sample
+    * that differs from the previous sample of the channel by more than #activity_threshold
+    * drops the averaging of the next measurement to #min_sample_count_log2 for low latency
+    * during fast movement. Each sample within the threshold doubles the averaging, up to
+    * #sample_count_log2 for low noise while the signal is static. The averaging used for the
+    * latest sample is returned by ScanADC::get_sample_count_log2().
+    *
+    * When #sample_count is not zero it replaces #sample_count_log2 with any sample count from 1
+    * to 65535, for instance 1538 samples to average over exactly 20ms of 50Hz mains hum. The
+    * average is rounded as for power of two counts using a fixed point reciprocal precomputed
+    * by begin(), so no division is done in the ISR. Adaptive averaging does not apply.
+    *
+    * When #history_depth is not zero the latest #history_depth samples of the channel are kept in a
+    * ring for lookback queries with ScanADC::copy_history() and ScanADC::get_delta().
+    *
+    * When #median is 3, 5 or 7 each raw sample is replaced by the median of the latest #median
+    * raw samples before it is accumulated, rejecting single sample spikes such as from brush
+    * motors that would otherwise bias the average. The first #median - 1 samples after the input
+    * is selected only fill the filter, so a channel takes that many more conversions to measure.
+    * Even lengths are rounded up by begin().
+    * On megaAVR-0 devices the hardware accumulation is not used for the channel so the filter is
+    * applied to every sample.
+    *
+    * The #settle count of conversions, up to 31, are discarded after the input is selected to let
+    * the ADC sample and hold capacitor settle to a source above 10 kOhm, which otherwise shows
+    * crosstalk from the previous channel. These are in addition to the conversion in progress when
+    * switching that is always discarded on ATmega devices. A suitable count can be measured with
+    * ScanADC::calibrate_settle().
+    *
+    * The #mode selects how the input is measured, with #mode_arg as its argument: the external
+    * multiplexer address of #CHANNEL_EXT_MUX, the log 2 of the excitation phase length in samples of
+    * #CHANNEL_LOCKIN or the Arduino pin of the pad of #CHANNEL_TOUCH. The modes are exclusive.
     */
     struct channel_config_t
     {
-        ScanADC::mux_t  mux;           /**< Hardware value to connect analogue input to ADC. */
-        uint8_t  sample_count_log2:4;  /**< Log 2 of sample count. */
+        ScanADC::mux_t  mux;               /**< Hardware value to connect analogue input to ADC. */
+        uint8_t  sample_count_log2:4;      /**< Log 2 of sample count, the maximum when adaptive. */
+        uint8_t  min_sample_count_log2:4;  /**< Log 2 of minimum sample count when adaptive. */
+        uint8_t  activity_threshold;       /**< Sample change to drop to minimum averaging or 0 to disable. */
+        uint16_t sample_count;             /**< Sample count or 0 to use sample_count_log2. */
+        uint8_t  history_depth;            /**< Samples kept in history ring or 0 for no history. */
+        uint8_t  median:3;                 /**< Median filter length of raw samples or 0 for no filter. */
+        uint8_t  settle:5;                 /**< Conversions discarded after selecting input. */
+        uint8_t  mode;                     /**< Measurement of the input by #channel_mode_t. */
+        uint8_t  mode_arg;                 /**< Argument of the mode. */
+        uint8_t  touch_threshold;          /**< Touch detection threshold or 0 for #SCAN_ADC_TOUCH_THRESHOLD. */
+    };
+
+    /**
+    * @brief Mains frequency the conversions are locked to by set_mains().
+    */
+    enum mains_t
+    {
+        MAINS_OFF = 0,                     /**< Free running conversions at the full sample rate. */
+        MAINS_50HZ = 50,                   /**< #SCAN_ADC_MAINS_SAMPLES conversions per 50Hz cycle. */
+        MAINS_60HZ = 60                    /**< #SCAN_ADC_MAINS_SAMPLES conversions per 60Hz cycle. */
+    };
+
+    /**
+    * @brief Fixed point reciprocal to average a sample count that is not a power of two.
+    *
+    * The average of accumulator x is estimated as ((x >> #pre_shift) * #multiplier) >> #post_shift
+    * and corrected to the exact quotient by at most a few subtractions of #count.
+    */
+    struct reciprocal_t
+    {
+        uint32_t multiplier;               /**< 2 ^ (16 + ceil(log2(count))) / count. */
+        uint16_t count;                    /**< Sample count or 0 if a power of two count is used. */
+        uint8_t  count_log2;               /**< Log 2 of largest power of two dividing count. */
+        uint8_t  pre_shift;                /**< Right shift of accumulator before multiply. */
+        uint8_t  post_shift;               /**< Right shift of product. */
+
+        /**
+        * @brief Computes the reciprocal of a sample count.
+        *
+        * @param[in] count Sample count that is not a power of two, from 3 to 65535.
+        */
+        void set(uint16_t count);
+
+        /**
+        * @brief Divides an accumulator of up to #count 10-bit samples plus rounding by the sample count.
+        *
+        * The reciprocal estimate never exceeds the quotient and is corrected by subtracting the count.
+        *
+        * @param[in] x Accumulator with rounding added.
+        * @return uint16_t Quotient.
+        */
+        inline uint16_t divide(uint32_t x) const
+        {
+            uint16_t q = (uint16_t)(((x >> pre_shift) * multiplier) >> post_shift);
+            uint32_t remainder = x - ((uint32_t) q * count);
+
+            while (remainder >= count)
+            {
+                remainder -= count;
+                q++;
+            }
+
+            return q;
+        }
+    };
+
+    /**
+    * @brief Ring of the latest samples of a channel with a history depth.
+    */
+    struct history_t
+    {
+        volatile uint16_t *values;         /**< Ring of history depth samples. */
+        uint8_t  depth;                    /**< Samples kept or 0 for no history. */
+        volatile uint8_t head;             /**< Index to write next sample. */
+        volatile uint8_t count;            /**< Samples kept so far, up to depth. */
+    };
+
+    /**
+    * @brief Pad pin and touch detection of a capacitive touch channel.
+    */
+    struct touch_t
+    {
+        volatile uint8_t *port;            /**< Output register of the pad pin. */
+        volatile uint8_t *ddr;             /**< Direction register of the pad pin. */
+        uint8_t  mask;                     /**< Pad pin of port. */
+        uint8_t  threshold;                /**< Sample rise over the baseline detected as a touch. */
+        volatile bool touched;             /**< Touch detected. */
+        volatile uint32_t baseline;        /**< Untouched sample in 1/65536 codes or 0 before measured. */
     };
 
     /**
@@ -187,12 +429,385 @@ class ScanADC
     */
     typedef void (*channel_scan_callback_t)(const uint16_t *samples);
 
+    /**
+    * @brief Definition of the injected conversion measured callback.
+    *
+    * The injected callback is called after an injected conversion requested by #inject() has been
+    * measured and will supply the measured @a sample as parameter.
+    *
+    * Note that the callback is called from the ADC Interrupt Service Routine (ISR) and should
+    * be as short as possible.
+    */
+    typedef void (*injected_callback_t)(uint16_t sample);
+
+    /**
+    * @brief Group of channels scanned in background that shares the ADC with other groups.
+    *
+    * Each group has its own channel configuration, averaging, callbacks and result storage, so
+    * independent subsystems (for instance HID axes, a battery monitor and a temperature sensor)
+    * can each own a group and coexist without reinitialising each other.
+    *
+    * The ADC Interrupt Service Routine (ISR) time-shares the ADC between the started groups at
+    * channel boundaries. At each boundary the channel measured next is taken from the highest
+    * priority group that is due, and groups of equal priority take turns channel by channel. A
+    * group with a zero scan period is always due. Otherwise it becomes due once every scan period
+    * and remains due until its scan has completed. Note that an always due group starves all groups
+    * of lower priority.
+    *
+    * The ScanADC functions such as ScanADC::begin() and ScanADC::get_sample() operate on a default
+    * group with priority 0 and a zero scan period.
+    *
+    * Example of a battery monitor measured once a second with priority over the default group:
+    * @code
+    *   static ScanADC::Group battery;
+    *
+    *   const ScanADC::channel_config_t battery_config[] =
+    *   {
+    *       { ScanADC::MUX_ADC8, 4 },
+    *   };
+    *
+    *   battery.begin(battery_config, 1, 1, 1000);
+    * @endcode
+    */
+    class Group
+    {
+        public:
+
+        /**
+        * @brief Constructs a stopped group.
+        */
+        Group() : channel_cb(NULL), channel_scan_cb(NULL), timestamps(NULL), deferred(false), chan(NULL),
+                  history(NULL), keypads(NULL), powers(NULL), tones(NULL), touch(NULL),
+                  next(NULL)
+        {
+        }
+
+        /**
+        * @brief Starts scanning the group channels with the ADC under interrupt control.
+        *
+        * The configuration is copied as for ScanADC::begin(). If the group was already started it is
+        * stopped first. The ADC is started if this is the first group to be started.
+        *
+        * @param[in] channel_config Pointer to array with channel configurations.
+        * @param[in] channel_count  Channel count to configure.
+        * @param[in] priority       Scheduling priority, higher values are measured first.
+        * @param[in] scan_period_ms Time between the start of scans in milliseconds or 0 to scan continuously.
+        * @return bool True if started, false if the memory for the channels could not be allocated.
+        */
+        bool begin(const channel_config_t *channel_config, uint8_t channel_count,
+                   uint8_t priority = 0, uint16_t scan_period_ms = 0);
+
+        /**
+        * @brief Stops scanning the group. The ADC is stopped if no other group is started.
+        */
+        void end();
+
+        /**
+        * @brief Configures callback function to be called after each group channel is scanned.
+        *
+        * See ScanADC::attach_channel_callback().
+        *
+        * @param[in] cb Pointer to callback function or NULL to disable callback.
+        */
+        void attach_channel_callback(channel_callback_t cb = NULL);
+
+        /**
+        * @brief Configures callback function to be called after all group channels are scanned.
+        *
+        * See ScanADC::attach_scan_callback().
+        *
+        * @param[in] cb Pointer to callback function or NULL to disable callback.
+        */
+        void attach_scan_callback(channel_scan_callback_t cb = NULL);
+
+        /**
+        * @brief Configures a buffer to be filled with the time each group channel was measured.
+        *
+        * See ScanADC::attach_timestamps().
+        *
+        * @param[in] timestamps Pointer to array of channel count timestamps or NULL to disable.
+        */
+        void attach_timestamps(volatile uint32_t *timestamps = NULL);
+
+        /**
+        * @brief Configures the group callbacks to be called from poll() instead of the ISR.
+        *
+        * See ScanADC::set_deferred().
+        *
+        * @param[in] deferred True to defer callbacks to poll(), false to call them from the ISR.
+        */
+        void set_deferred(bool deferred);
+
+        /**
+        * @brief Calls the deferred callbacks of channels measured since the last poll.
+        *
+        * See ScanADC::poll().
+        */
+        void poll();
+
+        /**
+        * @brief Get the count of callbacks deferred to poll().
+        *
+        * @return uint16_t Deferred callback count.
+        */
+        uint16_t get_deferred_count() const;
+
+        /**
+        * @brief Get the count of deferred callbacks coalesced with a callback still pending.
+        *
+        * @return uint16_t Coalesced callback count.
+        */
+        uint16_t get_coalesced_count() const;
+
+        /**
+        * @brief Waits until a specified group channel has been measured.
+        *
+        * See ScanADC::wait_channel().
+        *
+        * @param[in] channel Channel index.
+        */
+        void wait_channel(uint8_t channel) const;
+
+        /**
+        * @brief Waits until all the group channels have been measured.
+        */
+        void wait_scan() const;
+
+        /**
+        * @brief Get the sample sequence number for a group channel.
+        *
+        * See ScanADC::get_sn().
+        *
+        * @param  channel Channel index.
+        * @return uint8_t Sequence number cycling from zero to 255.
+        */
+        inline uint8_t get_sn(uint8_t channel) const
+        {
+            return sn[channel];
+        }
+
+        /**
+        * @brief Reads sample for a group channel.
+        *
+        * @param[in] channel Channel index.
+        * @return uint16_t 10-bit unsigned sample.
+        */
+        uint16_t get_sample(uint8_t channel) const;
+
+        /**
+        * @brief Get the averaging used for the latest sample of a group channel.
+        *
+        * See ScanADC::get_sample_count_log2().
+        *
+        * @param[in] channel Channel index.
+        * @return uint8_t Log 2 of sample count.
+        */
+        inline uint8_t get_sample_count_log2(uint8_t channel) const
+        {
+            return sample_log2[channel];
+        }
+
+        /**
+        * @brief Copies the latest samples from the history of a group channel.
+        *
+        * See ScanADC::copy_history().
+        *
+        * @param[in]  channel Channel index.
+        * @param[out] dest    Array of at least @a n samples, filled oldest first.
+        * @param[in]  n       Maximum sample count to copy.
+        * @return uint8_t Sample count copied.
+        */
+        uint8_t copy_history(uint8_t channel, uint16_t *dest, uint8_t n) const;
+
+        /**
+        * @brief Get the change of a group channel from the previous to the latest sample.
+        *
+        * See ScanADC::get_delta().
+        *
+        * @param[in] channel Channel index.
+        * @return int16_t Latest sample minus previous sample.
+        */
+        int16_t get_delta(uint8_t channel) const;
+
+        /**
+        * @brief Sets the settling count of each group channel to the count measured for its input.
+        *
+        * See ScanADC::calibrate_settle().
+        *
+        * @param[in] tolerance Crosstalk in codes to accept.
+        */
+        void calibrate_settle(uint8_t tolerance = 1);
+
+        /**
+        * @brief Decodes the samples of a group channel as a resistor ladder keypad.
+        *
+        * See ScanADC::attach_keypad().
+        *
+        * @param[in] channel Channel index.
+        * @param[in] keypad  Keypad started with ScanKeypad::begin().
+        */
+        void attach_keypad(uint8_t channel, ScanKeypad *keypad);
+
+        /**
+        * @brief Stops decoding a keypad attached to the group.
+        *
+        * @param[in] keypad Keypad attached with attach_keypad().
+        */
+        void detach_keypad(ScanKeypad *keypad);
+
+        /**
+        * @brief Measures a group channel and a second input as AC voltage and current.
+        *
+        * See ScanADC::attach_power().
+        *
+        * @param[in] channel Channel index of the voltage.
+        * @param[in] power   Engine started with ScanPower::begin().
+        */
+        void attach_power(uint8_t channel, ScanPower *power);
+
+        /**
+        * @brief Stops measuring with a power engine attached to the group.
+        *
+        * @param[in] power Engine attached with attach_power().
+        */
+        void detach_power(ScanPower *power);
+
+        /**
+        * @brief Detects tones on a group channel with a Goertzel filter bank.
+        *
+        * See ScanADC::attach_tone().
+        *
+        * @param[in] channel Channel index filtered.
+        * @param[in] tone    Engine started with ScanTone::begin().
+        */
+        void attach_tone(uint8_t channel, ScanTone *tone);
+
+        /**
+        * @brief Stops filtering with a tone engine attached to the group.
+        *
+        * @param[in] tone Engine attached with attach_tone().
+        */
+        void detach_tone(ScanTone *tone);
+
+        /**
+        * @brief Checks if the pad of a group touch channel is touched.
+        *
+        * See ScanADC::is_touched().
+        *
+        * @param[in] channel Channel index.
+        * @return bool True if touched.
+        */
+        inline bool is_touched(uint8_t channel) const
+        {
+            return touch && touch[channel].touched;
+        }
+
+        /**
+        * @brief Get the rise of a group touch channel over its baseline.
+        *
+        * See ScanADC::get_touch_delta().
+        *
+        * @param[in] channel Channel index.
+        * @return int16_t Latest sample minus baseline.
+        */
+        int16_t get_touch_delta(uint8_t channel) const;
+
+        private:
+
+        friend class ScanADC;
+
+        /**
+        * @brief ADC Interrupt Service Routine (ISR) declared as friend to allow access to member variables.
+        */
+        friend void SCAN_ADC_vect(void);
+
+        /**
+        * @brief Prevent copy constructor.
+        */
+        Group(const Group &) = delete;
+
+        /**
+        * @brief Prevent assignment.
+        */
+        Group& operator=(const Group &) = delete;
+
+        /**
+        * @brief Settings of a channel read by the ISR, packed from its channel_config_t by begin().
+        */
+        struct channel_t
+        {
+            uint8_t mux;                           // Hardware value to connect analogue input to ADC.
+            uint8_t sample_count_log2:4;           // Log 2 of sample count, the maximum when adaptive.
+            uint8_t min_sample_count_log2:4;       // Log 2 of minimum sample count when adaptive.
+            uint8_t activity_threshold;            // Sample change to drop to minimum averaging or 0 to disable.
+            uint8_t median:3;                      // Median filter length of raw samples or 0 for no filter.
+            uint8_t settle:5;                      // Conversions discarded after selecting input.
+            uint8_t mode;                          // Measurement of the input by channel_mode_t.
+            uint8_t mode_arg;                      // Argument of the mode.
+        };
+
+        /**
+        * @brief Orders channels by external multiplexer address, after the channels not behind it.
+        *
+        * @param[in] c Channel settings.
+        * @return uint8_t Address plus 1, or 0 if the channel is not behind the external multiplexer.
+        */
+        static inline uint8_t ext_mux_key(const channel_t &c)
+        {
+            return (c.mode == CHANNEL_EXT_MUX) ? (uint8_t)(c.mode_arg + 1) : 0;
+        }
+
+        /**
+        * @brief Checks if the group should be measured at the current channel boundary.
+        *
+        * @param[in] now_ms Current time in milliseconds.
+        * @return bool True if the group is part way through a scan or its scan period has elapsed.
+        */
+        inline bool is_due(uint16_t now_ms) const
+        {
+            return (chan_i != 0) || (scan_period_ms == 0) ||
+                   ((uint16_t)(now_ms - scan_start_ms) >= scan_period_ms);
+        }
+
+        uint8_t chan_count;                        // Channel count configured.
+        uint8_t chan_i;                            // Scan position to measure next.
+
+        uint8_t priority;                          // Scheduling priority.
+        uint16_t scan_period_ms;                   // Time between the start of scans or 0 for continuous.
+        uint16_t scan_start_ms;                    // Time last scan started.
+
+        channel_callback_t channel_cb;             // Callback after channel processed.
+        channel_scan_callback_t channel_scan_cb;   // Callback after all channels processed.
+        volatile uint32_t *timestamps;             // Channel measurement times in microseconds or NULL.
+
+        bool deferred;                             // Callbacks deferred to poll().
+        volatile uint8_t *pending;                 // Channel callbacks pending bit mask.
+        volatile bool scan_pending;                // Scan callback pending.
+        volatile uint16_t deferred_cnt;            // Callbacks deferred.
+        volatile uint16_t coalesced_cnt;           // Deferred callbacks coalesced with a pending callback.
+
+        channel_t *chan;                           // Channel settings.
+        volatile uint8_t *sn;                      // Channel sample sequence numbers.
+        volatile uint16_t *sample;                 // Channel sample values.
+        uint8_t *chan_log2;                        // Channel log 2 of sample count to measure next.
+        reciprocal_t *reciprocal;                  // Channel reciprocals or NULL if all counts are powers of two.
+        history_t *history;                        // Channel history rings or NULL if no channel has history.
+        uint8_t *order;                            // Channel index at each scan position or NULL for index order.
+        ScanKeypad *keypads;                       // Keypads attached to channels.
+        ScanPower *powers;                         // Power engines attached to channels.
+        ScanTone *tones;                           // Tone engines attached to channels.
+        touch_t *touch;                            // Channel touch pads or NULL if no channel is a touch channel.
+        volatile uint8_t *sample_log2;             // Channel log 2 of sample count of latest sample.
+
+        Group *next;                               // Next started group in priority order.
+    };
+
     /**
     * @brief Get the single object of ScanADC.
     *
-    * This implement the singleton pattern to ensure only one single object of this class exists.
-    * In princible sharing the ADC and Interrupt Service Routine by multiple object could have
-    * been engineered but it would add considerable complexity for little gain.
+    * This implement the singleton pattern to ensure only one single object of this class exists
+    * as it owns the ADC and Interrupt Service Routine. Channels can be shared between multiple
+    * users of the ADC with Group.
     *
     * @return ScanADC& Instance of ScanADC.
     */
@@ -206,10 +821,10 @@ class ScanADC
     * @brief Starts scanning user defined analogue input channnels with the ADC under interrupt control.
     *
     * This function takes in the configuration of the channels to scan as a pointer to the configuration
-    * array @a channel_config and channel count @a channel_count and starts the scanning. A copy is made
-    * internally of the configuration. The ADC hardware is configured and ADC interrupt enabled
-    * for background ADC control, measurement and optional averaging of configured channels in
-    * round-robin fashion. The measurement always starts at channel 0 and wraps back after channel
+    * array @a channel_config and channel count @a channel_count and starts the scanning. The settings
+    * read by the ISR are copied internally, so the array need not be kept. The ADC hardware is
+    * configured and ADC interrupt enabled for background ADC control, measurement and optional
+    * averaging of configured channels in round-robin fashion. The measurement always starts at channel 0 and wraps back after channel
     * @a channel - 1.
     *
     * To stop the scanning call #end().
@@ -233,13 +848,20 @@ class ScanADC
     * @endcode
     * @param[in] channel_config Pointer to array with channel configurations.
     * @param[in] channel_count  Channel count to configure.
+    * @return bool True if started, false if the memory for the channels could not be allocated.
     */
-    void begin(const channel_config_t *channel_config, uint8_t channel_count);
+    inline bool begin(const channel_config_t *channel_config, uint8_t channel_count)
+    {
+        return default_group.begin(channel_config, channel_count);
+    }
 
     /**
-    * @brief Stops scanning disabling interrupt control.
+    * @brief Stops scanning disabling interrupt control unless other groups are started.
     */
-    void end();
+    inline void end()
+    {
+        default_group.end();
+    }
 
     /**
     * @brief Configures callback function to be called after each analogue channel is scanned.
@@ -258,7 +880,10 @@ class ScanADC
     *
     * @param[in] cb Pointer to callback function or NULL to disable callback.
     */
-    void attach_channel_callback(channel_callback_t cb = NULL);
+    inline void attach_channel_callback(channel_callback_t cb = NULL)
+    {
+        default_group.attach_channel_callback(cb);
+    }
 
     /**
     * @brief Configures callback function to be called after all analogue channels are scanned.
@@ -277,7 +902,81 @@ class ScanADC
     *
     * @param[in] cb Pointer to callback function or NULL to disable callback.
     */
-    void attach_scan_callback(channel_scan_callback_t cb = NULL);
+    inline void attach_scan_callback(channel_scan_callback_t cb = NULL)
+    {
+        default_group.attach_scan_callback(cb);
+    }
+
+    /**
+    * @brief Configures a buffer to be filled with the time each channel was measured.
+    *
+    * When enabled, the time from micros() is written to @a timestamps at the channel index each
+    * time a channel measurement completes, before the channel callback is called. Comparing the
+    * timestamps with the time a result is consumed gives the age of the samples, for example to
+    * measure the latency from an analogue input to a USB report.
+    *
+    * The buffer must hold the configured channel count of timestamps and remain valid while
+    * attached. Note that enabling timestamps adds the cost of micros() to the ISR.
+    *
+    * Note that this function is safe to call while scanning is in operation.
+    *
+    * @param[in] timestamps Pointer to array of channel count timestamps or NULL to disable.
+    */
+    inline void attach_timestamps(volatile uint32_t *timestamps = NULL)
+    {
+        default_group.attach_timestamps(timestamps);
+    }
+
+    /**
+    * @brief Configures the callbacks to be called from poll() instead of the ISR.
+    *
+    * A slow callback called from the ADC Interrupt Service Routine (ISR) delays the next conversion
+    * and other interrupts such as USB. When deferred, the ISR only marks the channel callback and
+    * scan callback as pending, and they are called by the next poll() from the main loop or another
+    * low priority context with interrupts enabled. The channel callback is passed the latest sample.
+    *
+    * If a channel is measured again before the pending callback is called, the callbacks are
+    * coalesced into a single call with the latest sample. Deferred and coalesced callbacks are
+    * counted, see get_deferred_count() and get_coalesced_count().
+    *
+    * Note that this function is safe to call while scanning is in operation.
+    *
+    * @param[in] deferred True to defer callbacks to poll(), false to call them from the ISR.
+    */
+    inline void set_deferred(bool deferred)
+    {
+        default_group.set_deferred(deferred);
+    }
+
+    /**
+    * @brief Calls the deferred callbacks of all started groups.
+    *
+    * Channel callbacks are called in channel order followed by the scan callback. Note the scan
+    * callback samples may be updated by the ISR while the callback runs.
+    */
+    void poll();
+
+    /**
+    * @brief Get the count of callbacks deferred to poll().
+    *
+    * @return uint16_t Deferred callback count.
+    */
+    inline uint16_t get_deferred_count() const
+    {
+        return default_group.get_deferred_count();
+    }
+
+    /**
+    * @brief Get the count of deferred callbacks coalesced with a callback still pending.
+    *
+    * A high count means poll() is not called often enough to see every sample.
+    *
+    * @return uint16_t Coalesced callback count.
+    */
+    inline uint16_t get_coalesced_count() const
+    {
+        return default_group.get_coalesced_count();
+    }
 
     /**
     * @brief Waits until a specified user configured channel has been measured.
@@ -309,14 +1008,20 @@ class ScanADC
     * @endcode
     * @param[in] channel Channel index.
     */
-    void wait_channel(uint8_t channel) const;
+    inline void wait_channel(uint8_t channel) const
+    {
+        default_group.wait_channel(channel);
+    }
 
     /**
     * @brief Waits until all the user configured channels have been measured.
     *
     * This is equvalent to wait_channel(@a channel_count - 1).
     */
-    void wait_scan() const;
+    inline void wait_scan() const
+    {
+        default_group.wait_scan();
+    }
 
     /**
     * @brief Get the sample sequence number for a channel.
@@ -333,7 +1038,7 @@ class ScanADC
     */
     inline uint8_t get_sn(uint8_t channel) const
     {
-        return sn[channel];
+        return default_group.get_sn(channel);
     }
 
     /**
@@ -346,66 +1051,989 @@ class ScanADC
     * @param[in] channel Channel index.
     * @return uint16_t 10-bit unsigned sample.
     */
-    uint16_t get_sample(uint8_t channel) const;
-
-    private:
-
-    /**
-     * @brief Private constructor to ensure only getInstance() can create this object.
-     */
-    ScanADC() : channel_cb(NULL), channel_scan_cb(NULL)
+    inline uint16_t get_sample(uint8_t channel) const
     {
+        return default_group.get_sample(channel);
     }
 
     /**
-    * @brief Prevent copy constructor.
+    * @brief Get the averaging used for the latest sample of a user configured channel.
+    *
+    * This is the configured #channel_config_t::sample_count_log2 unless the channel adapts its
+    * averaging to signal activity, in which case it is between the configured minimum and maximum.
+    * It is 0 for channels configured with #channel_config_t::sample_count.
+    *
+    * @param[in] channel Channel index.
+    * @return uint8_t Log 2 of sample count.
     */
-    ScanADC(const ScanADC &) = delete;
+    inline uint8_t get_sample_count_log2(uint8_t channel) const
+    {
+        return default_group.get_sample_count_log2(channel);
+    }
 
     /**
-    * @brief Prevent assignment.
+    * @brief Copies the latest samples from the history of a user configured channel.
+    *
+    * The channel keeps its latest #channel_config_t::history_depth samples in a ring. Up to @a n of
+    * the latest samples are copied to @a dest, oldest first, with the ADC interrupt disabled so the
+    * copy is consistent, for instance to compute a slope or a short median. Fewer samples are copied
+    * if fewer have been measured since begin() or the channel has a smaller history depth.
+    *
+    * @param[in]  channel Channel index.
+    * @param[out] dest    Array of at least @a n samples, filled oldest first.
+    * @param[in]  n       Maximum sample count to copy.
+    * @return uint8_t Sample count copied.
     */
-    ScanADC& operator=(const ScanADC &) = delete;
+    inline uint8_t copy_history(uint8_t channel, uint16_t *dest, uint8_t n) const
+    {
+        return default_group.copy_history(channel, dest, n);
+    }
 
     /**
-    * @brief ADC Interrupt Service Routine (ISR) declared as friend to allow access to member variables.
+    * @brief Get the change of a user configured channel from the previous to the latest sample.
+    *
+    * This is a cheap derivative of the channel in samples per scan. It requires a
+    * #channel_config_t::history_depth of at least 2 and is 0 until two samples are measured.
+    *
+    * @param[in] channel Channel index.
+    * @return int16_t Latest sample minus previous sample.
     */
-    friend void __vector_29();
+    inline int16_t get_delta(uint8_t channel) const
+    {
+        return default_group.get_delta(channel);
+    }
 
     /**
-     * @brief Structure to hold channel results.
-     */
-    struct channel_result_t
+    * @brief Checks if the pad of a user configured touch channel is touched.
+    *
+    * A channel with #channel_config_t::mode #CHANNEL_TOUCH measures the capacitance of a pad on the
+    * pin of its mode_arg, wired to the channel's analogue input, by charge sharing as states of the ISR.
+    * For each sample the ISR discharges the ADC sample and hold capacitor to GND while driving the
+    * pad high, then floats the pad and converts the input, so the charge of the pad is shared with
+    * the sample and hold capacitor. A finger adds capacitance to the pad and raises the sample. Each
+    * sample takes 3 conversions (2 on megaAVR-0 devices) and the channel averages its sample count
+    * as usual, without blocking the CPU between the conversions.
+    *
+    * The baseline follows the untouched samples over around 2 ^ #SCAN_ADC_TOUCH_BASELINE_LOG2
+    * measurements, tracking slow changes such as temperature and humidity. A touch is detected
+    * when the sample rises by the touch threshold over the baseline and released when it falls
+    * back under half of it. The baseline holds while touched.
+    *
+    * Note the ISR drives the pad pin by read-modify-write of its port. The other pins of the port
+    * must only be written with interrupts disabled, which digitalWrite() does.
+    *
+    * @param[in] channel Channel index.
+    * @return bool True if touched, false if not or not a touch channel.
+    */
+    inline bool is_touched(uint8_t channel) const
     {
-        volatile uint16_t sample;             /**< Channel 12-bit sample. */
-        volatile uint8_t sn;                  /**< Channel sequence number (0 to 255). */
-    };
+        return default_group.is_touched(channel);
+    }
 
     /**
-    * @brief Interrupt Service Routine (ISR) state machine states.
+    * @brief Get the rise of a user configured touch channel over its baseline.
+    *
+    * Useful to choose the #channel_config_t::touch_threshold of a pad, typically a fraction of the
+    * rise when touched.
+    *
+    * @param[in] channel Channel index.
+    * @return int16_t Latest sample minus baseline, 0 if not a touch channel.
     */
-    enum isr_state_t
+    inline int16_t get_touch_delta(uint8_t channel) const
     {
-      ISR_STATE_INIT = 0,                      /**< Initialises channel measurement. */
-      ISR_STATE_DELAY,                         /**< Delay required after switching analogue input. */
-      ISR_STATE_ACCUMULATE                     /**< Accumulates and when done, advances to next channel. */
-    };
+        return default_group.get_touch_delta(channel);
+    }
 
-    uint8_t chan_count;                        // Channel count configured.
+    /**
+    * @brief Measures the crosstalk into an analogue input from the previously selected input and
+    * recommends the minimum settling count.
+    *
+    * A high source impedance slows the charging of the ADC sample and hold capacitor, so the first
+    * conversions after switching still partly measure the previous input. The input is measured
+    * repeatedly after switching from GND and from an internal reference (the 1.1V bandgap, or the
+    * analogue comparator DAC reference on megaAVR-0 devices) with the same timing as the ISR. The
+    * crosstalk is the difference between the averages of both, and the recommended count is the
+    * first conversion at which it is within @a tolerance codes.
+    *
+    * The scanning must have been started with begin(). The ISR is held off for around 10ms while
+    * measuring and the channel being measured is restarted afterwards.
+    *
+    * @param[in]  mux       Hardware value to connect analogue input to ADC.
+    * @param[in]  tolerance Crosstalk in codes to accept.
+    * @param[out] leakage   Crosstalk in codes without settling conversions, or NULL.
+    * @param[in]  ext_mux   External multiplexer address by #SCAN_ADC_EXT_MUX() to select or 0 for none.
+    * @return uint8_t Settling count from 0 to #SCAN_ADC_SETTLE_MAX, or 0 if not started.
+    */
+    uint8_t measure_settle(mux_t mux, uint8_t tolerance = 1, uint16_t *leakage = NULL, uint8_t ext_mux = 0);
 
-    channel_callback_t channel_cb;             // Callback after channel processed.
-    channel_scan_callback_t channel_scan_cb;   // Callback after all channels processed.
+    /**
+    * @brief Sets the settling count of each user configured channel to the count measured for its input.
+    *
+    * Each channel #channel_config_t::settle is replaced by the count from measure_settle() with the
+    * external multiplexer address of the channel selected, so low impedance inputs are not slowed down
+    * by settling conversions they do not need. On megaAVR-0 devices the count of a channel behind an
+    * external multiplexer is at least 1.
+    *
+    * @param[in] tolerance Crosstalk in codes to accept.
+    */
+    inline void calibrate_settle(uint8_t tolerance = 1)
+    {
+        default_group.calibrate_settle(tolerance);
+    }
 
-    isr_state_t state;                         // Sequencing state.
-    uint8_t chan_i;                            // Channel index being processed.
+    /**
+    * @brief Decodes the samples of a user configured channel as a resistor ladder keypad.
+    *
+    * Each sample of the channel is mapped to a key and debounced by the keypad in the ISR, see
+    * ScanKeypad. More than one keypad can be attached, each to its own channel.
+    *
+    * Note that this function is safe to call while scanning is in operation.
+    *
+    * @param[in] channel Channel index.
+    * @param[in] keypad  Keypad started with ScanKeypad::begin().
+    */
+    inline void attach_keypad(uint8_t channel, ScanKeypad *keypad)
+    {
+        default_group.attach_keypad(channel, keypad);
+    }
+
+    /**
+    * @brief Stops decoding a keypad attached to a user configured channel.
+    *
+    * @param[in] keypad Keypad attached with attach_keypad().
+    */
+    inline void detach_keypad(ScanKeypad *keypad)
+    {
+        default_group.detach_keypad(keypad);
+    }
+
+    /**
+    * @brief Measures a user configured channel and a second input as AC voltage and current.
+    *
+    * The channel input measures the voltage and the engine input the current. While the channel is
+    * measured the ISR alternates the conversions between both inputs over whole cycles of the voltage
+    * and accumulates the sums for the true RMS values and real power, see ScanPower. The channel
+    * sample is the DC level of the voltage input. More than one engine can be attached, each to its
+    * own channel.
+    *
+    * Note that this function is safe to call while scanning is in operation.
+    *
+    * @param[in] channel Channel index of the voltage.
+    * @param[in] power   Engine started with ScanPower::begin().
+    */
+    inline void attach_power(uint8_t channel, ScanPower *power)
+    {
+        default_group.attach_power(channel, power);
+    }
+
+    /**
+    * @brief Stops measuring with a power engine attached to a user configured channel.
+    *
+    * A window in progress still ends, so the engine must stay valid until the channel completes.
+    *
+    * @param[in] power Engine attached with attach_power().
+    */
+    inline void detach_power(ScanPower *power)
+    {
+        default_group.detach_power(power);
+    }
+
+    /**
+    * @brief Detects tones on a user configured channel with a Goertzel filter bank.
+    *
+    * While the channel is measured the ISR feeds a block of raw conversions through a Goertzel filter
+    * per frequency bin of the engine and latches the bins at the end of the block, see ScanTone. The
+    * channel sample is the mean of the block. More than one engine can be attached, each to its own
+    * channel.
+    *
+    * Note that this function is safe to call while scanning is in operation.
+    *
+    * @param[in] channel Channel index filtered.
+    * @param[in] tone    Engine started with ScanTone::begin().
+    */
+    inline void attach_tone(uint8_t channel, ScanTone *tone)
+    {
+        default_group.attach_tone(channel, tone);
+    }
+
+    /**
+    * @brief Stops filtering with a tone engine attached to a user configured channel.
+    *
+    * A block in progress still ends, so the engine must stay valid until the channel completes.
+    *
+    * @param[in] tone Engine attached with attach_tone().
+    */
+    inline void detach_tone(ScanTone *tone)
+    {
+        default_group.detach_tone(tone);
+    }
+
+    /**
+    * @brief Requests an injected high priority measurement of an analogue input.
+    *
+    * The injected measurement preempts the scan of the groups at the next conversion boundary rather
+    * than waiting for the scan to reach a channel. The analogue input @a mux is measured averaging
+    * 2 to the power of @a sample_count_log2 samples, after which the optional callback @a cb is called,
+    * the injected sequence number incremented and the scan resumed from where it was preempted. A
+    * channel that was part way through averaging keeps its accumulated samples.
+    *
+    * Only one injected measurement can be pending at a time and a group must be started so the ADC
+    * is running.
+    *
+    * Example of checking the motor current before enabling the motor:
+    * @code
+    *   if (adc_scanner.read_injected(MOTOR_CURRENT_ADC, 2) < MOTOR_CURRENT_MAX)
+    *   {
+    *       enable_motor();
+    *   }
+    * @endcode
+    * @param[in] mux               Hardware value to connect analogue input to ADC.
+    * @param[in] sample_count_log2 Log 2 of sample count.
+    * @param[in] cb                Pointer to callback function or NULL for no callback.
+    * @return bool True if the measurement was requested, false if one is already pending or the ADC is stopped.
+    */
+    bool inject(mux_t mux, uint8_t sample_count_log2 = 0, injected_callback_t cb = NULL);
+
+    /**
+    * @brief Checks if an injected measurement is pending.
+    *
+    * @return bool True if an injected measurement has been requested and not yet completed.
+    */
+    inline bool is_injected_pending() const
+    {
+        return inject_pending;
+    }
+
+    /**
+    * @brief Waits until a pending injected measurement has completed.
+    */
+    void wait_injected() const;
+
+    /**
+    * @brief Get the injected measurement sequence number.
+    *
+    * The sequence number is incremented once an injected measurement is completed and cycles from 0 to 255.
+    *
+    * @return uint8_t Sequence number cycling from zero to 255.
+    */
+    inline uint8_t get_injected_sn() const
+    {
+        return injected_sn;
+    }
+
+    /**
+    * @brief Reads the last injected measurement.
+    *
+    * @return uint16_t 10-bit unsigned sample.
+    */
+    uint16_t get_injected_sample() const;
+
+    /**
+    * @brief Requests an injected measurement, waits for it to complete and returns it.
+    *
+    * Any injected measurement already pending is waited for first.
+    *
+    * @param[in] mux               Hardware value to connect analogue input to ADC.
+    * @param[in] sample_count_log2 Log 2 of sample count.
+    * @return uint16_t 10-bit unsigned sample or 0 if the ADC is stopped.
+    */
+    uint16_t read_injected(mux_t mux, uint8_t sample_count_log2 = 0);
+
+    /**
+    * @brief Locks the conversion rate to the mains frequency to reject mains hum.
+    *
+    * Instead of free running, conversions are triggered by Timer1 compare match B at
+    * #SCAN_ADC_MAINS_SAMPLES conversions per mains cycle (3200Hz at 50Hz, 3840Hz at 60Hz). A channel
+    * averaging a multiple of #SCAN_ADC_MAINS_SAMPLES samples then integrates a whole number of
+    * mains cycles and the hum averages out whatever its phase, for instance a sample_count_log2 of
+    * 6 for one cycle or 8 for four cycles, or a sample_count of 192 for three cycles. Each
+    * conversion is triggered after the ISR has selected its input, so no conversions are discarded
+    * when switching channels.
+    *
+    * Note Timer1 is reconfigured and can not be used for other purposes such as PWM on its pins
+    * while locked. The timer period is rounded to whole CPU clocks, so at 60Hz with a 16MHz clock
+    * the window is 0.008% longer than a cycle, limiting rejection to around 70dB.
+    *
+    * Note that this function is safe to call while scanning is in operation.
+    *
+    * @param[in] mains Mains frequency or #MAINS_OFF for free running conversions.
+    * @return bool True if supported, false on megaAVR-0 devices where only #MAINS_OFF is supported.
+    */
+    bool set_mains(mains_t mains);
+
+    /**
+    * @brief Lets other interrupts such as USB and timers preempt the ADC ISR.
+    *
+    * Normally the ADC ISR runs with interrupts disabled, so the latency of every other interrupt can
+    * grow by the longest ADC ISR, including any callbacks and averaging at the end of a channel. When
+    * interruptible, the ISR reads the conversion result, disables the ADC interrupt so it can not
+    * nest on itself, and then enables interrupts globally for the rest of its processing, including
+    * callbacks. The ADC interrupt is enabled again just before returning. Other interrupts are then
+    * only delayed by the ISR entry up to enabling interrupts, a few tens of CPU cycles.
+    *
+    * Note while interruptible, the library functions must not be called from other interrupt handlers
+    * as they could preempt the ISR part way through updating the channel. The stack must also have room
+    * for the ADC ISR and the interrupts nested on it.
+    *
+    * Note that this function is safe to call while scanning is in operation.
+    *
+    * @param[in] interruptible True to enable interrupts during ADC ISR processing.
+    * @return bool True if supported, false on megaAVR-0 devices where an interrupt can only be
+    * preempted by the high priority (level 1) interrupt, so only false is supported.
+    */
+    bool set_interruptible(bool interruptible);
+
+    /**
+    * @brief Sets the port pins driving the address select lines of an external analogue multiplexer.
+    *
+    * An external multiplexer such as a CD4051 (8 inputs, 3 select lines) or 74HC4067 (16 inputs,
+    * 4 select lines) extends the scan to more inputs than the ADC has. Its output is wired to an ADC
+    * input and its select lines to @a bits consecutive pins of one port from bit @a shift upwards,
+    * e.g. PB4 to PB7 with a shift of 4 and 4 bits. A channel behind the multiplexer sets mux to the
+    * ADC input, mode to #CHANNEL_EXT_MUX and mode_arg to its address.
+    *
+    * The ISR writes the select lines directly to the port when it selects the ADC input of a channel,
+    * so the multiplexer switches during the conversion discarded after selecting. On megaAVR-0 devices
+    * no conversion is discarded, so begin() raises the settle of channels behind the multiplexer to at
+    * least 1. Slow sources can add conversions to discard with the channel settle. The channels of a group are scanned grouped
+    * by address, keeping the order of the channel indices otherwise, so the select lines change once
+    * per address in each scan. Samples are still reported by channel index, while the channel
+    * callbacks are called in scan order.
+    *
+    * Note the ISR changes the select lines by read-modify-write of the port. The other pins of the
+    * port must only be written with interrupts disabled, which digitalWrite() does.
+    *
+    * Note that this function is safe to call while scanning is in operation.
+    *
+    * @param[in] port  Output register of the port, e.g. &PORTB.
+    * @param[in] ddr   Direction register of the port, e.g. &DDRB, or NULL if pins already output.
+    * @param[in] shift Bit of the first (least significant) select line.
+    * @param[in] bits  Select lines, 0 to stop driving them.
+    */
+    void set_external_mux(volatile uint8_t *port, volatile uint8_t *ddr, uint8_t shift, uint8_t bits);
+
+    /**
+    * @brief Sets the port pin switching the excitation of lock-in channels such as strain gauge bridges.
+    *
+    * A channel with mode #CHANNEL_LOCKIN is measured as a lock-in amplifier. The ISR drives the
+    * excitation pin high, discards the conversions after switching as after selecting an input
+    * (including the channel settle), accumulates 2 ^ mode_arg samples, drives the pin low and
+    * repeats this with the samples subtracted, until the channel sample count has been accumulated
+    * with the excitation on and again with it off. The sample is the average difference between the
+    * excitation on and off plus #SCAN_ADC_LOCKIN_ZERO, so offsets and drift slower than the phases
+    * cancel while the differential readings stay unsigned for the other channel functions. The
+    * excitation is left off at the end of the channel. An injected measurement preempts the channel
+    * at the end of a phase.
+    *
+    * Shorter phases reject lower frequency noise but discard a larger share of the conversions, for
+    * instance a mode_arg of 0 alternates every conversion and discards every other one. The phase
+    * length is limited to the channel sample count. The median filter and a sample_count that is not
+    * a power of two do not apply to lock-in channels.
+    *
+    * Note the ISR switches the pin by read-modify-write of the port. The other pins of the port must
+    * only be written with interrupts disabled, which digitalWrite() does.
+    *
+    * Note that this function is safe to call while scanning is in operation.
+    *
+    * @param[in] port Output register of the port, e.g. &PORTD.
+    * @param[in] ddr  Direction register of the port, e.g. &DDRD, or NULL if the pin is already output.
+    * @param[in] bit  Bit of the excitation pin, 0xFF to stop driving it.
+    */
+    void set_excitation(volatile uint8_t *port, volatile uint8_t *ddr, uint8_t bit);
+
+    private:
+
+    /**
+     * @brief Private constructor to ensure only getInstance() can create this object.
+     */
+    ScanADC() : groups(NULL), group(NULL), mains(MAINS_OFF), interruptible(false), ext_port(NULL),
+                exc_port(NULL), tone_skip(false), inject_pending(false), injecting(false)
+    {
+    }
+
+    /**
+    * @brief Prevent copy constructor.
+    */
+    ScanADC(const ScanADC &) = delete;
+
+    /**
+    * @brief Prevent assignment.
+    */
+    ScanADC& operator=(const ScanADC &) = delete;
+
+    /**
+    * @brief ADC Interrupt Service Routine (ISR) declared as friend to allow access to member variables.
+    */
+    friend void SCAN_ADC_vect(void);
+
+    /**
+    * @brief Interrupt Service Routine (ISR) state machine states.
+    */
+    enum isr_state_t
+    {
+      ISR_STATE_INIT = 0,                      /**< Initialises channel measurement. */
+      ISR_STATE_DELAY,                         /**< Discards conversions after switching analogue input. */
+      ISR_STATE_ACCUMULATE,                    /**< Accumulates and when done, advances to next channel. */
+      ISR_STATE_ACCUMULATE_NARROW,             /**< As #ISR_STATE_ACCUMULATE with 16-bit accumulator and 8-bit counter. */
+      ISR_STATE_ACCUMULATE_MEDIAN,             /**< As #ISR_STATE_ACCUMULATE with median filter of raw samples. */
+      ISR_STATE_ACCUMULATE_LOCKIN,             /**< Accumulates excitation phases and when done, advances to next channel. */
+      ISR_STATE_TOUCH_CHARGE,                  /**< Accumulates charge shared with touch pad and charges it again. */
+      ISR_STATE_TOUCH_SHARE,                   /**< Floats touch pad to share its charge with the next conversion. */
+      ISR_STATE_POWER_VOLTAGE,                 /**< Accumulates voltage of power engine and when done, advances to next channel. */
+      ISR_STATE_POWER_CURRENT,                 /**< Accumulates current of power engine. */
+      ISR_STATE_TONE                           /**< Filters conversions by tone engine and when done, advances to next channel. */
+    };
+
+    /**
+    * @brief Adds a started group to the groups time-sharing the ADC, starting the ADC if necessary.
+    *
+    * @param[in] g Group to add.
+    */
+    void attach(Group *g);
+
+    /**
+    * @brief Removes a group from the groups time-sharing the ADC, stopping the ADC if no groups remain.
+    *
+    * @param[in] g Group to remove.
+    */
+    void detach(Group *g);
+
+    /**
+    * @brief Selects the group to measure the next channel from at a channel boundary.
+    *
+    * @return Group* Group to measure or NULL if no group is due.
+    */
+    Group *schedule();
+
+#if defined(SCAN_ADC_MEGAAVR0)
+    /**
+    * @brief Connects an analogue input to the ADC.
+    *
+    * Conversions are started one at a time by the ISR, so the input is measured from the next conversion.
+    *
+    * @param[in] mux Hardware value to connect analogue input to ADC.
+    */
+    static inline void select(uint8_t mux)
+    {
+        ADC0.MUXPOS = mux;
+    }
+
+    /**
+    * @brief Get the log 2 of the samples accumulated in hardware per result for a log 2 sample count.
+    *
+    * The hardware accumulates up to 64 samples per result. Higher counts are accumulated
+    * from multiple results in software.
+    *
+    * @param[in] sample_count_log2 Log 2 of sample count.
+    * @return uint8_t Log 2 of samples accumulated per result.
+    */
+    static inline uint8_t hw_sample_count_log2(uint8_t sample_count_log2)
+    {
+        return (sample_count_log2 > 6) ? 6 : sample_count_log2;
+    }
+
+    /**
+    * @brief Configures the samples accumulated in hardware per result.
+    *
+    * @param[in] hw_log2 Log 2 of samples accumulated per result from hw_sample_count_log2().
+    */
+    static inline void set_hw_sample_count_log2(uint8_t hw_log2)
+    {
+        ADC0.CTRLB = hw_log2;
+    }
+
+    /**
+    * @brief Reads the result of the completed conversion.
+    *
+    * @return uint16_t Sum of the samples accumulated by hardware.
+    */
+    static inline uint16_t read()
+    {
+        return ADC0.RES;
+    }
+
+    /**
+    * @brief Starts the next conversion at the end of the ISR.
+    */
+    static inline void convert()
+    {
+        ADC0.INTFLAGS = ADC_RESRDY_bm;
+        ADC0.COMMAND = ADC_STCONV_bm;
+    }
+
+    /**
+    * @brief Checks if the ADC is enabled.
+    *
+    * @return bool True if enabled.
+    */
+    static inline bool is_running()
+    {
+        return ADC0.CTRLA & ADC_ENABLE_bm;
+    }
+
+    /**
+    * @brief Disables the ADC interrupt to access member variables shared with the ISR.
+    *
+    * @return uint8_t Interrupt state to pass to unlock().
+    */
+    static inline uint8_t lock()
+    {
+        uint8_t old_INTCTRL = ADC0.INTCTRL;
+
+        ADC0.INTCTRL = 0;
+
+        return old_INTCTRL;
+    }
+
+    /**
+    * @brief Restores the ADC interrupt state saved by lock().
+    *
+    * @param[in] old_INTCTRL Interrupt state returned by lock().
+    */
+    static inline void unlock(uint8_t old_INTCTRL)
+    {
+        ADC0.INTCTRL = old_INTCTRL;
+    }
+
+    /**
+    * @brief Waits for the conversion in progress while locked and starts the next conversion.
+    *
+    * The input is selected before starting the next conversion, as by the ISR.
+    *
+    * @param[in] next_mux Hardware value of the analogue input to select.
+    * @return uint16_t Result of the conversion in progress.
+    */
+    static inline uint16_t read_polled(uint8_t next_mux)
+    {
+        while (!(ADC0.INTFLAGS & ADC_RESRDY_bm))
+        {
+        }
+
+        uint16_t result = read();
+
+        select(next_mux);
+        convert();
+
+        return result;
+    }
+
+    /**
+    * @brief Internal input switched from by measure_settle() to measure crosstalk from a voltage above GND.
+    */
+    static const mux_t SETTLE_REFERENCE = MUX_DACREF;
+
+    /**
+    * @brief Checks if the conversion in progress when an input is selected is of the previous input.
+    *
+    * @return bool Always false as each conversion is started by the ISR after the input is selected.
+    */
+    static inline bool is_pipelined()
+    {
+        return false;
+    }
+#else
+    /**
+    * @brief Connects an analogue input to the ADC.
+    *
+    * The conversion in progress is not affected and the input is measured from the following conversion.
+    *
+    * @param[in] mux Hardware value to connect analogue input to ADC.
+    */
+    static inline void select(uint8_t mux)
+    {
+#if defined(MUX5)
+        ADCSRB = (ADCSRB & (~(1 << MUX5))) | ((mux & 0x20) ? (1 << MUX5) : 0);
+#endif
+        ADMUX = (ADMUX & 0xE0) | (mux & 0x1F);
+    }
+
+    /**
+    * @brief Get the log 2 of the samples accumulated in hardware per result for a log 2 sample count.
+    *
+    * @param[in] sample_count_log2 Log 2 of sample count.
+    * @return uint8_t Always 0 as there is no hardware accumulation.
+    */
+    static inline uint8_t hw_sample_count_log2(uint8_t sample_count_log2)
+    {
+        (void) sample_count_log2;
+
+        return 0;
+    }
+
+    /**
+    * @brief Configures the samples accumulated in hardware per result. Nothing to configure.
+    *
+    * @param[in] hw_log2 Log 2 of samples accumulated per result.
+    */
+    static inline void set_hw_sample_count_log2(uint8_t hw_log2)
+    {
+        (void) hw_log2;
+    }
+
+    /**
+    * @brief Reads the result of the completed conversion.
+    *
+    * @return uint16_t 10-bit unsigned sample.
+    */
+    static inline uint16_t read()
+    {
+        uint8_t low, high;
+
+        low = ADCL;
+        high = ADCH;
+
+        return (uint16_t)((high << 8) | low);
+    }
+
+    /**
+    * @brief Starts the next conversion at the end of the ISR.
+    *
+    * Nothing to do when the ADC is free running. When locked to the mains by Timer1 compare match B,
+    * the compare flag is cleared so the next compare match triggers the next conversion.
+    */
+    static inline void convert()
+    {
+        if (ADCSRB & (1 << ADTS0))
+        {
+            TIFR1 = (1 << OCF1B);
+        }
+    }
+
+    /**
+    * @brief Configures the conversion trigger.
+    *
+    * @param[in] mains Mains frequency to lock conversions to or #MAINS_OFF to free run.
+    */
+    static void trigger(mains_t mains);
+
+    /**
+    * @brief Checks if the ADC is enabled.
+    *
+    * @return bool True if enabled.
+    */
+    static inline bool is_running()
+    {
+        return ADCSRA & (1 << ADEN);
+    }
+
+    /**
+    * @brief Disables the ADC interrupt to access member variables shared with the ISR.
+    *
+    * @return uint8_t Interrupt state to pass to unlock().
+    */
+    static inline uint8_t lock()
+    {
+        uint8_t old_ADCSRA = ADCSRA;
+
+        // ADIF is written as 0 so a conversion completed meanwhile still interrupts after unlock().
+        ADCSRA = old_ADCSRA & ~((1 << ADIE) | (1 << ADIF));
+
+        return old_ADCSRA;
+    }
+
+    /**
+    * @brief Restores the ADC interrupt state saved by lock().
+    *
+    * Locked to the mains, a conversion interrupt lost by a write to ADCSRA outside the library would
+    * leave the compare flag set so no further conversion is triggered. When unlocking from outside
+    * the ISR with no conversion in progress or completed, a set compare flag is such a lost
+    * interrupt and is cleared to restart the conversions.
+    *
+    * @param[in] old_ADCSRA Interrupt state returned by lock().
+    */
+    static inline void unlock(uint8_t old_ADCSRA)
+    {
+        ADCSRA = old_ADCSRA & ~(1 << ADIF);
+
+        if ((ADCSRB & (1 << ADTS0)) && (old_ADCSRA & (1 << ADIE)) && (SREG & (1 << SREG_I)) &&
+            (TIFR1 & (1 << OCF1B)) && !(ADCSRA & ((1 << ADSC) | (1 << ADIF))))
+        {
+            TIFR1 = (1 << OCF1B);
+        }
+    }
+
+    /**
+    * @brief Waits for the conversion in progress while locked and selects the input.
+    *
+    * The input is selected after the following conversion has started, as by the ISR, so it is
+    * measured from the conversion after next.
+    *
+    * @param[in] next_mux Hardware value of the analogue input to select.
+    * @return uint16_t Result of the conversion in progress.
+    */
+    static inline uint16_t read_polled(uint8_t next_mux)
+    {
+        while (!(ADCSRA & (1 << ADIF)))
+        {
+        }
+
+        uint16_t result = read();
+
+        ADCSRA |= (1 << ADIF);
+        select(next_mux);
+        convert();
+
+        return result;
+    }
+
+    /**
+    * @brief Internal input switched from by measure_settle() to measure crosstalk from a voltage above GND.
+    */
+    static const mux_t SETTLE_REFERENCE = MUX_1V1;
+
+    /**
+    * @brief Disables the ADC interrupt and enables interrupts globally from the ISR, so other
+    * interrupts can preempt the rest of the ISR without the ADC interrupt nesting on itself.
+    *
+    * ADIF is written as 0 so a conversion completing meanwhile is not cleared.
+    */
+    static inline void isr_release()
+    {
+        ADCSRA &= ~((1 << ADIE) | (1 << ADIF));
+        sei();
+    }
+
+    /**
+    * @brief Disables interrupts globally and enables the ADC interrupt again at the end of the ISR.
+    *
+    * A conversion completed while released interrupts again as soon as the ISR returns.
+    */
+    static inline void isr_reacquire()
+    {
+        cli();
+        ADCSRA = (ADCSRA & ~(1 << ADIF)) | (1 << ADIE);
+    }
+
+    /**
+    * @brief Checks if the conversion in progress when an input is selected is of the previous input.
+    *
+    * Free running, the next conversion has already started when the ISR selects an input, so it is
+    * discarded. Locked to the mains, the next conversion starts at the compare match following the
+    * ISR, so it is of the selected input.
+    *
+    * @return bool True if free running.
+    */
+    static inline bool is_pipelined()
+    {
+        return !(ADCSRB & (1 << ADTS0));
+    }
+#endif
+
+    /**
+    * @brief Starts the hardware scanning under interrupt control.
+    *
+    * @param[in] mux Hardware value of the analogue input to start with.
+    */
+    static void start(uint8_t mux);
+
+    /**
+    * @brief Stops the hardware scanning.
+    */
+    static void stop();
+
+    /**
+    * @brief Prepares measurement of an analogue input from the ISR.
+    *
+    * Selects the input and sets up the counts to accumulate and round the samples.
+    * The sample counter and accumulator are not changed.
+    *
+    * @param[in] mux               Hardware value to connect analogue input to ADC.
+    * @param[in] sample_count_log2 Log 2 of sample count.
+    * @param[in] reciprocal        Reciprocal of sample count that is not a power of two or NULL.
+    * @param[in] median            Median filter length or 0 for no filter.
+    * @param[in] settle            Conversions to discard in addition to any required after selecting.
+    */
+    void prepare(uint8_t mux, uint8_t sample_count_log2, const reciprocal_t *reciprocal = NULL,
+                 uint8_t median = 0, uint8_t settle = 0);
+
+    /**
+    * @brief Filters a raw sample by the median of the latest median filter length samples from the ISR.
+    *
+    * @param[in,out] sample Raw sample replaced by the median.
+    * @return bool True if the median is available, false while filling the filter after selecting.
+    */
+    bool filter_median(uint16_t &sample);
+
+    /**
+    * @brief Prepares measurement of a group channel from the ISR.
+    *
+    * @param[in] g      Group.
+    * @param[in] resume True to continue the window of a power or tone engine after an injected
+    *                   measurement, false to start a new one.
+    */
+    void prepare_channel(const Group *g, bool resume = false);
+
+    /**
+    * @brief Writes the external multiplexer select lines from the ISR if the address changed.
+    *
+    * @param[in] address External multiplexer address.
+    */
+    void select_external(uint8_t address);
+
+    /**
+    * @brief Prepares lock-in measurement of the input selected by prepare() from the ISR.
+    *
+    * Starts with the excitation phase of the sample counter, so a channel resumed after an injected
+    * measurement continues with the phase it was at.
+    *
+    * @param[in] phase_log2        Log 2 of samples per excitation phase.
+    * @param[in] sample_count_log2 Log 2 of sample count with the excitation on and with it off.
+    */
+    void prepare_lockin(uint8_t phase_log2, uint8_t sample_count_log2);
+
+    /**
+    * @brief Switches the excitation to the phase of the sample counter and discards the conversions
+    * after switching from the ISR.
+    */
+    void next_phase();
+
+    /**
+    * @brief Drives the excitation pin from the ISR.
+    *
+    * @param[in] on True to switch the excitation on.
+    */
+    void excite(bool on);
+
+    /**
+    * @brief Prepares capacitive touch measurement of the pad of the input selected by prepare() from
+    * the ISR and starts charging it.
+    *
+    * @param[in] mux   Hardware value of the analogue input wired to the pad.
+    * @param[in] touch Pad pin.
+    */
+    void prepare_touch(uint8_t mux, const touch_t &touch);
+
+    /**
+    * @brief Discharges the sample and hold capacitor to GND and charges the touch pad from the ISR.
+    */
+    void charge_touch();
+
+    /**
+    * @brief Floats the touch pad and selects its input to share the charge from the ISR.
+    */
+    void share_touch();
+
+    /**
+    * @brief Prepares AC measurement of the input selected by prepare() and the current input of a
+    * power engine from the ISR.
+    *
+    * @param[in] mux    Hardware value of the analogue input measuring the voltage.
+    * @param[in] power  Power engine.
+    * @param[in] resume True to continue the window in progress, false to start a new one.
+    */
+    void prepare_power(uint8_t mux, ScanPower *power, bool resume);
+
+    /**
+    * @brief Prepares a block of raw conversions of the input selected by prepare() for a tone engine
+    * from the ISR.
+    *
+    * @param[in] tone   Tone engine.
+    * @param[in] resume True to continue the block after an injected measurement, false to start a
+    *                   new one.
+    */
+    void prepare_tone(ScanTone *tone, bool resume);
+
+    /**
+    * @brief Averages the accumulated samples and stores the result from the ISR.
+    *
+    * Shared by the accumulating states when the sample count is reached.
+    *
+    * @param[in] accumulator Sum of the samples.
+    */
+    void complete(uint32_t accumulator);
+
+    /**
+    * @brief Starts measuring the next channel from the ISR at a channel boundary.
+    */
+    void next_channel();
+
+    /**
+    * @brief Ends the channel measured by the ISR.
+    */
+    void end_channel();
+
+    /**
+    * @brief Starts the injected measurement from the ISR, saving the channel being measured.
+    */
+    void start_injected();
+
+    /**
+    * @brief Resumes the channel being measured when the injected measurement was started.
+    */
+    void resume_injected();
+
+    Group default_group;                       // Group used by the ScanADC channel functions.
+    Group *groups;                             // Started groups in priority order.
+    Group *group;                              // Group being processed.
+    mains_t mains;                             // Mains frequency conversions are locked to.
+    bool interruptible;                        // Interrupts enabled during ISR processing.
+
+    volatile uint8_t *ext_port;                // External multiplexer select port or NULL if none.
+    uint8_t ext_mask;                          // External multiplexer select lines of port.
+    uint8_t ext_shift;                         // External multiplexer select line of address bit 0.
+    uint8_t ext_address;                       // External multiplexer address selected, 0xFF if unknown.
+
+    volatile uint8_t *exc_port;                // Excitation port or NULL if none.
+    uint8_t exc_mask;                          // Excitation pin of port.
+    uint8_t lockin_settle;                     // Conversions to discard after switching the excitation.
+    uint16_t lockin_phase_cnt;                 // Results accumulated per excitation phase.
+    uint16_t lockin_cnt;                       // Results left to accumulate in the excitation phase.
+    uint32_t lockin_offset;                    // Offset results with the excitation off are subtracted from.
+
+    volatile uint8_t *touch_port;              // Touch pad output register.
+    volatile uint8_t *touch_ddr;               // Touch pad direction register.
+    uint8_t touch_mask;                        // Touch pad pin of port.
+    uint8_t touch_mux;                         // Analogue input wired to touch pad.
+
+    ScanPower *power;                          // Power engine measuring.
+    uint8_t power_v_mux;                       // Power engine voltage input.
+    uint8_t power_i_mux;                       // Power engine current input.
+
+    ScanTone *tone;                            // Tone engine filtering.
+    bool tone_skip;                            // Tone block paused by an injected measurement.
+
+    isr_state_t state;                         // Sequencing state.
+
+    isr_state_t accumulate_state;              // Accumulating state selected by prepare().
+    uint8_t settle_cnt;                        // Conversions left to discard in ISR_STATE_DELAY.
+    uint8_t accumulate_hw_log2;                // Log 2 of samples accumulated by hardware after discarding.
+
+    // The narrow members alias the low bytes (AVR is little endian) and are used by
+    // ISR_STATE_ACCUMULATE_NARROW when at most SCAN_ADC_NARROW_SAMPLES are accumulated, so the sum
+    // fits 16 bits and the high bytes remain zero.
+    union
+    {
+        uint16_t sample_cnt;                   // Sample counter (0 to sample_cnt_target).
+        uint8_t sample_cnt_narrow;             // Sample counter low byte.
+    };
 
-    uint16_t sample_cnt;                       // Sample counter (0 to sample_cnt_target).
     uint16_t sample_cnt_target;                // Sample count to accumulate.
-    uint32_t sample_accumulator;               // Sample accumulator.
+    uint8_t sample_count_log2;                 // Log 2 of sample count to accumulate.
+    uint16_t sample_round;                     // Rounding added to accumulator before averaging.
+    const reciprocal_t *sample_reciprocal;     // Reciprocal of sample count or NULL to average by shifting.
+
+    union
+    {
+        uint32_t sample_accumulator;           // Sample accumulator.
+        uint16_t sample_accumulator_narrow;    // Sample accumulator low bytes.
+    };
+
+    volatile bool inject_pending;              // Injected measurement requested and not completed.
+    bool injecting;                            // Injected measurement in progress.
+    bool inject_resume;                        // Channel to resume after injected measurement.
+    uint8_t inject_mux;                        // Injected analogue input.
+    uint8_t inject_sample_count_log2;          // Injected log 2 of sample count.
+    injected_callback_t injected_cb;           // Callback after injected measurement.
+    volatile uint16_t injected_sample;         // Injected measurement.
+    volatile uint8_t injected_sn;              // Injected measurement sequence number.
+
+    uint16_t resume_sample_cnt;                // Sample counter of preempted channel.
+    uint32_t resume_sample_accumulator;        // Sample accumulator of preempted channel.
 
-    channel_config_t *config;                  // Channel configurations.
-    volatile uint8_t *sn;                      // Channel sample sequence numbers.
-    volatile uint16_t *sample;                 // Channel sample values.
+    uint8_t median_n;                          // Median filter length.
+    uint8_t median_head;                       // Median window index to write next sample.
+    uint8_t median_fill;                       // Samples in median window, up to length - 1.
+    uint16_t median_window[SCAN_ADC_MEDIAN_MAX]; // Latest raw samples in ring order.
 };
 
 
@@ -0,0 +1,149 @@
+/**
+ * @file ScanCalibration.cpp
+ * @author Hobbylad ()
+ * @brief Lookup table calibration and shaping of ScanADC axis samples.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanCalibration.h"
+
+#include "Arduino.h"
+
+void ScanCalibration::begin(const uint16_t *table)
+{
+    this->table = table;
+    progmem = false;
+}
+
+void ScanCalibration::begin_P(const uint16_t *table)
+{
+    this->table = table;
+    progmem = true;
+}
+
+/**
+ * @brief Fixed point scale mapping a deflection range to 1024 x 256.
+ *
+ * Rounded up so the endpoint maps to exactly 1024.
+ *
+ * @param[in] range Deflection beyond the deadzone at the endpoint.
+ * @return uint16_t Scale.
+ */
+static uint16_t endpoint_scale(int16_t range)
+{
+    return (uint16_t)(((1024UL << 8) + range - 1) / range);
+}
+
+bool ScanCalibration::build(uint16_t *table, const calibration_t &calibration)
+{
+    int16_t upper = (int16_t) calibration.max - (int16_t) calibration.center - (int16_t) calibration.deadzone;
+    int16_t lower = (int16_t) calibration.center - (int16_t) calibration.deadzone - (int16_t) calibration.min;
+
+    // A scale of at most 0xFFFF only reaches 1024 from a range of 5, 4 x 0xFFFF >> 8 being 1023.
+    if ((upper < SCAN_CALIBRATION_MIN_RANGE) || (lower < SCAN_CALIBRATION_MIN_RANGE))
+    {
+        return false;
+    }
+
+    float expo = calibration.expo / 100.0f;
+    float half = calibration.out_max / 2.0f;
+
+    table[SCAN_CALIBRATION_CENTER] = calibration.center;
+    table[SCAN_CALIBRATION_DEADZONE] = calibration.deadzone;
+    table[SCAN_CALIBRATION_SCALE_UPPER] = endpoint_scale(upper);
+    table[SCAN_CALIBRATION_SCALE_LOWER] = endpoint_scale(lower);
+
+    for (uint8_t i = 0; i <= SCAN_CALIBRATION_SEGMENTS; i++)
+    {
+        float n = ((float) i / (SCAN_CALIBRATION_SEGMENTS / 2)) - 1.0f;
+        float y = ((1.0f - expo) * n) + (expo * n * n * n);
+
+        table[SCAN_CALIBRATION_CURVE + i] = (uint16_t)((half * (1.0f + y)) + 0.5f);
+    }
+
+    return true;
+}
+
+void ScanCalibration::capture_begin()
+{
+    captured.min = 0xFFFF;
+    captured.max = 0;
+}
+
+bool ScanCalibration::capture_end(uint16_t center, uint16_t deadzone, uint8_t expo, uint16_t out_max,
+                                  uint16_t *table)
+{
+    captured.center = center;
+    captured.deadzone = deadzone;
+    captured.expo = expo;
+    captured.out_max = out_max;
+
+    // Without movement on a side, that side has no range and the capture is rejected.
+    if (captured.min > center)
+    {
+        captured.min = center;
+    }
+
+    if (captured.max < center)
+    {
+        captured.max = center;
+    }
+
+    if (!build(table, captured))
+    {
+        return false;
+    }
+
+    begin(table);
+
+    return true;
+}
+
+void ScanCalibration::print(Print &out, const char *name) const
+{
+    if (!table)
+    {
+        return;
+    }
+
+    out.print("const uint16_t ");
+    out.print(name);
+    out.print("[SCAN_CALIBRATION_TABLE_SIZE] PROGMEM =\n{");
+
+    for (uint8_t i = 0; i < SCAN_CALIBRATION_TABLE_SIZE; i++)
+    {
+        out.print((i % 8) ? " " : "\n    ");
+        out.print(read(i));
+
+        if (i != SCAN_CALIBRATION_TABLE_SIZE - 1)
+        {
+            out.print(',');
+        }
+    }
+
+    out.println("\n};");
+}
@@ -0,0 +1,276 @@
+/**
+ * @file ScanCalibration.h
+ * @author Hobbylad ()
+ * @brief Lookup table calibration and shaping of ScanADC axis samples.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCAN_CALIBRATION_H
+#define SCAN_CALIBRATION_H
+
+#include "stdint.h"
+#include "stdlib.h"
+
+#include <avr/pgmspace.h>
+
+class Print;
+
+#define SCAN_CALIBRATION_SEGMENTS_LOG2  5       // 32 table segments from minimum to maximum endpoint.
+#define SCAN_CALIBRATION_SEGMENTS       (1 << SCAN_CALIBRATION_SEGMENTS_LOG2)
+#define SCAN_CALIBRATION_SEGMENT_LOG2   (11 - SCAN_CALIBRATION_SEGMENTS_LOG2)
+#define SCAN_CALIBRATION_SEGMENT        (1 << SCAN_CALIBRATION_SEGMENT_LOG2)
+#define SCAN_CALIBRATION_CENTER         0       // Table index of center sample.
+#define SCAN_CALIBRATION_DEADZONE       1       // Table index of deadzone.
+#define SCAN_CALIBRATION_SCALE_UPPER    2       // Table index of scale above center, 1024 x 256 / range.
+#define SCAN_CALIBRATION_SCALE_LOWER    3       // Table index of scale below center, 1024 x 256 / range.
+#define SCAN_CALIBRATION_CURVE          4       // Table index of first curve entry.
+#define SCAN_CALIBRATION_MIN_RANGE      5       // Minimum samples beyond the deadzone to each endpoint.
+
+/**
+ * Table entry count, the center, deadzone and endpoint scales followed by an output value at each
+ * segment boundary including the maximum endpoint.
+ */
+#define SCAN_CALIBRATION_TABLE_SIZE     (SCAN_CALIBRATION_CURVE + SCAN_CALIBRATION_SEGMENTS + 1)
+
+/**
+ * @brief Class to calibrate and shape an analogue axis such as a joystick with a lookup table.
+ *
+ * The calibration maps a 10-bit sample to an output from 0 to a maximum with the center at half
+ * the maximum. It corrects the center offset, applies a deadzone around the center, scales each
+ * side of the center to its observed endpoint and applies an expo curve to soften the response
+ * around the center:
+ *
+ *   n = (sample - center - deadzone) / (max - center - deadzone), limited from -1 to 1
+ *   y = (1 - expo) x n + expo x n^3
+ *   output = out_max / 2 x (1 + y)
+ *
+ * (mirrored for samples below the center.)
+ *
+ * The table holds the center, deadzone and a fixed point scale for each side of the center followed
+ * by the curve evaluated once at points evenly spaced across n from -1 to 1. Samples are mapped by
+ * removing the center and deadzone, scaling to the endpoint and linearly interpolating between the
+ * curve entries, costing two multiplies and a few table reads per sample instead of floating point
+ * math, so it can be applied in the ScanADC callbacks. The center, deadzone and endpoints are exact
+ * for endpoints at least #SCAN_CALIBRATION_MIN_RANGE samples beyond the deadzone, as a shorter range
+ * needs a scale above the 16-bit table entry to reach full scale, and are rejected when building.
+ * In between, the interpolation of the curve and the 1024 steps of n either side of the center keep
+ * the output within 0.4% of out_max of the formula, or within 2 output steps if that is more. The
+ * error grows with the expo, up to 4 steps for an out_max of 1023 at 100%.
+ *
+ * The table can be built at run time in RAM from a calibration or captured from the observed
+ * movement of the axis, and printed as a PROGMEM initializer to be compiled into the sketch so
+ * later builds use a table in flash memory with no calibration step.
+ *
+ * Example:
+ * @code
+ *   static uint16_t yaw_table[SCAN_CALIBRATION_TABLE_SIZE];
+ *   static ScanCalibration yaw;
+ *
+ *   yaw.capture_begin();
+ *   ...
+ *   yaw.capture(adc_scanner.get_sample(0));            // While the stick is moved to its endpoints
+ *   ...
+ *   yaw.capture_end(adc_scanner.get_sample(0), 8, 30, 1023, yaw_table);   // Stick released
+ *   yaw.print(Serial, "yaw_table");
+ *   ...
+ *   output = yaw.apply(sample);
+ * @endcode
+ */
+class ScanCalibration
+{
+    public:
+
+    /**
+    * @brief Calibration of an axis.
+    */
+    typedef struct _calibration
+    {
+        uint16_t min;                           /**< Sample at minimum endpoint. */
+        uint16_t center;                        /**< Sample at center. */
+        uint16_t max;                           /**< Sample at maximum endpoint. */
+        uint16_t deadzone;                      /**< Samples either side of center mapped to center. */
+        uint8_t expo;                           /**< Expo curve from 0 linear to 100 cubic percent. */
+        uint16_t out_max;                       /**< Output at maximum endpoint. */
+    } calibration_t;
+
+    /**
+    * @brief Constructs a calibration without a table that passes samples through.
+    */
+    ScanCalibration() : table(NULL), progmem(false)
+    {
+    }
+
+    /**
+    * @brief Uses a table in RAM built by build().
+    *
+    * @param[in] table Pointer to #SCAN_CALIBRATION_TABLE_SIZE table entries.
+    */
+    void begin(const uint16_t *table);
+
+    /**
+    * @brief Uses a table in PROGMEM such as one printed by print().
+    *
+    * @param[in] table Pointer to #SCAN_CALIBRATION_TABLE_SIZE table entries in PROGMEM.
+    */
+    void begin_P(const uint16_t *table);
+
+    /**
+    * @brief Builds a table from a calibration.
+    *
+    * Uses floating point math so should not be called from an interrupt.
+    *
+    * @param[out] table       Pointer to #SCAN_CALIBRATION_TABLE_SIZE table entries.
+    * @param[in]  calibration Calibration.
+    * @return bool True if built, false without changing the table if an endpoint is less than
+    *              #SCAN_CALIBRATION_MIN_RANGE samples beyond the deadzone.
+    */
+    static bool build(uint16_t *table, const calibration_t &calibration);
+
+    /**
+    * @brief Starts capturing the endpoints of the axis.
+    */
+    void capture_begin();
+
+    /**
+    * @brief Captures a sample while the axis is moved to both endpoints.
+    *
+    * @param[in] sample Sample.
+    */
+    inline void capture(uint16_t sample)
+    {
+        if (sample < captured.min)
+        {
+            captured.min = sample;
+        }
+
+        if (sample > captured.max)
+        {
+            captured.max = sample;
+        }
+    }
+
+    /**
+    * @brief Completes the capture with the axis at its center and builds and uses the table.
+    *
+    * @param[in]  center   Sample with the axis released at its center.
+    * @param[in]  deadzone Samples either side of center mapped to center.
+    * @param[in]  expo     Expo curve from 0 linear to 100 cubic percent.
+    * @param[in]  out_max  Output at maximum endpoint.
+    * @param[out] table    Pointer to #SCAN_CALIBRATION_TABLE_SIZE table entries to build.
+    * @return bool True if built and used, false without changing the table in use if the axis did
+    *              not move at least #SCAN_CALIBRATION_MIN_RANGE samples beyond the deadzone to both
+    *              endpoints.
+    */
+    bool capture_end(uint16_t center, uint16_t deadzone, uint8_t expo, uint16_t out_max, uint16_t *table);
+
+    /**
+    * @brief Get the calibration last captured.
+    *
+    * @return const calibration_t& Calibration.
+    */
+    inline const calibration_t &get_captured() const
+    {
+        return captured;
+    }
+
+    /**
+    * @brief Prints the table in use as a PROGMEM initializer to be pasted into a sketch.
+    *
+    * @param[in] out  Output such as Serial.
+    * @param[in] name Table variable name.
+    */
+    void print(Print &out, const char *name) const;
+
+    /**
+    * @brief Maps a sample through the table.
+    *
+    * Note this function is short enough to be called from the ScanADC callbacks.
+    *
+    * @param[in] sample 10-bit unsigned sample.
+    * @return uint16_t Output from 0 to the calibration output maximum, or the sample without a table.
+    */
+    inline uint16_t apply(uint16_t sample) const
+    {
+        if (!table)
+        {
+            return sample;
+        }
+
+        int16_t deflection = (int16_t) sample - (int16_t) read(SCAN_CALIBRATION_CENTER);
+        int16_t deadzone = read(SCAN_CALIBRATION_DEADZONE);
+        uint32_t scaled;
+        uint16_t n;
+
+        // Deflection beyond the deadzone scaled to 0 to 1024 either side of 1024.
+        if (deflection > deadzone)
+        {
+            scaled = ((uint32_t)(deflection - deadzone) * read(SCAN_CALIBRATION_SCALE_UPPER)) >> 8;
+
+            if (scaled >= 1024)
+            {
+                return read(SCAN_CALIBRATION_CURVE + SCAN_CALIBRATION_SEGMENTS);
+            }
+
+            n = 1024 + scaled;
+        }
+        else if (deflection < -deadzone)
+        {
+            scaled = ((uint32_t)(-deflection - deadzone) * read(SCAN_CALIBRATION_SCALE_LOWER)) >> 8;
+            n = (scaled < 1024) ? (1024 - scaled) : 0;
+        }
+        else
+        {
+            n = 1024;
+        }
+
+        uint8_t i = SCAN_CALIBRATION_CURVE + (n >> SCAN_CALIBRATION_SEGMENT_LOG2);
+        uint8_t f = n & (SCAN_CALIBRATION_SEGMENT - 1);
+        uint16_t y0 = read(i), y1 = read(i + 1);
+
+        return y0 + (int16_t)((((int32_t)(int16_t)(y1 - y0) * f) + (SCAN_CALIBRATION_SEGMENT / 2))
+                              >> SCAN_CALIBRATION_SEGMENT_LOG2);
+    }
+
+    private:
+
+    /**
+    * @brief Reads a table entry from RAM or PROGMEM.
+    *
+    * @param[in] i Table index.
+    * @return uint16_t Table entry.
+    */
+    inline uint16_t read(uint8_t i) const
+    {
+        return progmem ? pgm_read_word(table + i) : table[i];
+    }
+
+    const uint16_t *table;                      // Table in use or NULL to pass samples through.
+    bool progmem;                               // Table is in PROGMEM.
+    calibration_t captured;                     // Calibration captured.
+};
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file ScanKeypad.cpp
+ * @author Hobbylad ()
+ * @brief Resistor ladder keypad decoding of a ScanADC channel.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanKeypad.h"
+
+#include "Arduino.h"
+#include <avr/interrupt.h>
+
+void ScanKeypad::begin(const uint16_t *thresholds, uint8_t key_count, uint8_t debounce)
+{
+    if (key_count > SCAN_KEYPAD_MAX_KEYS)
+    {
+        key_count = SCAN_KEYPAD_MAX_KEYS;
+    }
+
+    this->thresholds = thresholds;
+    this->key_count = key_count;
+    this->debounce = debounce ? debounce : 1;
+    candidate = key_count;
+    candidate_cnt = 0;
+    key = key_count;
+    keys = 0;
+    event_tail = event_head;
+}
+
+void ScanKeypad::build(const uint16_t *levels, uint8_t key_count, uint16_t idle_level, uint16_t *thresholds)
+{
+    for (uint8_t i = 0; i < key_count; i++)
+    {
+        uint16_t above = (i + 1 < key_count) ? levels[i + 1] : idle_level;
+
+        thresholds[i] = (levels[i] + above) / 2;
+    }
+}
+
+uint16_t ScanKeypad::get_keys() const
+{
+    uint8_t old_SREG = SREG;
+
+    cli();
+    uint16_t k = keys;
+    SREG = old_SREG;
+
+    return k;
+}
+
+bool ScanKeypad::read_event(uint8_t &event)
+{
+    uint8_t tail = event_tail;
+
+    if (tail == event_head)
+    {
+        return false;
+    }
+
+    event = events[tail & (SCAN_KEYPAD_EVENTS - 1)];
+    event_tail = tail + 1;
+
+    return true;
+}
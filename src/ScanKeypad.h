@@ -0,0 +1,218 @@
+/**
+ * @file ScanKeypad.h
+ * @author Hobbylad ()
+ * @brief Resistor ladder keypad decoding of a ScanADC channel.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCAN_KEYPAD_H
+#define SCAN_KEYPAD_H
+
+#include "stdint.h"
+#include "stdlib.h"
+
+class ScanADC;
+
+#define SCAN_KEYPAD_MAX_KEYS    16      // Keys per ladder, one bit each of get_keys().
+#define SCAN_KEYPAD_EVENTS      8       // Events queued until read, a power of two.
+#define SCAN_KEYPAD_PRESSED     0x80    // Event flag of a key press, clear for a key release.
+#define SCAN_KEYPAD_KEY_MASK    0x7F    // Event mask of key index.
+
+/**
+ * @brief Class to decode a resistor ladder keypad on a ScanADC channel.
+ *
+ * A resistor ladder puts several buttons on one analogue input, each pulling the input to its own
+ * level. The keypad is attached to a channel with ScanADC::attach_keypad() and each sample of the
+ * channel is decoded in the ADC ISR, so keys are read without polling from the main loop.
+ *
+ * A sample is mapped to the first key whose threshold it does not exceed, or to no key above the
+ * last threshold, so the ladder is wired with the idle level above the key levels (for example
+ * a pull-up to the reference) and the thresholds are ascending. build() places the thresholds half
+ * way between the nominal key levels. A key change is accepted after it is decoded from the
+ * debounce count of consecutive samples, rejecting contact bounce and the intermediate levels
+ * measured while the input moves between levels. Accepted changes are queued as press and release
+ * events and the key pressed is available as a bit mask.
+ *
+ * Example:
+ * @code
+ *   static const uint16_t levels[] = { 0, 143, 327, 512, 675 };
+ *   static uint16_t thresholds[5];
+ *   static ScanKeypad keypad;
+ *
+ *   ScanKeypad::build(levels, 5, 1023, thresholds);
+ *   keypad.begin(thresholds, 5, 3);
+ *   adc_scanner.attach_keypad(4, &keypad);
+ *   ...
+ *   uint8_t event;
+ *
+ *   while (keypad.read_event(event))
+ *   {
+ *       if (event & SCAN_KEYPAD_PRESSED) { ... }
+ *   }
+ * @endcode
+ */
+class ScanKeypad
+{
+    public:
+
+    /**
+    * @brief Constructs a keypad without keys.
+    */
+    ScanKeypad() : thresholds(NULL), key_count(0), debounce(1), candidate(0), candidate_cnt(0), key(0),
+                   keys(0), event_head(0), event_tail(0), dropped_cnt(0), next(NULL)
+    {
+    }
+
+    /**
+    * @brief Starts decoding keys with a threshold table.
+    *
+    * Call before attaching the keypad to a channel.
+    *
+    * @param[in] thresholds Ascending upper sample of each key, kept in use.
+    * @param[in] key_count  Key count up to #SCAN_KEYPAD_MAX_KEYS.
+    * @param[in] debounce   Consecutive samples to accept a key change.
+    */
+    void begin(const uint16_t *thresholds, uint8_t key_count, uint8_t debounce = 3);
+
+    /**
+    * @brief Builds thresholds half way between the nominal levels of the keys and the idle level.
+    *
+    * @param[in]  levels      Ascending nominal sample of each key pressed.
+    * @param[in]  key_count   Key count.
+    * @param[in]  idle_level  Nominal sample with no key pressed, above the key levels.
+    * @param[out] thresholds  Pointer to @a key_count thresholds.
+    */
+    static void build(const uint16_t *levels, uint8_t key_count, uint16_t idle_level, uint16_t *thresholds);
+
+    /**
+    * @brief Get the keys pressed.
+    *
+    * The mask is read with interrupts disabled, as it is updated by the ISR. Note this function is
+    * short enough to be called from the ScanADC callbacks.
+    *
+    * @return uint16_t Bit mask with bit n set while key n is pressed.
+    */
+    uint16_t get_keys() const;
+
+    /**
+    * @brief Reads the oldest queued key event.
+    *
+    * @param[out] event Key index, with #SCAN_KEYPAD_PRESSED set for a press and clear for a release.
+    * @return bool True if an event was read, false if none is queued.
+    */
+    bool read_event(uint8_t &event);
+
+    /**
+    * @brief Get the count of events dropped as the queue was full.
+    *
+    * @return uint8_t Dropped event count.
+    */
+    inline uint8_t get_dropped_count() const
+    {
+        return dropped_cnt;
+    }
+
+    private:
+
+    friend class ScanADC;
+
+    /**
+    * @brief Queues an event from the ISR, dropping it if the queue is full.
+    *
+    * @param[in] event Event.
+    */
+    inline void push(uint8_t event)
+    {
+        uint8_t head = event_head;
+
+        if ((uint8_t)(head - event_tail) == SCAN_KEYPAD_EVENTS)
+        {
+            dropped_cnt++;
+            return;
+        }
+
+        events[head & (SCAN_KEYPAD_EVENTS - 1)] = event;
+        event_head = head + 1;
+    }
+
+    /**
+    * @brief Decodes and debounces a sample of the channel from the ISR.
+    *
+    * @param[in] sample 10-bit unsigned sample.
+    */
+    inline void update(uint16_t sample)
+    {
+        uint8_t k = 0;
+
+        while ((k < key_count) && (sample > thresholds[k]))
+        {
+            k++;
+        }
+
+        if (k != candidate)
+        {
+            candidate = k;
+            candidate_cnt = 1;
+        }
+        else if (candidate_cnt < debounce)
+        {
+            candidate_cnt++;
+        }
+
+        if ((candidate_cnt == debounce) && (k != key))
+        {
+            if (key != key_count)
+            {
+                push(key);
+            }
+
+            if (k != key_count)
+            {
+                push(SCAN_KEYPAD_PRESSED | k);
+            }
+
+            key = k;
+            keys = (k != key_count) ? (1U << k) : 0;
+        }
+    }
+
+    const uint16_t *thresholds;                 // Ascending upper sample of each key.
+    uint8_t key_count;                          // Key count, also the index decoded with no key pressed.
+    uint8_t debounce;                           // Consecutive samples to accept a key change.
+    uint8_t candidate;                          // Key decoded from the latest samples.
+    uint8_t candidate_cnt;                      // Consecutive samples the candidate was decoded.
+    uint8_t key;                                // Key accepted.
+    volatile uint16_t keys;                     // Bit mask of key accepted.
+    volatile uint8_t events[SCAN_KEYPAD_EVENTS]; // Queued events.
+    volatile uint8_t event_head;                // Count of events queued, wrapping.
+    volatile uint8_t event_tail;                // Count of events read, wrapping.
+    volatile uint8_t dropped_cnt;               // Events dropped.
+    uint8_t channel;                            // Channel index decoded.
+    ScanKeypad *next;                           // Next keypad attached to the group.
+};
+
+#endif
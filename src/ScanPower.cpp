@@ -0,0 +1,198 @@
+/**
+ * @file ScanPower.cpp
+ * @author Hobbylad ()
+ * @brief True RMS and real power measurement of a pair of ScanADC channels.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanPower.h"
+
+#include "Arduino.h"
+#include <avr/interrupt.h>
+
+/**
+ * @brief Integer square root rounded down.
+ *
+ * @param[in] x Value.
+ * @return uint32_t Largest root whose square does not exceed @a x.
+ */
+static uint32_t isqrt(uint64_t x)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > x)
+    {
+        bit >>= 2;
+    }
+
+    while (bit)
+    {
+        if (x >= root + bit)
+        {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+
+        bit >>= 2;
+    }
+
+    return (uint32_t) root;
+}
+
+/**
+ * @brief Computes the RMS of the AC part of an input from the sums of a window.
+ *
+ * @param[in] n     Sample count.
+ * @param[in] sum   Sum of samples.
+ * @param[in] sum2  Sum of squared samples.
+ * @param[in] scale Micro units per code.
+ * @return uint32_t RMS in milli units.
+ */
+static uint32_t rms(uint32_t n, int64_t sum, uint64_t sum2, uint32_t scale)
+{
+    // n² times the variance, so the DC left in the sums is removed exactly.
+    int64_t var = (int64_t)(n * sum2) - (sum * sum);
+
+    if (var <= 0)
+    {
+        return 0;
+    }
+
+    return (uint32_t)((uint64_t) isqrt((uint64_t) var) * scale / n / 1000);
+}
+
+void ScanPower::begin(ScanADC::mux_t current_mux, uint8_t cycles, uint32_t v_scale, uint32_t i_scale)
+{
+    this->current_mux = current_mux;
+    this->cycles = cycles ? cycles : 1;
+    this->v_scale = v_scale;
+    this->i_scale = i_scale;
+    offset_v = 512;
+    offset_i = 512;
+    read_sn = sn;
+}
+
+inline void ScanPower::clear_cycle()
+{
+    part_n = 0;
+    part_v = 0;
+    part_i = 0;
+    part_vv = 0;
+    part_ii = 0;
+    part_vi = 0;
+}
+
+void ScanPower::start()
+{
+    have_v = false;
+    armed = false;
+    started = false;
+    cycle_cnt = 0;
+    start_us = micros();
+
+    clear_cycle();
+    memset(&sum, 0, sizeof(sum));
+}
+
+bool ScanPower::end_cycle(bool crossed)
+{
+    uint32_t now_us = micros();
+
+    if (crossed && !started)
+    {
+        // The window starts at this crossing, so the samples before it are discarded.
+        started = true;
+        start_us = now_us;
+
+        clear_cycle();
+
+        return false;
+    }
+
+    sum.v += part_v;
+    sum.i += part_i;
+    sum.vv += part_vv;
+    sum.ii += part_ii;
+    sum.vi += part_vi;
+    sum.n += part_n;
+
+    if (crossed && (++cycle_cnt < cycles))
+    {
+        clear_cycle();
+
+        return false;
+    }
+
+    sum.duration_us = now_us - start_us;
+    sum.cycles = crossed ? cycle_cnt : 0;
+    window = sum;
+    sn++;
+
+    // Follow the DC levels with the mean of the last cycle for the next window.
+    if (part_n)
+    {
+        offset_v += (int16_t)(part_v / (int16_t) part_n);
+        offset_i += (int16_t)(part_i / (int16_t) part_n);
+    }
+
+    return true;
+}
+
+bool ScanPower::read(result_t &result)
+{
+    window_t w;
+    uint8_t old_SREG = SREG;
+
+    cli();
+    uint8_t s = sn;
+    w = window;
+    SREG = old_SREG;
+
+    if ((s == read_sn) || (w.n == 0))
+    {
+        return false;
+    }
+
+    read_sn = s;
+
+    result.v_rms_mv = rms(w.n, w.v, w.vv, v_scale);
+    result.i_rms_ma = rms(w.n, w.i, w.ii, i_scale);
+
+    // n² times the mean product of the AC parts, scaled in steps that do not overflow 64 bits.
+    int64_t p = (int64_t) w.n * w.vi - (w.v * w.i);
+
+    result.power_mw = (int32_t)((p / (int64_t) w.n * (int64_t) v_scale / (int64_t) w.n) * (int64_t) i_scale / 1000000000LL);
+    result.frequency_chz = w.cycles ? (uint16_t)((uint64_t) w.cycles * 100000000ULL / w.duration_us) : 0;
+    result.samples = w.n;
+
+    return true;
+}
@@ -0,0 +1,271 @@
+/**
+ * @file ScanPower.h
+ * @author Hobbylad ()
+ * @brief True RMS and real power measurement of a pair of ScanADC channels.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCAN_POWER_H
+#define SCAN_POWER_H
+
+#include "stdint.h"
+#include "stdlib.h"
+
+#include "ScanADC.h"
+
+#define SCAN_POWER_MAX_CYCLE    2047    // Sample pairs to close a window without a zero crossing.
+#define SCAN_POWER_HYSTERESIS   4       // Codes below the DC level to arm the next zero crossing.
+
+/**
+ * @brief Class to measure the true RMS voltage and current and the real power of an AC supply.
+ *
+ * The power engine is attached to a channel with ScanADC::attach_power(). The channel input
+ * measures the voltage and the engine input the current, for example through a divider and a
+ * current transformer biased to half the reference. While the channel is measured, the ADC ISR
+ * alternates the conversions between both inputs and accumulates the sums of v, i, v², i² and v·i
+ * relative to the DC level, where the current is multiplied by the average of the voltages
+ * converted before and after it so both are aligned in time.
+ *
+ * A window starts at the first rising zero crossing of the voltage after the channel is selected
+ * and ends at the crossing after the configured cycle count, so it spans whole cycles. The channel
+ * then completes with the DC level of the voltage as its sample, and read() computes the results
+ * of the window with integer math in the main loop. The DC level of each input is tracked from
+ * window to window and the residual DC is removed exactly from the sums.
+ *
+ * The other channels wait until the window ends. An injected measurement is taken between two
+ * sample pairs and the window continues after it without the pair across the gap. The channel settle
+ * count discards conversions of the voltage before the inputs alternate, when the channel is selected
+ * and after an injected measurement. The median, lock-in and touch settings do not apply.
+ *
+ * Example:
+ * @code
+ *   static ScanPower power;
+ *
+ *   power.begin(ScanADC::MUX_ADC1, 10, 781250, 48828);   // 0.78V and 48.8mA per code
+ *   adc_scanner.attach_power(0, &power);                   // Voltage on the input of channel 0
+ *   ...
+ *   ScanPower::result_t r;
+ *
+ *   if (power.read(r))
+ *   {
+ *       Serial.println(r.power_mw);
+ *   }
+ * @endcode
+ */
+class ScanPower
+{
+    public:
+
+    /**
+    * @brief Results of a window.
+    */
+    struct result_t
+    {
+        uint32_t v_rms_mv;                 /**< RMS voltage in millivolts. */
+        uint32_t i_rms_ma;                 /**< RMS current in milliamps. */
+        int32_t  power_mw;                 /**< Real power in milliwatts, negative if exported. */
+        uint16_t frequency_chz;            /**< Frequency in 1/100 Hz or 0 if the window had no whole cycle. */
+        uint32_t samples;                  /**< Sample pairs of the window. */
+    };
+
+    /**
+    * @brief Constructs an engine measuring nothing.
+    */
+    ScanPower() : cycles(1), v_scale(1000), i_scale(1000), offset_v(512), offset_i(512), sn(0), read_sn(0),
+                  next(NULL)
+    {
+    }
+
+    /**
+    * @brief Starts measuring with the current input and scaling.
+    *
+    * Call before attaching the engine to a channel. With the default scales of 1000 the results
+    * are in ADC codes.
+    *
+    * @param[in] current_mux Hardware value of the analogue input measuring the current.
+    * @param[in] cycles      Whole cycles per window.
+    * @param[in] v_scale     Microvolts per code of the voltage input, up to 1048575.
+    * @param[in] i_scale     Microamps per code of the current input, up to 1048575.
+    */
+    void begin(ScanADC::mux_t current_mux, uint8_t cycles = 10, uint32_t v_scale = 1000, uint32_t i_scale = 1000);
+
+    /**
+    * @brief Reads the results of the latest window.
+    *
+    * @param[out] result Results.
+    * @return bool True if a window ended since the last read, false if the results are unchanged.
+    */
+    bool read(result_t &result);
+
+    /**
+    * @brief Get the sequence number of the windows.
+    *
+    * @return uint8_t Count of windows ended, wrapping.
+    */
+    inline uint8_t get_sn() const
+    {
+        return sn;
+    }
+
+    private:
+
+    friend class ScanADC;
+
+    /**
+    * @brief ADC Interrupt Service Routine (ISR) declared as friend to allow access to member variables.
+    */
+    friend void SCAN_ADC_vect(void);
+
+    /**
+    * @brief Sums of a window relative to the DC levels.
+    */
+    struct window_t
+    {
+        int64_t  v;                        // Sum of voltages.
+        int64_t  i;                        // Sum of currents.
+        uint64_t vv;                       // Sum of squared voltages.
+        uint64_t ii;                       // Sum of squared currents.
+        int64_t  vi;                       // Sum of voltage and current products.
+        uint32_t n;                        // Sample pairs.
+        uint32_t duration_us;              // Time from first to last zero crossing.
+        uint8_t  cycles;                   // Whole cycles or 0 if closed without a zero crossing.
+    };
+
+    /**
+    * @brief Starts waiting for a zero crossing from the ISR when the channel is selected.
+    */
+    void start();
+
+    /**
+    * @brief Continues the window from the ISR after an injected measurement.
+    *
+    * The conversions before the gap are not paired with those after it, so the next current is
+    * ignored and the next voltage starts a new pair.
+    */
+    inline void resume()
+    {
+        have_v = false;
+    }
+
+    /**
+    * @brief Clears the sums of the cycle in progress.
+    */
+    void clear_cycle();
+
+    /**
+    * @brief Ends a cycle at a zero crossing, or a window without one, from the ISR.
+    *
+    * @param[in] crossed True at a zero crossing, false when the cycle is too long.
+    * @return bool True if the window ended.
+    */
+    bool end_cycle(bool crossed);
+
+    /**
+    * @brief Accumulates a conversion of the voltage from the ISR.
+    *
+    * @param[in] sample 10-bit unsigned conversion.
+    * @return bool True if the window ended.
+    */
+    inline bool add_voltage(uint16_t sample)
+    {
+        int16_t v = (int16_t) sample - offset_v;
+
+        if (have_v)
+        {
+            part_v += v;
+            part_vv += (int32_t) v * v;
+            part_vi += (int32_t)((int16_t)(v + v_last) >> 1) * i_last;
+            part_n++;
+        }
+
+        have_v = true;
+        v_last = v;
+
+        if (v < -SCAN_POWER_HYSTERESIS)
+        {
+            armed = true;
+        }
+        else if (armed && (v >= 0))
+        {
+            armed = false;
+            return end_cycle(true);
+        }
+
+        return (part_n == SCAN_POWER_MAX_CYCLE) && end_cycle(false);
+    }
+
+    /**
+    * @brief Accumulates a conversion of the current from the ISR.
+    *
+    * @param[in] sample 10-bit unsigned conversion.
+    */
+    inline void add_current(uint16_t sample)
+    {
+        // A current before the first voltage has no pair.
+        if (have_v)
+        {
+            int16_t i = (int16_t) sample - offset_i;
+
+            part_i += i;
+            part_ii += (int32_t) i * i;
+            i_last = i;
+        }
+    }
+
+    uint8_t current_mux;                        // Analogue input of the current.
+    uint8_t cycles;                             // Whole cycles per window.
+    uint32_t v_scale;                           // Microvolts per voltage code.
+    uint32_t i_scale;                           // Microamps per current code.
+
+    int16_t offset_v;                           // DC level of the voltage subtracted.
+    int16_t offset_i;                           // DC level of the current subtracted.
+    int16_t v_last;                             // Latest voltage.
+    int16_t i_last;                             // Latest current.
+    bool have_v;                                // A voltage was converted since start().
+    bool armed;                                 // Voltage fell below the hysteresis since the last crossing.
+    bool started;                               // Window started at a zero crossing.
+    uint8_t cycle_cnt;                          // Whole cycles in window.
+    uint32_t start_us;                          // Time window started.
+
+    // Sums of the cycle in progress, short enough not to overflow 32 bits.
+    uint16_t part_n;
+    int32_t part_v;
+    int32_t part_i;
+    uint32_t part_vv;
+    uint32_t part_ii;
+    int32_t part_vi;
+
+    window_t sum;                               // Sums of the window in progress.
+    window_t window;                            // Sums of the latest window ended.
+    volatile uint8_t sn;                        // Windows ended, wrapping.
+    uint8_t read_sn;                            // Windows read.
+
+    uint8_t channel;                            // Channel index measuring the voltage.
+    ScanPower *next;                            // Next engine attached to the group.
+};
+
+#endif
@@ -0,0 +1,299 @@
+/**
+ * @file ScanStream.cpp
+ * @author Hobbylad ()
+ * @brief Compact binary streaming of ScanADC scans with non-blocking buffered transmission.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanStream.h"
+
+#include "Arduino.h"
+
+void ScanStream::begin(Print &output, uint8_t channel_count, encoding_t encoding,
+                       uint8_t buffer_size, uint8_t key_interval)
+{
+    end();
+
+    uint16_t previous_size = sizeof(uint16_t) * channel_count,
+             alloc_size = previous_size + buffer_size;
+
+    uint8_t *p = (uint8_t *) malloc(alloc_size);
+    memset(p, 0, alloc_size);
+
+    previous = (uint16_t *) p;
+    p+= previous_size;
+    buffer = p;
+
+    out = &output;
+    this->buffer_size = buffer_size;
+    head = 0;
+    tail = 0;
+
+    chan_count = channel_count;
+    this->encoding = encoding;
+    this->key_interval = key_interval ? key_interval : 1;
+    key_cnt = 0;
+    sn = 0;
+    dropped = 0;
+}
+
+void ScanStream::end()
+{
+    if (previous)
+    {
+        free(previous);
+        previous = NULL;
+        buffer = NULL;
+        out = NULL;
+    }
+}
+
+/**
+ * @brief Writes a little endian base 128 varint of 1 or 2 bytes, the second holding the upper 8 bits.
+ *
+ * @param[out] p     Buffer.
+ * @param[in]  value Value up to 15 bits.
+ * @return uint8_t* Byte after the varint.
+ */
+static inline uint8_t *put_varint(uint8_t *p, uint16_t value)
+{
+    if (value < 0x80)
+    {
+        *p++ = (uint8_t) value;
+    }
+    else
+    {
+        *p++ = (uint8_t) value | 0x80;
+        *p++ = (uint8_t)(value >> 7);
+    }
+
+    return p;
+}
+
+uint8_t ScanStream::encode_packed10(uint8_t *payload, const uint16_t *samples) const
+{
+    uint8_t *p = payload;
+    uint32_t bits = 0;
+    uint8_t bit_cnt = 0;
+
+    for (uint8_t i = 0; i < chan_count; i++)
+    {
+        bits |= (uint32_t) samples[i] << bit_cnt;
+        bit_cnt += 10;
+
+        while (bit_cnt >= 8)
+        {
+            *p++ = (uint8_t) bits;
+            bits >>= 8;
+            bit_cnt -= 8;
+        }
+    }
+
+    if (bit_cnt)
+    {
+        *p++ = (uint8_t) bits;
+    }
+
+    return p - payload;
+}
+
+uint8_t ScanStream::encode_delta(uint8_t *payload, const uint16_t *samples) const
+{
+    uint8_t *p = payload;
+
+    for (uint8_t i = 0; i < chan_count; i++)
+    {
+        int16_t delta = (int16_t)(samples[i] - previous[i]);
+        uint16_t zigzag = (uint16_t)(delta << 1) ^ (uint16_t)(delta >> 15);
+
+        p = put_varint(p, zigzag);
+    }
+
+    return p - payload;
+}
+
+uint8_t ScanStream::encode_varint(uint8_t *payload, const uint16_t *samples) const
+{
+    uint8_t *p = payload;
+
+    for (uint8_t i = 0; i < chan_count; i++)
+    {
+        p = put_varint(p, samples[i]);
+    }
+
+    return p - payload;
+}
+
+bool ScanStream::write_frame(const uint16_t *samples)
+{
+    uint8_t frame[SCAN_STREAM_MAX_FRAME];
+    bool key = (encoding == ENCODING_PACKED10) || (key_cnt == 0);
+    frame_type_t type = FRAME_DELTA;
+    uint8_t length, size;
+
+    if (!buffer)
+    {
+        return false;
+    }
+
+    if (!key)
+    {
+        // A difference that does not fit the zigzag varint is sent as a key frame.
+        for (uint8_t i = 0; i < chan_count; i++)
+        {
+            int16_t delta = (int16_t)(samples[i] - previous[i]);
+
+            if ((delta > SCAN_STREAM_MAX_DELTA) || (delta < -SCAN_STREAM_MAX_DELTA - 1))
+            {
+                key = true;
+                break;
+            }
+        }
+    }
+
+    if (key)
+    {
+        // Key frames are packed unless a sample does not fit 10 bits.
+        type = FRAME_PACKED10;
+
+        for (uint8_t i = 0; i < chan_count; i++)
+        {
+            if (samples[i] > 0x3FF)
+            {
+                type = FRAME_VARINT;
+                break;
+            }
+        }
+    }
+
+    if (type == FRAME_PACKED10)
+    {
+        length = encode_packed10(frame + SCAN_STREAM_HEADER_SIZE, samples);
+    }
+    else if (type == FRAME_VARINT)
+    {
+        length = encode_varint(frame + SCAN_STREAM_HEADER_SIZE, samples);
+    }
+    else
+    {
+        length = encode_delta(frame + SCAN_STREAM_HEADER_SIZE, samples);
+    }
+
+    frame[0] = SCAN_STREAM_SYNC0;
+    frame[1] = SCAN_STREAM_SYNC1;
+    frame[2] = type;
+    frame[3] = sn++;
+    frame[4] = chan_count;
+    frame[5] = length;
+
+    size = SCAN_STREAM_HEADER_SIZE + length;
+
+    // Fletcher-16 checksum from type to end of payload.
+    uint16_t sum1 = 0, sum2 = 0;
+
+    for (uint8_t i = 2; i < size; i++)
+    {
+        sum1 += frame[i];
+
+        if (sum1 >= 255)
+        {
+            sum1 -= 255;
+        }
+
+        sum2 += sum1;
+
+        if (sum2 >= 255)
+        {
+            sum2 -= 255;
+        }
+    }
+
+    frame[size++] = (uint8_t) sum1;
+    frame[size++] = (uint8_t) sum2;
+
+    uint8_t h = head, t = tail;
+    uint8_t used = (h >= t) ? (h - t) : (buffer_size - t + h);
+
+    if (size >= (buffer_size - used))
+    {
+        // The next frame must be a key frame as the receiver cannot decode deltas to this frame.
+        dropped++;
+        key_cnt = 0;
+        return false;
+    }
+
+    for (uint8_t i = 0; i < size; i++)
+    {
+        buffer[h] = frame[i];
+
+        if (++h == buffer_size)
+        {
+            h = 0;
+        }
+    }
+
+    head = h;
+
+    memcpy(previous, samples, sizeof(uint16_t) * chan_count);
+
+    key_cnt = key ? (key_interval - 1) : (key_cnt - 1);
+
+    return true;
+}
+
+void ScanStream::poll()
+{
+    if (!buffer)
+    {
+        return;
+    }
+
+    int available = out->availableForWrite();
+
+    while ((available > 0) && (tail != head))
+    {
+        uint8_t h = head, t = tail;
+        uint8_t len = ((h > t) ? h : buffer_size) - t;
+
+        if (len > available)
+        {
+            len = available;
+        }
+
+        out->write(buffer + t, len);
+
+        t += len;
+
+        if (t == buffer_size)
+        {
+            t = 0;
+        }
+
+        tail = t;
+        available -= len;
+    }
+}
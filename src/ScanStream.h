@@ -0,0 +1,243 @@
+/**
+ * @file ScanStream.h
+ * @author Hobbylad ()
+ * @brief Compact binary streaming of ScanADC scans with non-blocking buffered transmission.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCAN_STREAM_H
+#define SCAN_STREAM_H
+
+#include "stdint.h"
+#include "stdlib.h"
+
+#include "ScanADC.h"
+
+class Print;
+
+#define SCAN_STREAM_SYNC0           0xA5        // First frame synchronisation byte.
+#define SCAN_STREAM_SYNC1           0x5A        // Second frame synchronisation byte.
+#define SCAN_STREAM_HEADER_SIZE     6           // Sync, type, sequence number, channel count and payload length.
+#define SCAN_STREAM_CHECKSUM_SIZE   2           // Fletcher-16 checksum.
+
+#define SCAN_STREAM_MAX_CHANNELS    16          // Largest channel count of a frame.
+#define SCAN_STREAM_MAX_SAMPLE      0x7FFF      // Largest sample of a varint key frame, a 15-bit varint.
+#define SCAN_STREAM_MAX_DELTA       0x3FFF      // Largest difference of a delta frame, -16384 to 16383.
+
+/**
+ * Largest frame encoded, a delta frame of SCAN_STREAM_MAX_CHANNELS channels each needing a 2 byte varint.
+ */
+#define SCAN_STREAM_MAX_FRAME       (SCAN_STREAM_HEADER_SIZE + (2 * SCAN_STREAM_MAX_CHANNELS) + SCAN_STREAM_CHECKSUM_SIZE)
+
+/**
+ * @brief Class to encode ScanADC scans into a compact binary frame stream and transmit it without blocking.
+ *
+ * Each scan of channel samples is encoded as one frame:
+ *
+ * | Field    | Size    | Description                                                       |
+ * |----------|---------|-------------------------------------------------------------------|
+ * | sync     | 2       | 0xA5 0x5A                                                         |
+ * | type     | 1       | #FRAME_PACKED10, #FRAME_DELTA or #FRAME_VARINT                    |
+ * | sn       | 1       | Frame sequence number cycling from 0 to 255                       |
+ * | count    | 1       | Channel count                                                     |
+ * | length   | 1       | Payload length in bytes                                           |
+ * | payload  | length  | Encoded samples                                                   |
+ * | checksum | 2       | Fletcher-16 of type to end of payload, sum1 then sum2             |
+ *
+ * A #FRAME_PACKED10 payload packs the 10-bit samples back to back, least significant bit first,
+ * taking (count * 10 + 7) / 8 bytes. A #FRAME_DELTA payload holds the difference of each sample to
+ * the same channel in the previous frame, zigzag encoded (0, -1, 1, -2, ... to 0, 1, 2, 3, ...) as
+ * a little endian base 128 varint of 1 or 2 bytes, where the second byte holds the upper 8 bits.
+ * A #FRAME_VARINT payload holds each sample as such a varint, and replaces the packed frame when a
+ * sample exceeds 10 bits, such as lock-in samples centred on 1024.
+ *
+ * The 7 + 8 bits of the varint limit each frame type differently:
+ *
+ * | Frame              | Range                                                       |
+ * |--------------------|-------------------------------------------------------------|
+ * | #FRAME_PACKED10    | Samples 0 to 1023                                           |
+ * | #FRAME_DELTA       | Differences -16384 to 16383, zigzag encoded to 0 to 32767   |
+ * | #FRAME_VARINT      | Samples 0 to 32767 (#SCAN_STREAM_MAX_SAMPLE)                |
+ *
+ * A difference beyond #SCAN_STREAM_MAX_DELTA is sent as a key frame instead of a delta frame, so
+ * any samples up to #SCAN_STREAM_MAX_SAMPLE are transmitted. Larger samples are not representable.
+ *
+ * The sequence number is incremented for every frame, including frames dropped because the transmit
+ * buffer is full, so the receiver can detect drops. A delta frame can only be decoded if the previous
+ * frame was received, so a packed or varint key frame is sent periodically and always after a
+ * dropped frame.
+ *
+ * Frames are queued in a transmit buffer by write_frame() and transmitted by poll() as far as the
+ * output can accept without blocking, so poll() must be called regularly from the main loop.
+ *
+ * Example:
+ * @code
+ *   static ScanStream stream;
+ *
+ *   stream.begin(Serial, 4);
+ *   ...
+ *   adc_scanner.wait_scan();
+ *
+ *   for (uint8_t i = 0; i < 4; i++)
+ *   {
+ *       samples[i] = adc_scanner.get_sample(i);
+ *   }
+ *
+ *   stream.write_frame(samples);
+ *   stream.poll();
+ * @endcode
+ */
+class ScanStream
+{
+    public:
+
+    /**
+    * @brief Frame type.
+    */
+    enum frame_type_t
+    {
+        FRAME_PACKED10 = 0x01,                  /**< 10-bit samples packed back to back. */
+        FRAME_DELTA = 0x02,                     /**< Zigzag varint differences to previous frame. */
+        FRAME_VARINT = 0x03                     /**< Varint samples when a sample exceeds 10 bits. */
+    };
+
+    /**
+    * @brief Stream encoding.
+    */
+    enum encoding_t
+    {
+        ENCODING_PACKED10 = 0,                  /**< Every frame is a packed or varint frame. */
+        ENCODING_DELTA                          /**< Delta frames with periodic packed or varint key frames. */
+    };
+
+    /**
+    * @brief Constructs a stopped stream.
+    */
+    ScanStream() : out(NULL), buffer(NULL), previous(NULL)
+    {
+    }
+
+    /**
+    * @brief Starts the stream.
+    *
+    * Allocates the transmit buffer and the previous frame samples used for delta encoding.
+    *
+    * @param[in] output        Output to transmit frames to such as Serial.
+    * @param[in] channel_count Channel count of each frame (1 to #SCAN_STREAM_MAX_CHANNELS).
+    * @param[in] encoding      Stream encoding.
+    * @param[in] buffer_size   Transmit buffer size in bytes (SCAN_STREAM_MAX_FRAME to 255).
+    * @param[in] key_interval  Frames between key frames when delta encoding.
+    */
+    void begin(Print &output, uint8_t channel_count, encoding_t encoding = ENCODING_DELTA,
+               uint8_t buffer_size = 128, uint8_t key_interval = 16);
+
+    /**
+    * @brief Stops the stream discarding frames not yet transmitted.
+    */
+    void end();
+
+    /**
+    * @brief Encodes a scan of channel samples as a frame and queues it for transmission.
+    *
+    * The frame is dropped if the transmit buffer does not have space for it. Note this function
+    * can be called from the ScanADC scan callback provided poll() is not called from an interrupt.
+    *
+    * @param[in] samples Pointer to channel count samples.
+    * @return bool True if the frame was queued, false if it was dropped.
+    */
+    bool write_frame(const uint16_t *samples);
+
+    /**
+    * @brief Transmits queued bytes as far as the output can accept without blocking.
+    */
+    void poll();
+
+    /**
+    * @brief Get the count of frames dropped because the transmit buffer was full.
+    *
+    * @return uint16_t Dropped frame count.
+    */
+    inline uint16_t get_dropped() const
+    {
+        return dropped;
+    }
+
+    private:
+
+    /**
+    * @brief Prevent copy constructor.
+    */
+    ScanStream(const ScanStream &) = delete;
+
+    /**
+    * @brief Prevent assignment.
+    */
+    ScanStream& operator=(const ScanStream &) = delete;
+
+    /**
+    * @brief Encodes a packed frame payload.
+    *
+    * @param[out] payload Payload buffer.
+    * @param[in]  samples Channel samples of 10 bits.
+    * @return uint8_t Payload length.
+    */
+    uint8_t encode_packed10(uint8_t *payload, const uint16_t *samples) const;
+
+    /**
+    * @brief Encodes a delta frame payload.
+    *
+    * @param[out] payload Payload buffer.
+    * @param[in]  samples Channel samples.
+    * @return uint8_t Payload length.
+    */
+    uint8_t encode_delta(uint8_t *payload, const uint16_t *samples) const;
+
+    /**
+    * @brief Encodes a varint frame payload.
+    *
+    * @param[out] payload Payload buffer.
+    * @param[in]  samples Channel samples.
+    * @return uint8_t Payload length.
+    */
+    uint8_t encode_varint(uint8_t *payload, const uint16_t *samples) const;
+
+    Print *out;                                 // Output transmitted to.
+    uint8_t *buffer;                            // Transmit ring buffer.
+    uint8_t buffer_size;                        // Transmit ring buffer size.
+    volatile uint8_t head;                      // Index written to next.
+    volatile uint8_t tail;                      // Index transmitted next.
+
+    uint16_t *previous;                         // Samples of previous frame for delta encoding.
+    uint8_t chan_count;                         // Channel count of each frame.
+    encoding_t encoding;                        // Stream encoding.
+    uint8_t key_interval;                       // Frames between key frames.
+    uint8_t key_cnt;                            // Frames until next key frame.
+    uint8_t sn;                                 // Frame sequence number.
+    uint16_t dropped;                           // Dropped frame count.
+};
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * @file ScanTone.cpp
+ * @author Hobbylad ()
+ * @brief Goertzel tone detection on a ScanADC channel.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ScanTone.h"
+
+#include "Arduino.h"
+#include <avr/interrupt.h>
+#include <math.h>
+
+/**
+ * @brief Integer square root rounded down.
+ *
+ * @param[in] x Value.
+ * @return uint16_t Largest root whose square does not exceed @a x.
+ */
+static uint16_t isqrt(uint32_t x)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > x)
+    {
+        bit >>= 2;
+    }
+
+    while (bit)
+    {
+        if (x >= root + bit)
+        {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+
+        bit >>= 2;
+    }
+
+    return (uint16_t) root;
+}
+
+bool ScanTone::begin(const uint16_t *frequencies_hz, uint8_t bin_count, uint32_t sample_rate_hz, uint8_t block_log2)
+{
+    if ((bin_count > SCAN_TONE_MAX_BINS) || (block_log2 < SCAN_TONE_MIN_BLOCK_LOG2) ||
+        (block_log2 > SCAN_TONE_MAX_BLOCK_LOG2))
+    {
+        return false;
+    }
+
+    for (uint8_t b = 0; b < bin_count; b++)
+    {
+        // At least 2 cycles per block and below the Nyquist frequency.
+        if (((uint32_t) frequencies_hz[b] << block_log2 < 2 * sample_rate_hz) ||
+            ((uint32_t) frequencies_hz[b] * 2 >= sample_rate_hz))
+        {
+            return false;
+        }
+    }
+
+    for (uint8_t b = 0; b < bin_count; b++)
+    {
+        float coeff = 2.0f * cos(2.0f * (float) M_PI * frequencies_hz[b] / sample_rate_hz) * 16384.0f;
+
+        bins[b].coeff = (int16_t)((coeff >= 32767.0f) ? 32767 : lround(coeff));
+    }
+
+    this->bin_count = bin_count;
+    this->block_log2 = block_log2;
+    offset = 512;
+    memset(latched, 0, sizeof(latched));
+
+    return true;
+}
+
+void ScanTone::start()
+{
+    for (uint8_t b = 0; b < bin_count; b++)
+    {
+        bins[b].s1 = 0;
+        bins[b].s2 = 0;
+    }
+
+    cnt = 1U << block_log2;
+    sum = 0;
+}
+
+void ScanTone::end_block()
+{
+    for (uint8_t b = 0; b < bin_count; b++)
+    {
+        latched[b][0] = bins[b].s1;
+        latched[b][1] = bins[b].s2;
+    }
+
+    mean = (uint16_t)((sum + (1UL << (block_log2 - 1))) >> block_log2);
+    offset = mean;
+    sn++;
+}
+
+uint32_t ScanTone::get_power(uint8_t bin) const
+{
+    if (bin >= bin_count)
+    {
+        return 0;
+    }
+
+    uint8_t old_SREG = SREG;
+
+    cli();
+    int32_t s1 = latched[bin][0];
+    int32_t s2 = latched[bin][1];
+    SREG = old_SREG;
+
+    // Squared DFT magnitude of the bin, and the squared amplitude is 4 / n² of it.
+    int64_t p = (int64_t) s1 * s1 + (int64_t) s2 * s2 - (int64_t) mul_q14(bins[bin].coeff, s1) * s2;
+
+    if (p <= 0)
+    {
+        return 0;
+    }
+
+    return (uint32_t)((uint64_t) p >> (2 * block_log2 - 10));
+}
+
+uint16_t ScanTone::get_magnitude(uint8_t bin) const
+{
+    return isqrt(get_power(bin));
+}
@@ -0,0 +1,253 @@
+/**
+ * @file ScanTone.h
+ * @author Hobbylad ()
+ * @brief Goertzel tone detection on a ScanADC channel.
+ * @version 0.1
+ * @date 2021-07-15
+ * @copyright Copyright (c) 2021
+ *
+ * MIT License
+ *
+ * Copyright (c) 2021 Hobbylad
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCAN_TONE_H
+#define SCAN_TONE_H
+
+#include "stdint.h"
+#include "stdlib.h"
+
+#include "ScanADC.h"
+
+#define SCAN_TONE_MAX_BINS          4       // Frequency bins per engine.
+#define SCAN_TONE_MIN_BLOCK_LOG2    5       // Log 2 of smallest block of conversions.
+#define SCAN_TONE_MAX_BLOCK_LOG2    9       // Log 2 of largest block, so the filter states fit 24 bits.
+
+/**
+ * @brief Class to detect tones on a ScanADC channel with a bank of Goertzel filters.
+ *
+ * The tone engine is attached to a channel with ScanADC::attach_tone(). While the channel is
+ * measured, the ADC ISR feeds a block of raw conversions at the conversion rate through a Goertzel
+ * filter per frequency bin, in fixed point with 16-bit multiplies, relative to the mean of the
+ * previous block. At the end of the block the filter states are latched and the channel completes
+ * with the mean of the block as its sample. get_magnitude() then computes the amplitude of each
+ * bin in the main loop, so the presence of a tone is a comparison against a threshold.
+ *
+ * The frequency resolution is the sample rate divided by the block size, and the bins must be at
+ * least 2 cycles per block. The sample rate is the conversion rate, for instance F_CPU / 208 free
+ * running on classic parts or #SCAN_ADC_MAINS_SAMPLES times the mains frequency with
+ * ScanADC::set_mains(). Each bin adds two 16-bit multiplies to every conversion of the block, so
+ * the ISR must keep up with the conversion rate for the bins to stay tuned; at the free running rate
+ * of classic parts that limits the engine to one or two bins.
+ *
+ * The other channels wait until the block ends, while an injected measurement pauses the block
+ * between conversions. The block continues when the injected measurement ends, with the conversions
+ * missed counted as the mean of the previous block so a tone keeps its phase and the block its
+ * length, at the cost of reading lower by the fraction of the block missed. The median, lock-in and
+ * touch settings do not apply to the channel.
+ *
+ * Example:
+ * @code
+ *   static const uint16_t tones[] = { 697, 1209 };
+ *   static ScanTone tone;
+ *
+ *   adc_scanner.set_mains(ScanADC::MAINS_50HZ);            // 3200Hz sample rate
+ *   tone.begin(tones, 2, 3200, 7);                         // 128 conversions, 25Hz per bin
+ *   adc_scanner.attach_tone(0, &tone);
+ *   ...
+ *   if (tone.get_magnitude(0) > 20 * 16) { ... }          // Tone over 20 codes
+ * @endcode
+ */
+class ScanTone
+{
+    public:
+
+    /**
+    * @brief Constructs an engine without bins.
+    */
+    ScanTone() : bin_count(0), block_log2(SCAN_TONE_MIN_BLOCK_LOG2), offset(512), sn(0), next(NULL)
+    {
+    }
+
+    /**
+    * @brief Starts detecting tones at a set of frequencies.
+    *
+    * Call before attaching the engine to a channel.
+    *
+    * @param[in] frequencies_hz Frequency of each bin, below half the sample rate.
+    * @param[in] bin_count      Bin count up to #SCAN_TONE_MAX_BINS.
+    * @param[in] sample_rate_hz Conversion rate.
+    * @param[in] block_log2     Log 2 of conversions per block, from #SCAN_TONE_MIN_BLOCK_LOG2 to
+    *                           #SCAN_TONE_MAX_BLOCK_LOG2.
+    * @return bool True if started, false if the block size or a frequency is out of range.
+    */
+    bool begin(const uint16_t *frequencies_hz, uint8_t bin_count, uint32_t sample_rate_hz, uint8_t block_log2 = 8);
+
+    /**
+    * @brief Get the squared amplitude of a bin in the latest block.
+    *
+    * @param[in] bin Bin index.
+    * @return uint32_t Squared amplitude in 1/256 squared codes.
+    */
+    uint32_t get_power(uint8_t bin) const;
+
+    /**
+    * @brief Get the amplitude of a bin in the latest block.
+    *
+    * A full scale sine at the bin frequency reads about 8170 (511 codes), while a tone midway
+    * between two bins reads around 64% of its amplitude.
+    *
+    * @param[in] bin Bin index.
+    * @return uint16_t Peak amplitude in 1/16 codes.
+    */
+    uint16_t get_magnitude(uint8_t bin) const;
+
+    /**
+    * @brief Get the sequence number of the blocks.
+    *
+    * @return uint8_t Count of blocks ended, wrapping.
+    */
+    inline uint8_t get_sn() const
+    {
+        return sn;
+    }
+
+    private:
+
+    friend class ScanADC;
+
+    /**
+    * @brief ADC Interrupt Service Routine (ISR) declared as friend to allow access to member variables.
+    */
+    friend void SCAN_ADC_vect(void);
+
+    /**
+    * @brief Goertzel filter of a bin.
+    */
+    struct bin_t
+    {
+        int16_t coeff;                     // 2 cos(2 pi f / fs) in Q14.
+        int32_t s1;                        // Latest state.
+        int32_t s2;                        // State before latest.
+    };
+
+    /**
+    * @brief Multiplies a filter state by a Q14 coefficient with 16-bit multiplies.
+    *
+    * @param[in] coeff Q14 coefficient.
+    * @param[in] s     State within 24 bits.
+    * @return int32_t Product rounded down to an integer.
+    */
+    static inline int32_t mul_q14(int16_t coeff, int32_t s)
+    {
+        // Exact as the low byte only contributes its carry into the high part.
+        int32_t hi = (int32_t) coeff * (int16_t)(s >> 8);
+        int32_t lo = (int32_t) coeff * (int16_t)(uint8_t) s;
+
+        return (hi + (lo >> 8)) >> 6;
+    }
+
+    /**
+    * @brief Starts a block from the ISR when the channel is selected, but not when it is resumed
+    * after an injected measurement.
+    */
+    void start();
+
+    /**
+    * @brief Latches the bins at the end of a block from the ISR.
+    */
+    void end_block();
+
+    /**
+    * @brief Filters a conversion from the ISR.
+    *
+    * @param[in] sample 10-bit unsigned conversion.
+    * @return bool True if the block ended.
+    */
+    inline bool add(uint16_t sample)
+    {
+        int16_t x = (int16_t) sample - offset;
+
+        for (uint8_t b = 0; b < bin_count; b++)
+        {
+            bin_t &bin = bins[b];
+            int32_t s = x + mul_q14(bin.coeff, bin.s1) - bin.s2;
+
+            bin.s2 = bin.s1;
+            bin.s1 = s;
+        }
+
+        sum += sample;
+
+        if (--cnt)
+        {
+            return false;
+        }
+
+        end_block();
+
+        return true;
+    }
+
+    /**
+    * @brief Advances the filters over conversions missed while an injected measurement holds the
+    * ADC, from the ISR.
+    *
+    * The missed conversions count as the mean of the previous block, so a tone keeps its phase in
+    * the rest of the block. The last conversion of the block is left to add().
+    *
+    * @param[in] count Conversions missed.
+    */
+    inline void skip(uint8_t count)
+    {
+        while (count-- && (cnt > 1))
+        {
+            for (uint8_t b = 0; b < bin_count; b++)
+            {
+                bin_t &bin = bins[b];
+                int32_t s = mul_q14(bin.coeff, bin.s1) - bin.s2;
+
+                bin.s2 = bin.s1;
+                bin.s1 = s;
+            }
+
+            sum += offset;
+            cnt--;
+        }
+    }
+
+    uint8_t bin_count;                          // Bins filtered.
+    uint8_t block_log2;                         // Log 2 of conversions per block.
+    bin_t bins[SCAN_TONE_MAX_BINS];             // Filters of the block in progress.
+
+    int16_t offset;                             // Mean of the previous block subtracted.
+    uint16_t cnt;                               // Conversions left in block.
+    uint32_t sum;                               // Sum of conversions of the block.
+    uint16_t mean;                              // Mean of the latest block.
+
+    int32_t latched[SCAN_TONE_MAX_BINS][2];     // Filter states at the end of the latest block.
+    volatile uint8_t sn;                        // Blocks ended, wrapping.
+
+    uint8_t channel;                            // Channel index filtered.
+    ScanTone *next;                             // Next engine attached to the group.
+};
+
+#endif